@@ -0,0 +1,142 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <algorithm>
+#include "AlbedoCurveCache.h"
+#include "DGLFrameBuffer.h"
+#include "DGLShader.h"
+#include "Quad.h"
+
+
+AlbedoCurveCache::AlbedoCurveCache() : _useCount(0)
+{
+    _quad = new Quad( 0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f );
+}
+
+
+AlbedoCurveCache::~AlbedoCurveCache()
+{
+    for( std::map<std::string, AlbedoCurve*>::iterator it = _curves.begin(); it != _curves.end(); it++ )
+    {
+        delete it->second->accum;
+        delete it->second;
+    }
+    delete _quad;
+}
+
+
+AlbedoCurve* AlbedoCurveCache::curve( const std::string& key )
+{
+    std::map<std::string, AlbedoCurve*>::iterator it = _curves.find( key );
+    if( it != _curves.end() )
+    {
+        it->second->lastUsed = _useCount++;
+        return it->second;
+    }
+
+    if( (int)_curves.size() >= ALBEDO_CACHE_MAX_CURVES )
+        evict();
+
+    AlbedoCurve* c = new AlbedoCurve;
+    c->accum = new DGLFrameBuffer( ALBEDO_CURVE_SAMPLES, 1, "Albedo curve" );
+    c->accum->addColorBuffer( 0, GL_RGBA32F );
+    c->accum->checkStatus();
+    c->numSamples = 0;
+    c->targetSamples = 0;
+    c->lastUsed = _useCount++;
+
+    c->accum->bind();
+    glf->glClearColor( 0, 0, 0, 0 );
+    c->accum->clear();
+    c->accum->unbind();
+
+    _curves[key] = c;
+    return c;
+}
+
+
+void AlbedoCurveCache::evict()
+{
+    std::map<std::string, AlbedoCurve*>::iterator oldest = _curves.begin();
+    for( std::map<std::string, AlbedoCurve*>::iterator it = _curves.begin(); it != _curves.end(); it++ )
+        if( it->second->lastUsed < oldest->second->lastUsed )
+            oldest = it;
+
+    delete oldest->second->accum;
+    delete oldest->second;
+    _curves.erase( oldest );
+}
+
+
+void AlbedoCurveCache::refine( AlbedoCurve* curve, DGLShader* shader )
+{
+    if( !shader || converged( curve ) )
+        return;
+
+    int numSamples = std::min( ALBEDO_SAMPLES_PER_PASS, curve->targetSamples - curve->numSamples );
+
+    glm::mat4 projection = glm::ortho( 0.f, 1.f, 0.f, 1.f );
+    glm::mat4 id(1.f);
+    shader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(projection) );
+    shader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(id) );
+    shader->setUniformInt( "numAngles", ALBEDO_CURVE_SAMPLES );
+    shader->setUniformInt( "firstSample", curve->numSamples );
+    shader->setUniformInt( "numSamples", numSamples );
+
+    // each pass adds its sums to the ones already there
+    GLboolean blend = glf->glIsEnabled( GL_BLEND );
+    glf->glEnable( GL_BLEND );
+    glf->glBlendFunc( GL_ONE, GL_ONE );
+
+    curve->accum->bind();
+    _quad->draw( shader );
+    curve->accum->unbind();
+
+    glf->glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    if( !blend )
+        glf->glDisable( GL_BLEND );
+
+    curve->numSamples += numSamples;
+}
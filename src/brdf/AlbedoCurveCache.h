@@ -0,0 +1,113 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef ALBEDO_CURVE_CACHE_H
+#define ALBEDO_CURVE_CACHE_H
+
+#include <map>
+#include <string>
+
+#include "SharedContextGLWidget.h"
+
+class DGLFrameBuffer;
+class DGLShader;
+class Quad;
+
+
+// the albedo plot's curves are estimated at this many incident angles, from
+// -90 to 90 degrees
+#define ALBEDO_CURVE_SAMPLES 512
+
+// how many more samples each angle gets per repaint
+#define ALBEDO_SAMPLES_PER_PASS 1024
+
+// the most curves kept; the least recently drawn go first
+#define ALBEDO_CACHE_MAX_CURVES 32
+
+
+// the running sums of one albedo curve: RGB is the sum of the estimates and
+// A the sum of the luminance of two thirds of them, for judging convergence
+struct AlbedoCurve
+{
+    DGLFrameBuffer* accum;
+    int numSamples;
+    int targetSamples;
+    int lastUsed;
+};
+
+
+/*
+Albedo curves for the albedo plot, keyed by everything that goes into them
+(see RenderCacheKey): the BRDF and its parameter values, the incident phi
+and the sampling mode. The samples are added progressively, a pass at a
+time, by the SHADER_ALBEDO_CURVE shader, and kept however the plot is panned
+or zoomed; changing a parameter gives a new key, so going back to earlier
+values picks up where that curve left off.
+*/
+
+class AlbedoCurveCache : GLContext
+{
+public:
+    AlbedoCurveCache();
+    ~AlbedoCurveCache();
+
+    // the curve for the key, empty if it's new
+    AlbedoCurve* curve( const std::string& key );
+
+    // adds a pass of samples to the curve; the shader must be enabled, with
+    // the plot's uniforms already set on it
+    void refine( AlbedoCurve* curve, DGLShader* shader );
+
+    static bool converged( const AlbedoCurve* curve ) { return curve->numSamples >= curve->targetSamples; }
+
+private:
+    void evict();
+
+    std::map<std::string, AlbedoCurve*> _curves;
+    Quad* _quad;
+    int _useCount;
+};
+
+#endif
@@ -47,6 +47,7 @@ infringement.
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 #include "BRDFBase.h"
 #include "BRDFAnalytic.h"
 #include "BRDFMeasuredMERL.h"
@@ -93,6 +94,25 @@ BRDFBase::BRDFBase() : initializedGL(false)
 
     shaders[SHADER_IBL].vertexShaderFilename                 = templateDir + "brdfIBL.vert";
     shaders[SHADER_IBL].fragmentShaderFilename               = templateDir + "brdfIBL.frag";
+
+    shaders[SHADER_IBL_ALBEDO].vertexShaderFilename          = templateDir + "Quad.vert";
+    shaders[SHADER_IBL_ALBEDO].fragmentShaderFilename        = templateDir + "brdftemplateIBLAlbedo.frag";
+
+    shaders[SHADER_CURVE_PROBE].vertexShaderFilename         = templateDir + "Quad.vert";
+    shaders[SHADER_CURVE_PROBE].fragmentShaderFilename       = templateDir + "brdftemplateCurveProbe.frag";
+
+    shaders[SHADER_ALBEDO_CURVE].vertexShaderFilename        = templateDir + "Quad.vert";
+    shaders[SHADER_ALBEDO_CURVE].fragmentShaderFilename      = templateDir + "brdftemplateAlbedoCurve.frag";
+
+    // the line plots can sweep a parameter: same vertex and geometry
+    // templates, coloured by the swept value
+    int sweepTypes[] = { SHADER_POLAR, SHADER_CARTESIAN, SHADER_CARTESIAN_THETA_H, SHADER_CARTESIAN_THETA_D };
+    for( int i = 0; i < 4; i++ )
+    {
+        sweepShaders[sweepTypes[i]].vertexShaderFilename   = shaders[sweepTypes[i]].vertexShaderFilename;
+        sweepShaders[sweepTypes[i]].fragmentShaderFilename = templateDir + "brdftemplateSweep.frag";
+        sweepShaders[sweepTypes[i]].geometryShaderFilename = shaders[sweepTypes[i]].geometryShaderFilename;
+    }
 }
 
 
@@ -103,6 +123,8 @@ BRDFBase::~BRDFBase()
     {
         if( shaders[i].shader )
             delete shaders[i].shader;
+        if( sweepShaders[i].shader )
+            delete sweepShaders[i].shader;
     }
 }
 
@@ -160,7 +182,8 @@ bool BRDFBase::loadBRDF( const char* filename )
             beginSection( currentSection );
 
             // make sure we know what this is
-            if( currentSection != "parameters" && !canReadSectionType(currentSection) )
+            if( currentSection != "parameters" && currentSection != "hints" &&
+                !canReadSectionType(currentSection) )
                 printf( "Warning: Don't know what to do with %s.\n", currentSection.c_str() );
         }
 
@@ -187,6 +210,12 @@ bool BRDFBase::loadBRDF( const char* filename )
                     return false;
             }
 
+            // hints are single words telling the viewers what the BRDF is like
+            else if( currentSection == "hints" )
+            {
+                hints.push_back( token );
+            }
+
             // derived class can read whatever
             else
             {
@@ -204,6 +233,12 @@ bool BRDFBase::loadBRDF( const char* filename )
 }
 
 
+bool BRDFBase::hasHint( std::string hint )
+{
+    return std::find( hints.begin(), hints.end(), hint ) != hints.end();
+}
+
+
 void BRDFBase::addFloatParameter( std::string name, float min, float max, float value )
 {
     brdfFloatParam param;
@@ -335,7 +370,62 @@ void BRDFBase::disableShader( int shaderType )
 
 
 
-std::string BRDFBase::loadShaderFromFile( std::string filename, std::string chunkToInsert, std::string isFuncToInsert )
+DGLShader* BRDFBase::getUpdatedSweepShader( int shaderType, brdfPackage* pkg )
+{
+    initGL();
+
+    if( !pkg || pkg->sweepParameter < 0 || pkg->sweepParameter >= (int)floatParameters.size() )
+        return NULL;
+
+    shaderInfo& info = sweepShaders[shaderType];
+    if( info.vertexShaderFilename.empty() )
+        return NULL;
+
+    // the swept parameter is compiled into the shader, so sweeping a
+    // different one means compiling it again
+    const std::string& param = floatParameters[pkg->sweepParameter].name;
+    if( !info.shader || info.sweepParameter != param )
+    {
+        info.sweepParameter = param;
+        compileShader( info.shader,
+                       info.vertexShaderFilename,
+                       info.fragmentShaderFilename,
+                       info.geometryShaderFilename,
+                       param );
+    }
+
+    DGLShader* shader = info.shader;
+    if( shader )
+    {
+        shader->enable();
+
+        // the swept parameter has no uniform, so setting it does nothing
+        adjustShaderPreRender( shader );
+        setColorsFromPackage( shader, pkg );
+        shader->setUniformFloat( "sweepRange", pkg->sweepMin, pkg->sweepMax );
+
+        return shader;
+    }
+
+    return NULL;
+}
+
+
+
+void BRDFBase::disableSweepShader( int shaderType )
+{
+    DGLShader* shader = sweepShaders[shaderType].shader;
+    if( !shader )
+        return;
+
+    adjustShaderPostRender( shader );
+    shader->disable();
+}
+
+
+
+std::string BRDFBase::loadShaderFromFile( std::string filename, std::string chunkToInsert, std::string isFuncToInsert,
+                                          std::string sweepParameter )
 {
     std::ifstream ifs( filename.c_str() );
     std::string line;
@@ -347,8 +437,18 @@ std::string BRDFBase::loadShaderFromFile( std::string filename, std::string chun
         // at the top of the shader we insert all the uniforms for this shader
         if( line == "::INSERT_UNIFORMS_HERE::" )
         {
+            // ...except a swept parameter, which comes in per instance
             for( int i = 0; i < (int)floatParameters.size(); i++ )
-                completeShader += "uniform float " + floatParameters[i].name + ";\n";
+            {
+                if( floatParameters[i].name == sweepParameter )
+                {
+                    std::ostringstream os;
+                    os << "layout(location = " << SWEEP_VALUE_LOCATION << ") in float " << sweepParameter << ";\n";
+                    completeShader += os.str();
+                }
+                else
+                    completeShader += "uniform float " + floatParameters[i].name + ";\n";
+            }
             for( int i = 0; i < (int)boolParameters.size(); i++ )
                 completeShader += "uniform bool " + boolParameters[i].name + ";\n";
             for( int i = 0; i < (int)colorParameters.size(); i++ )
@@ -365,6 +465,10 @@ std::string BRDFBase::loadShaderFromFile( std::string filename, std::string chun
         else
         {
             completeShader += line + "\n";
+
+            // sweep shaders are told which parameter is swept in every stage
+            if( sweepParameter.length() && line.compare( 0, 8, "#version" ) == 0 )
+                completeShader += "#define SWEEP_PARAMETER " + sweepParameter + "\n";
         }
     }
 
@@ -374,15 +478,16 @@ std::string BRDFBase::loadShaderFromFile( std::string filename, std::string chun
 
 
 
-bool BRDFBase::compileShader( DGLShader*& shader, std::string vs, std::string fs, std::string gs )
+bool BRDFBase::compileShader( DGLShader*& shader, std::string vs, std::string fs, std::string gs,
+                              std::string sweepParameter )
 {
     // nuke the shader if it exists
     if( shader )
         delete shader;
 
     // here's the tricky bit: load the shader templates, sticking in the BRDF function where needed
-    std::string vertShader = loadShaderFromFile( vs, getBRDFFunction(), getISFunction() );
-    std::string fragShader = loadShaderFromFile( fs, getBRDFFunction(), getISFunction() );
+    std::string vertShader = loadShaderFromFile( vs, getBRDFFunction(), getISFunction(), sweepParameter );
+    std::string fragShader = loadShaderFromFile( fs, getBRDFFunction(), getISFunction(), sweepParameter );
 
 /*
     printf( "==========\n" );
@@ -397,7 +502,7 @@ bool BRDFBase::compileShader( DGLShader*& shader, std::string vs, std::string fs
     shader->setVertexShaderFromString(vertShader);
     shader->setFragmentShaderFromString(fragShader);
     if(!gs.empty())
-        shader->setGeometryShaderFromFile(gs);
+        shader->setGeometryShaderFromString(loadShaderFromFile( gs, "", "", sweepParameter ));
     shader->create();
     return shader->ready();
 }
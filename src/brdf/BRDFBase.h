@@ -68,7 +68,7 @@ class BRDFBase;
 #define BRDF_VAR_COLOR 2
 
 
-#define NUM_SHADERS                 10
+#define NUM_SHADERS                 13
 #define SHADER_DUMMY                0
 #define SHADER_REFLECTOMETER        1
 #define SHADER_POLAR                2
@@ -79,6 +79,14 @@ class BRDFBase;
 #define SHADER_IMAGE_SLICE          7
 #define SHADER_IBL                  8
 #define SHADER_CARTESIAN_ALBEDO     9
+#define SHADER_IBL_ALBEDO           10
+#define SHADER_CURVE_PROBE          11
+#define SHADER_ALBEDO_CURVE         12
+
+// a parameter sweep draws at most this many curves, and takes the swept
+// value from this vertex attribute, one per instance
+#define MAX_SWEEP_CURVES            64
+#define SWEEP_VALUE_LOCATION        1
 
 
 struct brdfFloatParam
@@ -111,6 +119,11 @@ struct brdfPackage
     {
         // play it safe - don't assume other code will set this correctly
         dirty = true;
+
+        // no parameter sweep unless one's asked for
+        sweepParameter = -1;
+        sweepMin = sweepMax = 0.f;
+        sweepCount = 0;
     }
 
     void setDrawColor( float dr, float dg, float db )
@@ -127,10 +140,25 @@ struct brdfPackage
         colorMask[2] = mb;
     }
 
+    // the swept parameter's value for each of the curves, ends included
+    std::vector<float> sweepValues() const
+    {
+        std::vector<float> values;
+        for( int i = 0; i < sweepCount; i++ )
+            values.push_back( sweepCount > 1 ? sweepMin + (sweepMax - sweepMin) * float(i) / float(sweepCount - 1) : sweepMin );
+        return values;
+    }
+
     BRDFBase* brdf;
     float drawColor[3];
     float colorMask[3];
     bool dirty;
+
+    // plots draw sweepCount curves of the BRDF, with the float parameter
+    // at index sweepParameter going from sweepMin to sweepMax
+    int sweepParameter;
+    float sweepMin, sweepMax;
+    int sweepCount;
 };
 
 
@@ -144,6 +172,7 @@ struct shaderInfo
     std::string vertexShaderFilename;
     std::string fragmentShaderFilename;
     std::string geometryShaderFilename;
+    std::string sweepParameter;
     DGLShader* shader;
 };
 
@@ -180,10 +209,23 @@ public:
     DGLShader* getUpdatedShader( int shaderType, brdfPackage* = NULL );
     void disableShader( int shaderType );
 
+    // the plot shaders, with the package's swept parameter read per instance
+    // from SWEEP_VALUE_LOCATION rather than from its uniform; NULL for
+    // shader types that can't sweep
+    DGLShader* getUpdatedSweepShader( int shaderType, brdfPackage* pkg );
+    void disableSweepShader( int shaderType );
+
     void saveParamsFile( const char* filename );
 
     virtual bool hasISFunction() { return false; }
 
+    // hints come from the "hints" section of the .brdf file; e.g. "diffuse"
+    // lets the IBL view light the BRDF with the probe's SH irradiance
+    bool hasHint( std::string hint );
+
+    // the functions pasted into the shader templates, for keying cached renders
+    std::string getShaderFunctions() { return getBRDFFunction() + getISFunction(); }
+
     // create a new BRDF based on this one
     virtual BRDFBase* cloneBRDF(bool resetToDefaults);
 
@@ -217,17 +259,20 @@ protected:
     std::vector<brdfFloatParam> floatParameters;
     std::vector<brdfBoolParam> boolParameters;
     std::vector<brdfColorParam> colorParameters;
+    std::vector<std::string> hints;
     std::string name;
 
 private:
 
     bool processParameterLine( std::string line );
 
-    std::string loadShaderFromFile( std::string, std::string = "", std::string = "" );
+    std::string loadShaderFromFile( std::string, std::string = "", std::string = "", std::string = "" );
 
-    bool compileShader(DGLShader*& shader, std::string vs, std::string fs , std::string gs);
+    bool compileShader(DGLShader*& shader, std::string vs, std::string fs , std::string gs,
+                       std::string sweepParameter = "");
 
     shaderInfo shaders[NUM_SHADERS];
+    shaderInfo sweepShaders[NUM_SHADERS];
 };
 
 
@@ -81,8 +81,9 @@ Index
 #include "BRDFMeasuredAniso.h"
 #include "DGLShader.h"
 #include "Paths.h"
+#include "UploadManager.h"
 
-BRDFMeasuredAniso::BRDFMeasuredAniso() :brdfData(NULL) {
+BRDFMeasuredAniso::BRDFMeasuredAniso() :brdfData(NULL), uploadGroup(0) {
     std::string path = getShaderTemplatesPath() + "measuredAniso.func";
 
     //read the shader
@@ -92,6 +93,8 @@ BRDFMeasuredAniso::BRDFMeasuredAniso() :brdfData(NULL) {
 }
 
 BRDFMeasuredAniso::~BRDFMeasuredAniso() {
+    UploadManager::instance()->cancel(uploadGroup);
+    free(brdfData);
     glf->glBindBuffer(GL_TEXTURE_BUFFER, tbo);
     glf->glDeleteBuffers(1, &tbo);
 }
@@ -144,25 +147,22 @@ void BRDFMeasuredAniso::initGL() {
     glf->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, tbo);
     glf->glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
-    glf->glBindBuffer(GL_TEXTURE_BUFFER, tbo);
-    float* p = (float*)glf->glMapBuffer( GL_TEXTURE_BUFFER, GL_WRITE_ONLY );
-
-    float *halfdata = new float[numBytes];
+    float *halfdata = new float[(numBRDFSamples*3+1)/2];
     for (int i=0; i<numBRDFSamples*3; i++)
         if(i % 2 == 0) halfdata[i/2]= (brdfData[i] + brdfData[i+1])/2.0;
 
-    memcpy( p, halfdata, numBytes );
-    glf->glUnmapBuffer(GL_TEXTURE_BUFFER);
-    glf->glBindBuffer(GL_TEXTURE_BUFFER, 0);
-
+    //stream it in; the upload manager frees it once it's on the GPU
+    std::shared_ptr<const void> data( halfdata, std::default_delete<float[]>() );
+    uploadGroup = UploadManager::instance()->newGroup();
+    UploadManager::instance()->uploadBuffer( uploadGroup, tbo, halfdata, numBytes, data );
 
-    delete[] halfdata;
-    delete[] brdfData;
+    free( brdfData );
     brdfData = NULL;
     initializedGL = true;
 }
 
 void BRDFMeasuredAniso::adjustShaderPreRender(DGLShader *shader) {
     shader->setUniformTexture( "measuredDataAniso", tex, GL_TEXTURE_BUFFER );
+    shader->setUniformFloat( "measuredDataReady", UploadManager::instance()->isPending( uploadGroup ) ? 0.0 : 1.0 );
     BRDFBase::adjustShaderPreRender( shader );
 }
@@ -74,6 +74,9 @@ private:
 
     int numBRDFSamples;
     float* brdfData;
+
+    // the data's upload, while it's in flight
+    int uploadGroup;
 };
 
 #endif // BRDFMEASUREDANISO_H
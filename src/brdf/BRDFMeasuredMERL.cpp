@@ -57,6 +57,7 @@ infringement.
 #include "BRDFMeasuredMERL.h"
 #include "DGLShader.h"
 #include "Paths.h"
+#include "UploadManager.h"
 
 #define BRDF_SAMPLING_RES_THETA_H       90
 #define BRDF_SAMPLING_RES_THETA_D       90
@@ -65,7 +66,7 @@ infringement.
 
 
 BRDFMeasuredMERL::BRDFMeasuredMERL()
-                 : brdfData(NULL)
+                 : brdfData(NULL), uploadGroup(0)
 {
     std::string path = getShaderTemplatesPath() + "measured.func";
 
@@ -84,6 +85,9 @@ BRDFMeasuredMERL::BRDFMeasuredMERL()
 
 BRDFMeasuredMERL::~BRDFMeasuredMERL()
 {
+    UploadManager::instance()->cancel( uploadGroup );
+    delete[] brdfData;
+
     glf->glBindBuffer(GL_TEXTURE_BUFFER, tbo);
     glf->glDeleteBuffers( 1, &tbo);
 }
@@ -166,14 +170,11 @@ void BRDFMeasuredMERL::initGL()
     glf->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, tbo);
     glf->glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
-    glf->glBindBuffer(GL_TEXTURE_BUFFER, tbo);
-    float* p = (float*)glf->glMapBuffer( GL_TEXTURE_BUFFER, GL_WRITE_ONLY );
-
-    memcpy( p, brdfData, numBytes );
-    glf->glUnmapBuffer(GL_TEXTURE_BUFFER);
-    glf->glBindBuffer(GL_TEXTURE_BUFFER, 0);
-
-    delete[] brdfData;
+    // the data streams in over the next few frames; the upload manager frees
+    // it once it's on the GPU
+    std::shared_ptr<const void> data( brdfData, std::default_delete<float[]>() );
+    uploadGroup = UploadManager::instance()->newGroup();
+    UploadManager::instance()->uploadBuffer( uploadGroup, tbo, brdfData, numBytes, data );
     brdfData = NULL;
 
     initializedGL = true;
@@ -183,6 +184,7 @@ void BRDFMeasuredMERL::initGL()
 void BRDFMeasuredMERL::adjustShaderPreRender( DGLShader* shader )
 {
     shader->setUniformTexture( "measuredData", tex, GL_TEXTURE_BUFFER );
+    shader->setUniformFloat( "measuredDataReady", UploadManager::instance()->isPending( uploadGroup ) ? 0.0 : 1.0 );
 
     BRDFBase::adjustShaderPreRender( shader );
 }
@@ -0,0 +1,148 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QFile>
+#include <QSaveFile>
+#include <string.h>
+#include "CacheFile.h"
+
+
+CacheFile::CacheFile() : _file(NULL), _data(NULL), _size(0), _headerSize(0)
+{
+}
+
+
+CacheFile::~CacheFile()
+{
+    close();
+}
+
+
+void CacheFile::close()
+{
+    if( _file )
+    {
+        _file->close();
+        delete _file;
+        _file = NULL;
+    }
+
+    _memory.clear();
+    _data = NULL;
+    _size = 0;
+    _headerSize = 0;
+}
+
+
+bool CacheFile::open( const std::string& filename, const char* magic, quint32 version, size_t headerSize )
+{
+    close();
+
+    _file = new QFile( QString::fromStdString( filename ) );
+    if( !_file->open( QIODevice::ReadOnly ) || _file->size() < (qint64)headerSize )
+    {
+        close();
+        return false;
+    }
+
+    _data = (char*)_file->map( 0, _file->size() );
+    if( !_data )
+    {
+        close();
+        return false;
+    }
+    _size = _file->size();
+    _headerSize = headerSize;
+
+    const CacheFileHeader& h = *(const CacheFileHeader*)_data;
+    if( strncmp( h.magic, magic, sizeof(h.magic) ) || h.version != version )
+    {
+        close();
+        return false;
+    }
+
+    _filename = filename;
+    return true;
+}
+
+
+void CacheFile::allocate( const std::string& filename, const void* header, size_t headerSize, quint64 size )
+{
+    close();
+
+    _filename = filename;
+    _memory.assign( size, 0 );
+    _data = &_memory[0];
+    _size = size;
+    _headerSize = headerSize;
+    memcpy( _data, header, headerSize );
+}
+
+
+bool CacheFile::save()
+{
+    // only in-memory copies need saving
+    if( !_data || _file )
+        return false;
+
+    QSaveFile out( QString::fromStdString( _filename ) );
+    if( !out.open( QIODevice::WriteOnly ) )
+        return false;
+
+    if( out.write( _data, _size ) != (qint64)_size )
+    {
+        out.cancelWriting();
+        return false;
+    }
+
+    return out.commit();
+}
+
+
+bool CacheFile::sectionFits( quint64 offset, quint64 numBytes ) const
+{
+    return offset >= _headerSize && (offset & 3) == 0 &&
+           offset <= _size && numBytes <= _size - offset;
+}
@@ -0,0 +1,134 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <string>
+#include <vector>
+#include <QtGlobal>
+
+class QFile;
+
+/*
+CacheFile is the part the on-disk caches (ProbeCache, MeshCache) have in
+common: a header, starting with a magic string and a version, followed by
+sections at byte offsets the header records. The file is either mapped
+read-only from the cache directory, or built in memory and then saved there.
+
+Nothing in a mapped header is trusted until it has been checked; owners use
+sectionFits() on every offset before handing out pointers into the data.
+*/
+
+// how every cache header starts
+struct CacheFileHeader
+{
+    char    magic[8];
+    quint32 version;
+};
+
+
+// hands out the offsets of the sections following a header, keeping each
+// one 16-byte aligned
+class CacheFileLayout
+{
+public:
+    explicit CacheFileLayout( size_t headerSize ) : _size( align( headerSize ) ) {}
+
+    quint64 addSection( quint64 numBytes )
+    {
+        quint64 offset = _size;
+        _size = align( _size + numBytes );
+        return offset;
+    }
+
+    quint64 size() const { return _size; }
+
+private:
+    static quint64 align( quint64 n ) { return (n + 15) & ~15ULL; }
+
+    quint64 _size;
+};
+
+
+class CacheFile
+{
+public:
+    CacheFile();
+    ~CacheFile();
+
+    // maps the given file if it starts with a header of the given size,
+    // magic string and version
+    bool open( const std::string& filename, const char* magic, quint32 version, size_t headerSize );
+
+    // sets up a zeroed in-memory copy of the given size, starting with the
+    // given header, to be saved as filename
+    void allocate( const std::string& filename, const void* header, size_t headerSize, quint64 size );
+
+    // writes the in-memory copy into place
+    bool save();
+
+    // unmaps or frees the data
+    void close();
+
+    bool isValid() const { return _data != NULL; }
+
+    char* data() const { return _data; }
+    quint64 size() const { return _size; }
+
+    // true if numBytes at the given offset lie after the header and within
+    // the data, 4-byte aligned
+    bool sectionFits( quint64 offset, quint64 numBytes ) const;
+
+private:
+    QFile* _file;
+    std::string _filename;
+    std::vector<char> _memory;
+    char* _data;
+    quint64 _size;
+    size_t _headerSize;
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include <queue>
+#include "CurveSampler.h"
+#include "DGLFrameBuffer.h"
+#include "DGLShader.h"
+#include "Quad.h"
+
+
+// a stretch of the dense samples between two chosen vertices, and where the
+// curves stray furthest from the line between them
+struct CurveSegment
+{
+    int first, last;
+    int split;
+    float error;
+
+    bool operator<( const CurveSegment& s ) const { return error < s.error; }
+};
+
+
+CurveSampler::CurveSampler() : _angleStart(0.f), _angleEnd(0.f)
+{
+    _target = new DGLFrameBuffer( CURVE_PROBE_SAMPLES, 1, "Curve probe" );
+    _target->addColorBuffer( 0, GL_R32F );
+    _target->checkStatus();
+
+    _quad = new Quad( 0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f );
+}
+
+
+CurveSampler::~CurveSampler()
+{
+    delete _quad;
+    delete _target;
+}
+
+
+void CurveSampler::begin( float angleStart, float angleEnd )
+{
+    _angleStart = angleStart;
+    _angleEnd = angleEnd;
+    _curves.clear();
+}
+
+
+bool CurveSampler::addCurve( DGLShader* shader, int probeMode )
+{
+    if( !shader )
+        return false;
+
+    glm::mat4 projection = glm::ortho( 0.f, 1.f, 0.f, 1.f );
+    glm::mat4 id(1.f);
+    shader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(projection) );
+    shader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(id) );
+    shader->setUniformInt( "probeMode", probeMode );
+    shader->setUniformInt( "numSamples", CURVE_PROBE_SAMPLES );
+    shader->setUniformFloat( "angleStart", _angleStart );
+    shader->setUniformFloat( "angleEnd", _angleEnd );
+
+    GLboolean blend = glf->glIsEnabled( GL_BLEND );
+    glf->glDisable( GL_BLEND );
+
+    _target->bind();
+    _quad->draw( shader );
+
+    std::vector<float> values( CURVE_PROBE_SAMPLES );
+    glf->glReadPixels( 0, 0, CURVE_PROBE_SAMPLES, 1, GL_RED, GL_FLOAT, &values[0] );
+    _target->unbind();
+
+    if( blend )
+        glf->glEnable( GL_BLEND );
+
+    // whatever the BRDF does below the horizon, we only care about its shape
+    for( int i = 0; i < CURVE_PROBE_SAMPLES; i++ )
+        if( !std::isfinite( values[i] ) )
+            values[i] = 0.f;
+
+    _curves.push_back( values );
+    return true;
+}
+
+
+static CurveSegment measureSegment( const std::vector< std::vector<float> >& curves,
+                                    const std::vector<float>& scales, int first, int last )
+{
+    CurveSegment s;
+    s.first = first;
+    s.last = last;
+    s.split = (first + last) / 2;
+    s.error = 0.f;
+
+    for( int c = 0; c < (int)curves.size(); c++ )
+    {
+        const std::vector<float>& v = curves[c];
+        for( int i = first + 1; i < last; i++ )
+        {
+            float t = float(i - first) / float(last - first);
+            float error = fabsf( v[i] - (v[first] + t * (v[last] - v[first])) ) * scales[c];
+            if( error > s.error )
+            {
+                s.error = error;
+                s.split = i;
+            }
+        }
+    }
+
+    return s;
+}
+
+
+void CurveSampler::sample( int budget, std::vector<float>& angles ) const
+{
+    budget = std::max( 2, std::min( budget, CURVE_PROBE_SAMPLES ) );
+
+    // an even spacing to start with, so no stretch of the curve is skipped
+    int numInitial = _curves.empty() ? budget : std::max( 2, budget / 8 );
+    std::vector<int> chosen;
+    for( int i = 0; i < numInitial; i++ )
+        chosen.push_back( int( float(i) * float(CURVE_PROBE_SAMPLES - 1) / float(numInitial - 1) + 0.5f ) );
+
+    if( !_curves.empty() )
+    {
+        // errors are measured relative to each curve's own range of values
+        std::vector<float> scales( _curves.size() );
+        for( int c = 0; c < (int)_curves.size(); c++ )
+        {
+            float lo = *std::min_element( _curves[c].begin(), _curves[c].end() );
+            float hi = *std::max_element( _curves[c].begin(), _curves[c].end() );
+            scales[c] = hi > lo ? 1.f / (hi - lo) : 0.f;
+        }
+
+        std::priority_queue<CurveSegment> segments;
+        for( int i = 0; i + 1 < numInitial; i++ )
+            segments.push( measureSegment( _curves, scales, chosen[i], chosen[i+1] ) );
+
+        int numChosen = numInitial;
+        while( numChosen < budget && !segments.empty() )
+        {
+            CurveSegment s = segments.top();
+            if( s.error < CURVE_TOLERANCE )
+                break;
+            segments.pop();
+
+            chosen.push_back( s.split );
+            numChosen++;
+
+            segments.push( measureSegment( _curves, scales, s.first, s.split ) );
+            segments.push( measureSegment( _curves, scales, s.split, s.last ) );
+        }
+
+        std::sort( chosen.begin(), chosen.end() );
+    }
+
+    angles.resize( chosen.size() );
+    for( int i = 0; i < (int)chosen.size(); i++ )
+    {
+        float t = float(chosen[i]) / float(CURVE_PROBE_SAMPLES - 1);
+        angles[i] = _angleStart + t * (_angleEnd - _angleStart);
+    }
+}
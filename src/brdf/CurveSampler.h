@@ -0,0 +1,106 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef CURVE_SAMPLER_H
+#define CURVE_SAMPLER_H
+
+#include <vector>
+
+#include "SharedContextGLWidget.h"
+
+class DGLFrameBuffer;
+class DGLShader;
+class Quad;
+
+
+// which curve the probe shader evaluates; these match brdftemplateCurveProbe.frag
+#define CURVE_PROBE_POLAR 0
+#define CURVE_PROBE_THETA_V 1
+#define CURVE_PROBE_THETA_H 2
+#define CURVE_PROBE_THETA_D 3
+
+// how densely each curve is evaluated before picking the vertices
+#define CURVE_PROBE_SAMPLES 2048
+
+// segments are split until linear interpolation is this close to the curve,
+// as a fraction of the curve's range of values
+#define CURVE_TOLERANCE 0.0005f
+
+
+/*
+Picks where a plot's vertices go along its BRDF curves. Each curve is
+evaluated on the GPU at CURVE_PROBE_SAMPLES evenly spaced angles with the
+SHADER_CURVE_PROBE shader, and read back. The vertices then start from a
+coarse even spacing, and the segment the curves stray furthest from gets
+split until the budget is spent or every segment is within tolerance.
+Sharp lobes get many vertices, and flat stretches get few.
+*/
+
+class CurveSampler : GLContext
+{
+public:
+    CurveSampler();
+    ~CurveSampler();
+
+    // starts a new set of curves, all over the same range of angles
+    void begin( float angleStart, float angleEnd );
+
+    // evaluates one curve; the probe shader must be enabled, with the
+    // plot's uniforms already set on it
+    bool addCurve( DGLShader* shader, int probeMode );
+
+    // at most budget angles from the start of the range to the end,
+    // shared by all the curves added since begin()
+    void sample( int budget, std::vector<float>& angles ) const;
+
+private:
+    DGLFrameBuffer* _target;
+    Quad* _quad;
+
+    float _angleStart, _angleEnd;
+    std::vector< std::vector<float> > _curves;
+};
+
+#endif
@@ -0,0 +1,283 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "Denoiser.h"
+#include "ParallelFor.h"
+
+
+// the pass counts the report looks at
+static const int reportCheckpoints[] = { 4, 16, 32 };
+static const int numReportCheckpoints = 3;
+
+
+// estimates the noise from how far pixels are from their neighbours; the
+// image itself is smooth at this scale, so this is mostly sample noise
+static float estimateNoise( const float* c, const std::vector<unsigned char>& covered,
+                            int width, int height )
+{
+    double noiseSum = 0.0;
+    int numSamples = 0;
+    for( int y = 1; y < height - 1; y++ )
+    {
+        for( int x = 1; x < width - 1; x++ )
+        {
+            int p = y*width + x;
+            if( !covered[p] || !covered[p-1] || !covered[p+1] || !covered[p-width] || !covered[p+width] )
+                continue;
+
+            for( int k = 0; k < 3; k++ )
+            {
+                float d = c[p*3+k] - 0.25f * (c[(p-1)*3+k] + c[(p+1)*3+k] +
+                                              c[(p-width)*3+k] + c[(p+width)*3+k]);
+                noiseSum += d * d;
+            }
+            numSamples++;
+        }
+    }
+
+    // the difference to the mean of 4 neighbours has 5/4 the variance of a pixel
+    return numSamples ? sqrtf( float(noiseSum / (numSamples * 3) * 0.8) ) : 0.f;
+}
+
+
+void denoiseAtrous( const float* accum, const float* guide, float* result,
+                    int width, int height, float pixelSize )
+{
+    int numPixels = width * height;
+    std::vector<float> pingPong[2];
+    pingPong[0].resize( numPixels * 3 );
+    pingPong[1].resize( numPixels * 3 );
+    std::vector<unsigned char> covered( numPixels );
+
+    // average the accumulated samples
+    for( int i = 0; i < numPixels; i++ )
+    {
+        const float* a = accum + i*4;
+        const float* n = guide + i*4;
+        covered[i] = a[3] > 0.f && (n[0]*n[0] + n[1]*n[1] + n[2]*n[2]) > 0.f;
+
+        float* c = &pingPong[0][i*3];
+        if( covered[i] )
+        {
+            c[0] = a[0] / a[3];
+            c[1] = a[1] / a[3];
+            c[2] = a[2] / a[3];
+        }
+        else
+            c[0] = c[1] = c[2] = 0.f;
+    }
+
+    const float kernel[5] = { 1.f/16.f, 1.f/4.f, 3.f/8.f, 1.f/4.f, 1.f/16.f };
+
+    for( int iteration = 0; iteration < DENOISE_ITERATIONS; iteration++ )
+    {
+        int step = 1 << iteration;
+        const float* src = &pingPong[iteration & 1][0];
+        float* dst = &pingPong[(iteration + 1) & 1][0];
+
+        // what noise is left after the earlier iterations sets how different
+        // the colours may be
+        float colorSigma = std::max( 4.f * estimateNoise( src, covered, width, height ), 1e-6f );
+        float invColorSigma2 = 1.f / (colorSigma * colorSigma);
+        float invDepthSigma = 1.f / (2.f * pixelSize * step);
+
+        parallelFor( 0, height, [&]( int y )
+        {
+            for( int x = 0; x < width; x++ )
+            {
+                int p = y*width + x;
+                if( !covered[p] )
+                {
+                    dst[p*3+0] = dst[p*3+1] = dst[p*3+2] = 0.f;
+                    continue;
+                }
+
+                const float* cp = src + p*3;
+                const float* np = guide + p*4;
+
+                float sum[3] = { 0.f, 0.f, 0.f };
+                float weightSum = 0.f;
+
+                for( int j = -2; j <= 2; j++ )
+                {
+                    int qy = y + j*step;
+                    if( qy < 0 || qy >= height )
+                        continue;
+
+                    for( int i = -2; i <= 2; i++ )
+                    {
+                        int qx = x + i*step;
+                        if( qx < 0 || qx >= width )
+                            continue;
+
+                        int q = qy*width + qx;
+                        if( !covered[q] )
+                            continue;
+
+                        const float* cq = src + q*3;
+                        const float* nq = guide + q*4;
+
+                        // normal weight is max(0, n.n')^64
+                        float wNormal = std::max( np[0]*nq[0] + np[1]*nq[1] + np[2]*nq[2], 0.f );
+                        for( int k = 0; k < 6; k++ )
+                            wNormal *= wNormal;
+                        if( wNormal < 1e-4f )
+                            continue;
+
+                        // colour and depth weights share the exponential
+                        float dr = cp[0] - cq[0], dg = cp[1] - cq[1], db = cp[2] - cq[2];
+                        float e = (dr*dr + dg*dg + db*db) * invColorSigma2 +
+                                  fabsf( np[3] - nq[3] ) * invDepthSigma;
+                        if( e > 20.f )
+                            continue;
+
+                        float w = kernel[i+2] * kernel[j+2] * wNormal * expf( -e );
+                        sum[0] += cq[0] * w;
+                        sum[1] += cq[1] * w;
+                        sum[2] += cq[2] * w;
+                        weightSum += w;
+                    }
+                }
+
+                // the centre pixel always has a weight, so this never divides by zero
+                dst[p*3+0] = sum[0] / weightSum;
+                dst[p*3+1] = sum[1] / weightSum;
+                dst[p*3+2] = sum[2] / weightSum;
+            }
+        });
+    }
+
+    const float* filtered = &pingPong[DENOISE_ITERATIONS & 1][0];
+    for( int i = 0; i < numPixels; i++ )
+    {
+        result[i*4+0] = filtered[i*3+0];
+        result[i*4+1] = filtered[i*3+1];
+        result[i*4+2] = filtered[i*3+2];
+        result[i*4+3] = covered[i] ? 1.f : 0.f;
+    }
+}
+
+
+
+DenoiseReport::DenoiseReport()
+{
+}
+
+
+void DenoiseReport::reset()
+{
+    _snapshots.clear();
+}
+
+
+void DenoiseReport::addPass( int numPasses, const float* accum, const float* denoised,
+                             int numPixels, double denoiseMS )
+{
+    for( int i = 0; i < numReportCheckpoints; i++ )
+    {
+        if( numPasses != reportCheckpoints[i] )
+            continue;
+
+        Snapshot snapshot;
+        snapshot.numPasses = numPasses;
+        snapshot.denoiseMS = denoiseMS;
+        snapshot.noisy.assign( accum, accum + numPixels*4 );
+        snapshot.denoised.assign( denoised, denoised + numPixels*4 );
+        _snapshots.push_back( snapshot );
+    }
+}
+
+
+void DenoiseReport::print( const float* convergedAccum, int numPixels )
+{
+    if( _snapshots.empty() )
+        return;
+
+    printf( "denoiser error vs. the converged image (relative RMS):\n" );
+    printf( "%8s %10s %10s %10s\n", "passes", "noisy", "denoised", "time (ms)" );
+
+    for( size_t s = 0; s < _snapshots.size(); s++ )
+    {
+        const Snapshot& snapshot = _snapshots[s];
+        if( (int)snapshot.noisy.size() != numPixels*4 )
+            continue;
+
+        double noisyError = 0.0, denoisedError = 0.0, referenceSum = 0.0;
+        int numCovered = 0;
+        for( int i = 0; i < numPixels; i++ )
+        {
+            const float* r = convergedAccum + i*4;
+            const float* n = &snapshot.noisy[i*4];
+            if( r[3] <= 0.f || n[3] <= 0.f )
+                continue;
+
+            for( int c = 0; c < 3; c++ )
+            {
+                double reference = r[c] / r[3];
+                double en = n[c] / n[3] - reference;
+                double ed = snapshot.denoised[i*4+c] - reference;
+                noisyError += en * en;
+                denoisedError += ed * ed;
+                referenceSum += reference;
+            }
+            numCovered++;
+        }
+
+        if( !numCovered || referenceSum <= 0.0 )
+            continue;
+
+        double mean = referenceSum / (numCovered * 3);
+        printf( "%8d %10.4f %10.4f %10.2f\n", snapshot.numPasses,
+                sqrt( noisyError / (numCovered * 3) ) / mean,
+                sqrt( denoisedError / (numCovered * 3) ) / mean,
+                snapshot.denoiseMS );
+    }
+
+    _snapshots.clear();
+}
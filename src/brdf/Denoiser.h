@@ -0,0 +1,93 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <vector>
+
+#define DENOISE_ITERATIONS 5
+
+
+/*
+Edge-aware a-trous wavelet filter (Dammertz et al. 2010) for the IBL view's
+partially converged accumulations. accum is the RGBA comp buffer (rgb summed
+over a samples) and guide holds the eye space normal and depth of each pixel;
+pixels without a normal are background and are left alone. The result is RGBA
+with the rgb averaged and a = 1 (0 for background), ready to display as is.
+
+The colour edge-stopping function is scaled by the noise level estimated from
+the image, so it loosens when there are few passes. pixelSize is the width of
+a pixel in eye space units, for the depth edge-stopping function.
+*/
+void denoiseAtrous( const float* accum, const float* guide, float* result,
+                    int width, int height, float pixelSize );
+
+
+// keeps the noisy and denoised images from a few pass counts and, once the
+// accumulation has converged, prints how far each was from it
+class DenoiseReport
+{
+public:
+    DenoiseReport();
+
+    void reset();
+    void addPass( int numPasses, const float* accum, const float* denoised,
+                  int numPixels, double denoiseMS );
+    void print( const float* convergedAccum, int numPixels );
+
+private:
+    struct Snapshot
+    {
+        int numPasses;
+        double denoiseMS;
+        std::vector<float> noisy;
+        std::vector<float> denoised;
+    };
+
+    std::vector<Snapshot> _snapshots;
+};
+
+#endif
@@ -50,16 +50,22 @@ infringement.
 #endif
 
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QWidget>
 #include <QMouseEvent>
 #include <QString>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include "ptex/Ptexture.h"
 #include "IBLWidget.h"
 #include "SimpleModel.h"
 #include "DGLFrameBuffer.h"
 #include "DGLShader.h"
+#include "SampleSequence.h"
+#include "UploadManager.h"
+#include "RenderCache.h"
 #include <string>
 #include <iostream>
 #include "Paths.h"
@@ -77,13 +83,25 @@ IBLWidget::IBLWidget(QWidget *parent, std::vector<brdfPackage> bList )
       numSampleGroupsRendered(0), renderWithIBL(false), keepAddingSamples(true),
       lastBRDFUsed(NULL), model(NULL)
 {
-    connect( this, SIGNAL(resetRenderingMode(bool)), parent, SLOT(renderingModeReset(bool)) );
+    connect( this, SIGNAL(resetRenderingMode(bool, bool)), parent, SLOT(renderingModeReset(bool, bool)) );
     comp = NULL;
     fbo = NULL;
+    resultShader = NULL;
+    compShader = NULL;
+    previewShader = NULL;
+    albedoLUT = NULL;
+    albedoLUTQuad = NULL;
+    albedoLUTDirty = true;
+
+    mSize = 0;
+    renderScale = 1;
+    interactiveRenderScale = 2;
+    interacting = false;
 
     brdfs = bList;
 
     iblRenderingMode = RENDER_IBL_IS;
+    envSamplingMode = ENV_SAMPLING_INVERSE_CDF;
 
     NEAR_PLANE = 0.01f;
     FAR_PLANE = 50.0f;
@@ -101,18 +119,22 @@ IBLWidget::IBLWidget(QWidget *parent, std::vector<brdfPackage> bList )
     totalSamples = stepSize * 15;//500
     randomizeSampleGroupOrder();
 
+    sobolTexID = 0;
+    firstPassQuery = numPassQueries = 0;
+    sampleSequence = SAMPLE_SEQUENCE_SOBOL;
+
+    denoise = false;
+    denoisedTexID = 0;
+
+    showGrid = false;
+
     updateTimer = new QTimer(this);
     connect( updateTimer, SIGNAL(timeout()), this, SLOT(updateTimerFired()) );
 
 
-    faceWidth = 128;
-    faceHeight = 128;
-    numColumns = faceWidth * 6;
-    numRows = faceHeight;
-
     quad = NULL;
 
-    envTexID = 0;
+    probeLibrary = NULL;
 
     initializeGL();
 }
@@ -123,6 +145,15 @@ IBLWidget::~IBLWidget()
     glcontext->makeCurrent(this);
     delete model;
     delete quad;
+    delete probeLibrary;
+    delete previewShader;
+    delete albedoLUT;
+    delete albedoLUTQuad;
+    if( sobolTexID )
+        glf->glDeleteTextures( 1, &sobolTexID );
+    if( denoisedTexID )
+        glf->glDeleteTextures( 1, &denoisedTexID );
+    glf->glDeleteQueries( PASS_TIMER_QUERIES, passQueries );
 }
 
 
@@ -157,6 +188,22 @@ void IBLWidget::randomizeSampleGroupOrder()
 }
 
 
+void IBLWidget::createSobolTexture()
+{
+    std::vector<unsigned int> points( totalSamples * 2 );
+    generateSobol2D( &points[0], totalSamples );
+
+    glf->glGenTextures( 1, &sobolTexID );
+    glf->glBindTexture( GL_TEXTURE_2D, sobolTexID );
+    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RG32UI, totalSamples, 1, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, &points[0] );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+
+    CKGL();
+}
+
+
 
 QSize IBLWidget::minimumSizeHint() const
 {
@@ -173,24 +220,35 @@ void IBLWidget::initializeGL()
     glcontext->makeCurrent(this);
 
     model = new SimpleModel();
+    probeLibrary = new ProbeLibrary();
+
+    // probes and measured BRDFs stream in after they're loaded
+    connect( UploadManager::instance(), SIGNAL(uploadsCompleted()), this, SLOT(uploadsCompleted()) );
 
     loadIBL( (getProbesPath() + "beach.penv").c_str() );
     loadModel( (getModelsPath() + "sphere.obj").c_str() );
+    createSobolTexture();
+    glf->glGenQueries( PASS_TIMER_QUERIES, passQueries );
 
     // load the shaders
     resultShader = new DGLShader( (getShaderTemplatesPath() + "Quad.vert").c_str(), (getShaderTemplatesPath() + "IBLResult.frag").c_str() );
     compShader = new DGLShader( (getShaderTemplatesPath() + "Quad.vert").c_str(), (getShaderTemplatesPath() + "IBLComp.frag").c_str() );
+    previewShader = new DGLShader( (getShaderTemplatesPath() + "brdfIBL.vert").c_str(), (getShaderTemplatesPath() + "IBLPreview.frag").c_str() );
 }
 
 
 
 bool IBLWidget::recreateFBO()
 {
+    int prevSize = mSize;
     mSize = width() < height() ? width() : height();
     mSize *= devicePixelRatio();
 
+    // render at reduced resolution while interacting; drawResult scales it back up
+    int renderSize = std::max( mSize / renderScale, 1 );
+
     // if the FBO is the right size, no need to create it
-    if( fbo && fbo->width() == mSize && fbo->height() == mSize )
+    if( quad && prevSize == mSize && fbo && fbo->width() == renderSize && fbo->height() == renderSize )
         return false;
 
     if(quad) delete quad;
@@ -199,15 +257,30 @@ bool IBLWidget::recreateFBO()
     if (fbo) delete fbo;
     if (comp) delete comp;
 
-    fbo = new DGLFrameBuffer( mSize, mSize, "FBO" );
+    fbo = new DGLFrameBuffer( renderSize, renderSize, "FBO" );
     fbo->addColorBuffer( 0, GL_RGBA32F );
+    fbo->addColorBuffer( 1, GL_RGBA32F );
     fbo->addDepthBuffer();
+    fbo->bind();
+    fbo->enableOutputBuffers( 0, 1 );
+    fbo->unbind();
     fbo->checkStatus();
 
-    comp = new DGLFrameBuffer( mSize, mSize, "Comp" );
+    comp = new DGLFrameBuffer( renderSize, renderSize, "Comp" );
     comp->addColorBuffer( 0, GL_RGBA32F );
     comp->checkStatus();
 
+    // the denoised result is displayed in place of comp
+    if( !denoisedTexID )
+        glf->glGenTextures( 1, &denoisedTexID );
+    glf->glBindTexture( GL_TEXTURE_2D, denoisedTexID );
+    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F, renderSize, renderSize, 0, GL_RGBA, GL_FLOAT, NULL );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+
     glf->glDisable( GL_BLEND );
     resetComps();
 
@@ -215,6 +288,43 @@ bool IBLWidget::recreateFBO()
 }
 
 
+void IBLWidget::adjustRenderScale( float passMS )
+{
+    // halving the scale quadruples the pixel count, so only step back up
+    // towards full resolution when there's plenty of room for it
+    if( passMS > INTERACTIVE_FRAME_MS && interactiveRenderScale < MAX_RENDER_SCALE )
+        interactiveRenderScale *= 2;
+    else if( passMS * 4.f < INTERACTIVE_FRAME_MS * 0.8f && interactiveRenderScale > 1 )
+        interactiveRenderScale /= 2;
+
+    renderScale = interactiveRenderScale;
+}
+
+
+void IBLWidget::readPassTimers()
+{
+    // only take the results that are already in; waiting for the GPU here
+    // would stall every frame of a drag
+    while( numPassQueries > 0 )
+    {
+        GLuint query = passQueries[firstPassQuery];
+        GLint available = 0;
+        glf->glGetQueryObjectiv( query, GL_QUERY_RESULT_AVAILABLE, &available );
+        if( !available )
+            break;
+
+        GLuint64 ns = 0;
+        glf->glGetQueryObjectui64v( query, GL_QUERY_RESULT, &ns );
+        firstPassQuery = (firstPassQuery + 1) % PASS_TIMER_QUERIES;
+        numPassQueries--;
+
+        // a timing that arrives after the drag has ended is of no use
+        if( interacting )
+            adjustRenderScale( float(ns) * 1e-6f );
+    }
+}
+
+
 void IBLWidget::setupProjectionMatrix()
 {
     float fWidth = mSize;
@@ -254,7 +364,14 @@ void IBLWidget::renderObject()
     normalMatrix = glm::inverseTranspose(glm::mat3(modelViewMatrix));
 
     if( brdfs.size() )
-        drawObject();
+    {
+        if( iblRenderingMode == RENDER_SPLIT_SUM )
+            drawObjectPreview();
+        else if( numGridTiles() > 1 )
+            drawObjectGrid();
+        else
+            drawObject( 0 );
+    }
 }
 
 void IBLWidget::paintGL()
@@ -267,14 +384,37 @@ void IBLWidget::paintGL()
     glf->glClearColor( 0, 0, 0, 0 );
     glf->glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+    // a changed render scale takes effect in recreateFBO
+    readPassTimers();
     recreateFBO();
 
+    // there's nothing to light the object with until the probe has reached
+    // the GPU; uploadsCompleted() starts the accumulation once it has
+    if( !probeLibrary->isReady( currentProbe ) )
+    {
+        glcontext->swapBuffers(this);
+        return;
+    }
+
     envRotMatrix = glm::rotate(glm::mat4(1.f), envPhi, glm::vec3(0, 1, 0));
     envRotMatrix = glm::rotate(envRotMatrix, envTheta, glm::vec3(0, 1, 0));
     envRotMatrixInverse = glm::inverse(envRotMatrix);
 
+    // a view that has converged before doesn't need rendering again
+    if( numSampleGroupsRendered == 0 )
+        loadCachedAccumulation();
+
     if( numSampleGroupsRendered < stepSize )
     {
+        if( iblRenderingMode == RENDER_SPLIT_SUM && albedoLUTDirty )
+            bakeAlbedoLUT();
+
+        // while dragging, the first pass after each move is timed on the
+        // GPU to pick the resolution of the ones that follow
+        bool timePass = interacting && numSampleGroupsRendered == 0 && numPassQueries < PASS_TIMER_QUERIES;
+        if( timePass )
+            glf->glBeginQuery( GL_TIME_ELAPSED, passQueries[(firstPassQuery + numPassQueries) % PASS_TIMER_QUERIES] );
+
         fbo->bind();
         glf->glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
         renderObject();
@@ -283,9 +423,28 @@ void IBLWidget::paintGL()
         ///////////////////////////////////////
         compResult();
 
+        if( timePass )
+        {
+            glf->glEndQuery( GL_TIME_ELAPSED );
+            numPassQueries++;
+        }
+
         // another sample group rendered!
         numSampleGroupsRendered++;
 
+        // denoising every pass would cost more than the passes themselves,
+        // so do it for the first few, every 16th, and the last one
+        if( denoiseActive() )
+        {
+            int n = numSampleGroupsRendered;
+            if( (n & (n - 1)) == 0 || n % 16 == 0 || n >= stepSize )
+                denoiseResult();
+        }
+
+        // the preview and SH diffuse are as good as they get after one pass
+        if( iblRenderingMode == RENDER_SPLIT_SUM || iblRenderingMode == RENDER_SH_DIFFUSE )
+            numSampleGroupsRendered = stepSize;
+
         if( renderWithIBL )
         {
             if( numSampleGroupsRendered < stepSize )
@@ -294,6 +453,7 @@ void IBLWidget::paintGL()
             {
                 printf( "done!\n" );
                 stopTimer();
+                storeCachedAccumulation();
             }
         }
         ///////////////////////////////////////
@@ -329,7 +489,14 @@ void IBLWidget::mousePressEvent( QMouseEvent* event )
 
 void IBLWidget::mouseReleaseEvent ( QMouseEvent* )
 {
-    //updateGL();
+    if( !interacting )
+        return;
+
+    // start over at full resolution, and with the full mesh; the passes
+    // drawn while dragging can't be part of the converged image
+    interacting = false;
+    renderScale = 1;
+    resetComps();
 }
 
 void IBLWidget::mouseMoveEvent( QMouseEvent* event )
@@ -337,6 +504,13 @@ void IBLWidget::mouseMoveEvent( QMouseEvent* event )
     int dx = event->x() - lastPos.x();
     int dy = event->y() - lastPos.y();
 
+    // drags render at reduced resolution until the button comes back up
+    if( event->buttons() & (Qt::LeftButton | Qt::RightButton) )
+    {
+        interacting = true;
+        renderScale = interactiveRenderScale;
+    }
+
     // left mouse button adjusts the viewing dir (of either the object or the envmap)
     if (event->buttons() & Qt::LeftButton)
     {
@@ -396,14 +570,47 @@ void IBLWidget::exposureChanged( float v )
     redrawAll();
 }
 
-void IBLWidget::drawObject()
+int IBLWidget::numGridTiles()
+{
+    return showGrid ? std::min( (int)brdfs.size(), MAX_GRID_TILES ) : 1;
+}
+
+
+void IBLWidget::drawObjectGrid()
+{
+    int numTiles = numGridTiles();
+    int cols = int( ceil( sqrt( double(numTiles) ) ) );
+    int rows = (numTiles + cols - 1) / cols;
+
+    // the tiles are viewports into the same fbo, so they all accumulate into
+    // comp together, on the same pass schedule
+    GLint viewport[4];
+    glf->glGetIntegerv( GL_VIEWPORT, viewport );
+    int tileSize = viewport[2] / cols;
+    int yOffset = (viewport[3] - rows * tileSize) / 2;
+
+    for( int i = 0; i < numTiles; i++ )
+    {
+        // first BRDF in the top left
+        int col = i % cols;
+        int row = rows - 1 - i / cols;
+        glf->glViewport( viewport[0] + col * tileSize, viewport[1] + yOffset + row * tileSize,
+                         tileSize, tileSize );
+        drawObject( i );
+    }
+
+    glf->glViewport( viewport[0], viewport[1], viewport[2], viewport[3] );
+}
+
+
+void IBLWidget::drawObject( int brdfIndex )
 {
     DGLShader* shader = NULL;
 
     // if there's a BRDF, the BRDF pbject sets up and enables the shader
-    if( brdfs.size() )
+    if( brdfs[brdfIndex].brdf )
     {
-        shader = brdfs[0].brdf->getUpdatedShader( SHADER_IBL, &brdfs[0] );
+        shader = brdfs[brdfIndex].brdf->getUpdatedShader( SHADER_IBL, &brdfs[brdfIndex] );
 
         if( shader )
         {
@@ -415,44 +622,129 @@ void IBLWidget::drawObject()
             shader->setUniformFloat( "gamma", gamma );
             shader->setUniformFloat( "exposure", exposure );
 
-            shader->setUniformTexture( "envCube", envTexID, GL_TEXTURE_CUBE_MAP );
+            shader->setUniformTexture( "envCube", currentProbe.envTexID, GL_TEXTURE_CUBE_MAP );
 
-            shader->setUniformTexture( "probTex", probTexID );
+            shader->setUniformTexture( "probTex", currentProbe.probTexID );
             glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
             glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-            shader->setUniformTexture( "marginalProbTex", marginalProbTexID );
+            shader->setUniformTexture( "marginalProbTex", currentProbe.marginalProbTexID );
             glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
             glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-            shader->setUniformFloat( "texDims", float(envTex.w), float(envTex.h) );
+            shader->setUniformFloat( "texDims", float(currentProbe.numColumns), float(currentProbe.numRows) );
+            shader->setUniformFloat( "envTexels", 6.f * currentProbe.faceWidth * currentProbe.faceHeight );
+            shader->setUniformFloat( "envTableLevel", float(currentProbe.tableLevel) );
+
+            shader->setUniformInt( "envSamplingMode", activeEnvSamplingMode() );
+            shader->setUniformTexture( "aliasTex", currentProbe.aliasTexID );
+            shader->setUniformTexture( "samplingPyramidTex", currentProbe.samplingPyramidTexID );
+            shader->setUniformInt( "samplingPyramidTopLevel", currentProbe.numSamplingPyramidLevels - 1 );
 
             shader->setUniformMatrix4( "envRotMatrix", glm::value_ptr(envRotMatrix) );
             shader->setUniformMatrix4( "envRotMatrixInverse", glm::value_ptr(envRotMatrixInverse) );
 
             shader->setUniformInt( "totalSamples", totalSamples );
             shader->setUniformInt( "stepSize", stepSize );
-            shader->setUniformInt( "passNumber", sampleGroupOrder[numSampleGroupsRendered] );
+            shader->setUniformInt( "sampleSequence", sampleSequence );
+            shader->setUniformTexture( "sobolTex", sobolTexID );
+
+            // Sobol passes go in order, so that the passes done so far are
+            // always a prefix of the sequence
+            if( sampleSequence == SAMPLE_SEQUENCE_SOBOL )
+                shader->setUniformInt( "passNumber", numSampleGroupsRendered );
+            else
+                shader->setUniformInt( "passNumber", sampleGroupOrder[numSampleGroupsRendered] );
 
             shader->setUniformFloat( "renderWithIBL", (renderWithIBL) ? 1.0 : 0.0 );
             shader->setUniformFloat( "useIBLImportance", bool(iblRenderingMode == RENDER_IBL_IS) ? 1.0 : 0.0 );
             shader->setUniformFloat( "useBRDFImportance", bool(iblRenderingMode == RENDER_BRDF_IS) ? 1.0 : 0.0 );
             shader->setUniformFloat( "useMIS", bool(iblRenderingMode == RENDER_MIS) ? 1.0 : 0.0 );
+
+            shader->setUniformFloat( "useSHDiffuse", bool(iblRenderingMode == RENDER_SH_DIFFUSE) ? 1.0 : 0.0 );
+            shader->setUniformFloatArray( "shIrradiance", 3, 9, currentProbe.shIrradiance );
+
+            // keeps the denoiser from blending across grid tiles
+            shader->setUniformFloat( "guideDepthOffset", float(brdfIndex) * 1000.f );
         }
     }
 
     CKGL();
 
-    model->drawVBO(shader);
+    // drags draw a coarser version of the model; accumulation is always of the full one
+    model->drawVBO(shader, interacting);
 
     CKGL();
 
     // if there was a shader, now we have to disable it
-    if( brdfs[0].brdf )
+    if( brdfs[brdfIndex].brdf )
     {
-        brdfs[0].brdf->disableShader( SHADER_IBL );
+        brdfs[brdfIndex].brdf->disableShader( SHADER_IBL );
     }
 }
 
 
+void IBLWidget::drawObjectPreview()
+{
+    previewShader->enable();
+
+    previewShader->setUniformMatrix4("projectionMatrix", glm::value_ptr(projectionMatrix));
+    previewShader->setUniformMatrix4("modelViewMatrix",  glm::value_ptr(modelViewMatrix));
+    previewShader->setUniformMatrix3("normalMatrix",  glm::value_ptr(normalMatrix));
+    previewShader->setUniformMatrix4( "envRotMatrix", glm::value_ptr(envRotMatrix) );
+
+    previewShader->setUniformTexture( "prefilteredCube", currentProbe.prefilteredTexID, GL_TEXTURE_CUBE_MAP );
+    previewShader->setUniformTexture( "irradianceCube", currentProbe.irradianceTexID, GL_TEXTURE_CUBE_MAP );
+    previewShader->setUniformFloat( "prefilteredTopLevel", float(currentProbe.numPrefilteredLevels - 1) );
+    previewShader->setUniformTexture( "albedoLUT", albedoLUT ? albedoLUT->colorBufferID() : 0 );
+
+    glf->glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+
+    CKGL();
+
+    model->drawVBO(previewShader, interacting);
+
+    CKGL();
+
+    glf->glDisable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+
+    previewShader->disable();
+}
+
+
+void IBLWidget::bakeAlbedoLUT()
+{
+    if( !brdfs.size() || !brdfs[0].brdf )
+        return;
+
+    if( !albedoLUT )
+    {
+        albedoLUT = new DGLFrameBuffer( 32, 1, "Albedo LUT" );
+        albedoLUT->addColorBuffer( 0, GL_RGBA32F );
+        albedoLUT->checkStatus();
+
+        albedoLUTQuad = new Quad( 0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f );
+    }
+
+    DGLShader* shader = brdfs[0].brdf->getUpdatedShader( SHADER_IBL_ALBEDO, &brdfs[0] );
+    if( !shader )
+        return;
+
+    glm::mat4 projection = glm::ortho( 0.f, 1.f, 0.f, 1.f );
+    glm::mat4 id(1.f);
+    shader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(projection) );
+    shader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(id) );
+    shader->setUniformInt( "numSamples", 16384 );
+
+    albedoLUT->bind();
+    glf->glDisable( GL_DEPTH_TEST );
+    albedoLUTQuad->draw( shader );
+    albedoLUT->unbind();
+
+    brdfs[0].brdf->disableShader( SHADER_IBL_ALBEDO );
+
+    albedoLUTDirty = false;
+}
+
+
 void IBLWidget::drawResult()
 {
     glf->glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
@@ -470,9 +762,9 @@ void IBLWidget::drawResult()
     glm::mat4 id(1.f);
     resultShader->setUniformMatrix4("projectionMatrix", glm::value_ptr(projectionMatrix));
     resultShader->setUniformMatrix4("modelViewMatrix",  glm::value_ptr(id));
-    resultShader->setUniformTexture( "resultTex", comp->colorBufferID() );
+    resultShader->setUniformTexture( "resultTex", denoiseActive() ? denoisedTexID : comp->colorBufferID() );
 
-    resultShader->setUniformTexture( "envCube", envTexID, GL_TEXTURE_CUBE_MAP );
+    resultShader->setUniformTexture( "envCube", currentProbe.envTexID, GL_TEXTURE_CUBE_MAP );
 
     resultShader->setUniformFloat( "gamma", gamma );
     resultShader->setUniformFloat( "exposure", exposure );
@@ -480,10 +772,10 @@ void IBLWidget::drawResult()
     resultShader->setUniformFloat( "renderWithIBL", renderWithIBL ? 1.0 : 0.0 );
     resultShader->setUniformMatrix4( "envRotMatrix", glm::value_ptr(envRotMatrix) );
 
-    resultShader->setUniformTexture( "probTex", probTexID );
+    resultShader->setUniformTexture( "probTex", currentProbe.probTexID );
     glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
     glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-    resultShader->setUniformTexture( "marginalProbTex", marginalProbTexID );
+    resultShader->setUniformTexture( "marginalProbTex", currentProbe.marginalProbTexID );
     glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
     glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 
@@ -525,6 +817,55 @@ void IBLWidget::compResult()
     comp->unbind();
 }
 
+bool IBLWidget::denoiseActive()
+{
+    // the single pass modes have no noise to take out, and while dragging
+    // every frame starts over, so the raw passes are shown instead; the
+    // accumulation is reset on release and denoised from then on
+    return denoise && renderWithIBL && !interacting &&
+           iblRenderingMode != RENDER_SPLIT_SUM && iblRenderingMode != RENDER_SH_DIFFUSE;
+}
+
+void IBLWidget::denoiseResult()
+{
+    int w = comp->width(), h = comp->height();
+    int numPixels = w * h;
+
+    denoiseAccum.resize( numPixels * 4 );
+    denoiseGuide.resize( numPixels * 4 );
+    denoised.resize( numPixels * 4 );
+
+    glf->glBindTexture( GL_TEXTURE_2D, comp->colorBufferID() );
+    glf->glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &denoiseAccum[0] );
+    glf->glBindTexture( GL_TEXTURE_2D, fbo->colorBufferID( 1 ) );
+    glf->glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &denoiseGuide[0] );
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // the object is drawn with an orthographic projection 2 units across
+    // each tile
+    int numGridCols = int( ceil( sqrt( double(numGridTiles()) ) ) );
+    denoiseAtrous( &denoiseAccum[0], &denoiseGuide[0], &denoised[0], w, h, 2.f * numGridCols / float(w) );
+
+    double denoiseMS = double(timer.nsecsElapsed()) * 1e-6;
+
+    glf->glBindTexture( GL_TEXTURE_2D, denoisedTexID );
+    glf->glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_FLOAT, &denoised[0] );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+
+    CKGL();
+
+    // keep a few of the early results around, and see how they did once
+    // the accumulation has converged
+    if( numSampleGroupsRendered == 1 )
+        denoiseReport.reset();
+    if( numSampleGroupsRendered < stepSize )
+        denoiseReport.addPass( numSampleGroupsRendered, &denoiseAccum[0], &denoised[0], numPixels, denoiseMS );
+    else
+        denoiseReport.print( &denoiseAccum[0], numPixels );
+}
+
 void IBLWidget::updateTimerFired()
 {
     if( keepAddingSamples )
@@ -542,30 +883,95 @@ void IBLWidget::stopTimer()
     updateTimer->stop();
 }
 
-void IBLWidget::keepAddingSamplesChanged(int rs)
+bool IBLWidget::accumulationIsCacheable()
 {
-    keepAddingSamples = bool(rs);
-    if(keepAddingSamples)
-        updateGL();
+    // only the sampled modes take long enough to be worth it, and only at
+    // full resolution with all the data on the GPU
+    return renderWithIBL && brdfs.size() && !interacting && renderScale == 1 &&
+           iblRenderingMode != RENDER_SPLIT_SUM && iblRenderingMode != RENDER_SH_DIFFUSE &&
+           UploadManager::instance()->isIdle();
 }
 
-void IBLWidget::createGLSamplingTextures()
+std::string IBLWidget::accumulationCacheKey()
 {
-    glf->glBindTexture( GL_TEXTURE_2D, probTexID );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, probTex.w, probTex.h, 0, GL_RED, GL_FLOAT, probTex.getPtr() );
+    RenderCacheKey key( "ibl" );
+
+    // the widget's aspect ratio changes the projection as well as the size
+    key.addInt( comp->width() );
+    key.addInt( comp->height() );
+    key.addInt( width() );
+    key.addInt( height() );
+
+    key.addInt( iblRenderingMode );
+    key.addInt( activeEnvSamplingMode() );
+    key.addInt( sampleSequence );
+    key.addInt( stepSize );
+    key.addInt( totalSamples );
+
+    key.addFile( currentProbe.filename );
+    key.addFloat( envPhi );
+    key.addFloat( envTheta );
+
+    key.addFile( modelFilename );
+    key.addFloat( lookPhi );
+    key.addFloat( lookTheta );
+    key.addFloat( lookZoom );
+
+    // the incident direction only lights the object in "No IBL" mode, which
+    // isn't cached, and gamma and exposure are applied after accumulating
+    int numTiles = numGridTiles();
+    key.addInt( numTiles );
+    for( int i = 0; i < numTiles; i++ )
+        key.addBRDFPackage( brdfs[i] );
+
+    return key.result();
+}
+
+bool IBLWidget::loadCachedAccumulation()
+{
+    if( !accumulationIsCacheable() )
+        return false;
+
+    int w = comp->width(), h = comp->height();
+    std::vector<float> pixels( size_t(w) * h * 4 );
+    if( !RenderCache::load( accumulationCacheKey(), w, h, 4 * sizeof(float), &pixels[0] ) )
+        return false;
+
+    // the comp buffer holds the sum of the passes with the count in alpha,
+    // exactly as it was stored; it's converged, so it doubles as the denoised result
+    glf->glBindTexture( GL_TEXTURE_2D, comp->colorBufferID() );
+    glf->glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_FLOAT, &pixels[0] );
+    glf->glBindTexture( GL_TEXTURE_2D, denoisedTexID );
+    glf->glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_FLOAT, &pixels[0] );
     glf->glBindTexture( GL_TEXTURE_2D, 0 );
 
-    glf->glBindTexture( GL_TEXTURE_2D, marginalProbTexID );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
-    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, marginalProbTex.w, marginalProbTex.h, 0, GL_RED, GL_FLOAT, marginalProbTex.getPtr() );
+    CKGL();
+
+    numSampleGroupsRendered = stepSize;
+    stopTimer();
+    return true;
+}
+
+void IBLWidget::storeCachedAccumulation()
+{
+    if( !accumulationIsCacheable() )
+        return;
+
+    int w = comp->width(), h = comp->height();
+    std::vector<float> pixels( size_t(w) * h * 4 );
+    glf->glBindTexture( GL_TEXTURE_2D, comp->colorBufferID() );
+    glf->glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &pixels[0] );
     glf->glBindTexture( GL_TEXTURE_2D, 0 );
+
+    if( RenderCache::store( accumulationCacheKey(), w, h, 4 * sizeof(float), &pixels[0] ) )
+        RenderCache::trim();
+}
+
+void IBLWidget::keepAddingSamplesChanged(int rs)
+{
+    keepAddingSamples = bool(rs);
+    if(keepAddingSamples)
+        updateGL();
 }
 
 void IBLWidget::loadModel( const char* filename )
@@ -573,6 +979,7 @@ void IBLWidget::loadModel( const char* filename )
     printf( "opening %s... ", filename );
     if( model ) {
         if(model->loadOBJ( filename )){
+            modelFilename = filename;
             printf( "success\n");
             return;
         }
@@ -582,141 +989,14 @@ void IBLWidget::loadModel( const char* filename )
 
 void IBLWidget::loadIBL( const char* filename )
 {
-    printf( "opening %s... ", filename );
+    QElapsedTimer timer;
+    timer.start();
 
-    // try and load it
-    Ptex::String error;
-    PtexTexture* tx = PtexTexture::open(filename, error);
-    if (!tx) {
-        printf( "failed\n");
+    // this is just a rebind if the probe is still resident
+    if( !probeLibrary->acquire( filename, currentProbe ) )
         return;
-    }
-
-    CKGL();
-
-    Ptex::DataType dataType = tx->dataType();
-    int numChannels = tx->numChannels();
-    int numFaces=tx->numFaces();
-    int faceWidth=0, faceHeight=0;
-
-    if( dataType != Ptex::dt_float || numChannels != 3 || numFaces != 6 )
-    {
-        printf( "not the right kind\n" );
-        return;
-    }
-
-    for( int i = 0; i < numFaces; i++ )
-    {
-        int face = i;
-
-
-        Ptex::Res res = tx->getFaceInfo(i).res;
-        if( i == 0 )
-        {
-            faceWidth = res.u();
-            faceHeight = res.v();
-
-            // printf( "size: %dx%d    (%dx%d)\n", faceWidth, faceHeight, faceWidth*6, faceHeight );
-
-            envTex.create( faceWidth*6, faceHeight );
-        }
-
-        if( faceWidth != res.u() || faceHeight != res.v() )
-        {
-            printf( "error loading ptex file\n" );
-            return;
-        }
-
-        float* faceData = (float*)malloc( faceWidth*faceHeight*numChannels*sizeof(float) );
-        tx->getData( i, faceData, 0 );
-
-        // copy the data into the envmap texture
-        for( int j = 0; j < faceHeight * faceWidth; j++ )
-        {
-            color3 c( faceData[j*3+0], faceData[j*3+1], faceData[j*3+2] );
-            envTex.setPixel( faceWidth*face + j % faceWidth, j / faceWidth, c );
-        }
-
-        free( faceData );
-
-    }
-    tx->release();
-    printf( "success\n");
-
-    // allocate texture names (if we haven't before)
-    if( envTexID == 0 ) {
-        glf->glGenTextures( 1, &envTexID );
-        glf->glGenTextures( 1, &probTexID );
-        glf->glGenTextures( 1, &marginalProbTexID );
-    }
-
-    CKGL();
-
-    // now that the envmap tex is loaded, compute the sampling data
-    computeEnvMapSamplingData();
-    createGLSamplingTextures();
-
-    CKGL();
-
-    glf->glGenTextures(1, &envTexID);
-    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, envTexID );
-    glf->glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-
-
-    BitmapContainer<color3> flip;
-    flip.create(envTex.w, envTex.h);//get face flipped to match GL thinking!
-    for (int y=0; y < envTex.h; y++){
-        color3* in = &envTex.data[y*envTex.w];
-        color3* out = &flip.data[(envTex.h-y-1)*envTex.w];
-        for (int x=0; x < envTex.w; x++)
-            out[x] = in[x];
-    }
-
-    BitmapContainer<color3> tmp;
-    tmp.create(envTex.h, envTex.h);
-
-    CKGL();
-
-    for (int y=0; y < tmp.h; y++)
-        for (int x=0; x < tmp.w; x++)
-            tmp.setPixel(x, y,flip.getPixel(x+tmp.w*0, y));
-    glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X , 0,GL_R11F_G11F_B10F, tmp.w, tmp.h, 0, GL_RGB, GL_FLOAT, tmp.getPtr() );
-
-
-    for (int y=0; y < tmp.h; y++)
-        for (int x=0; x < tmp.w; x++)
-            tmp.setPixel(x, y,flip.getPixel(x+tmp.w*1, y));
-    glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_NEGATIVE_X , 0,GL_R11F_G11F_B10F, tmp.w, tmp.h, 0, GL_RGB, GL_FLOAT, tmp.getPtr() );
-
-    for (int y=0; y < tmp.h; y++)
-        for (int x=0; x < tmp.w; x++)
-            tmp.setPixel(x, y,flip.getPixel(x+tmp.w*2, y));
-    glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_Y , 0,GL_R11F_G11F_B10F, tmp.w, tmp.h, 0, GL_RGB, GL_FLOAT, tmp.getPtr() );
-
-    for (int y=0; y < tmp.h; y++)
-        for (int x=0; x < tmp.w; x++)
-            tmp.setPixel(x, y,flip.getPixel(x+tmp.w*3, y));
-    glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_NEGATIVE_Y , 0,GL_R11F_G11F_B10F, tmp.w, tmp.h, 0, GL_RGB, GL_FLOAT, tmp.getPtr() );
-
-    for (int y=0; y < tmp.h; y++)
-        for (int x=0; x < tmp.w; x++)
-            tmp.setPixel(x, y,flip.getPixel(x+tmp.w*4, y));
-    glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_Z , 0,GL_R11F_G11F_B10F, tmp.w, tmp.h, 0, GL_RGB, GL_FLOAT, tmp.getPtr() );
-
 
-    CKGL();
-
-    for (int y=0; y < tmp.h; y++)
-        for (int x=0; x < tmp.w; x++)
-            tmp.setPixel(x, y,flip.getPixel(x+tmp.w*5, y));
-    glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_NEGATIVE_Z , 0,GL_R11F_G11F_B10F, tmp.w, tmp.h, 0, GL_RGB, GL_FLOAT, tmp.getPtr() );
-
-    CKGL();
-
-    glf->glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
-
-    CKGL();
+    printf( "Time to switch to probe: %lld ms\n", (long long)timer.elapsed() );
 }
 
 void IBLWidget::incidentDirectionChanged( float theta, float phi )
@@ -738,26 +1018,49 @@ void IBLWidget::brdfListChanged( std::vector<brdfPackage> brdfList )
 
     if( brdfs[0].brdf != lastBRDFUsed )
     {
-        if( brdfs[0].brdf && brdfs[0].brdf->hasISFunction() )
-            emit( resetRenderingMode(true) );
-        else
-            emit( resetRenderingMode(false) );
+        bool hasBRDFIS = brdfs[0].brdf && brdfs[0].brdf->hasISFunction();
+        bool isDiffuse = brdfs[0].brdf && brdfs[0].brdf->hasHint( "diffuse" );
+        emit( resetRenderingMode(hasBRDFIS, isDiffuse) );
     }
 
-    if( !brdfs.size() || (brdfs[0].dirty || brdfs[0].brdf != lastBRDFUsed) )
+    bool changed = !brdfs.size() || (brdfs[0].dirty || brdfs[0].brdf != lastBRDFUsed);
+
+    // in the grid, a change to any of the tiles restarts the accumulation
+    std::vector<BRDFBase*> gridBRDFs;
+    for( int i = 0; i < numGridTiles() && i < (int)brdfs.size(); i++ )
+    {
+        gridBRDFs.push_back( brdfs[i].brdf );
+        if( brdfs[i].dirty )
+            changed = true;
+    }
+    if( gridBRDFs != lastGridBRDFs )
+        changed = true;
+
+    if( changed )
     {
+        albedoLUTDirty = true;
         resetComps();
         updateGL();
-        lastBRDFUsed = brdfs[0].brdf;
+        lastBRDFUsed = brdfs.size() ? brdfs[0].brdf : NULL;
+        lastGridBRDFs = gridBRDFs;
     }
 }
 
+void IBLWidget::uploadsCompleted()
+{
+    // whatever was accumulated so far was rendered without the new data
+    albedoLUTDirty = true;
+    resetComps();
+}
+
 void IBLWidget::reloadAuxShaders()
 {
     if( resultShader )
         resultShader->reload();
     if( compShader )
         compShader->reload();
+    if( previewShader )
+        previewShader->reload();
 
     resetComps();
     updateGL();
@@ -769,102 +1072,63 @@ void IBLWidget::redrawAll()
     updateGL();
 }
 
-double IBLWidget::calculateProbs( const double* pdf, float* data, int numElements )
+int IBLWidget::activeEnvSamplingMode()
 {
-    std::vector<double> cdf(numElements);
-
-    // sum PDF
-    double pdfSum = 0;
-    for( int i = 0; i < numElements; i++ )
-        pdfSum += pdf[i];
+    // fall back to the inverse CDF if the probe can't be warped hierarchically
+    if( envSamplingMode == ENV_SAMPLING_HIERARCHICAL && currentProbe.numSamplingPyramidLevels == 0 )
+        return ENV_SAMPLING_INVERSE_CDF;
+    return envSamplingMode;
+}
 
-    if (pdfSum <= 0) {
-        // degenerate - no probability to reach this area
-        // make uniform CDF
-        double cdfScale = 1.0/numElements;
-        for( int i = 0; i < numElements; i++ ) {
-            cdf[i] = (i+1) * cdfScale;
-        }
-    }
-    else {
-        // compute the CDF based on normalized pdf
-        double cdfTotal = 0.0;
-        double cdfScale = 1/pdfSum;
-        for( int i = 0; i < numElements; i++ ) {
-            cdfTotal += pdf[i] * cdfScale;
-            cdf[i] = cdfTotal;
-        }
-    }
+void IBLWidget::renderingModeChanged( int newmode )
+{
+    iblRenderingMode = newmode;
 
-    // compute the inverse CDF
-    // (center samples between 0..1 range with implied (0,0) and (1,1) points)
-    int yi = 0;
-    double oneOverNumElements = 1.0 / numElements;
-    for( int xi = 0; xi < numElements; xi++ )
-    {
-        // find segment spanning target x value
-        double x = (xi+.5) * oneOverNumElements;
-        while( cdf[yi] < x && yi < numElements-1)
-            yi++;
-
-        // interpolate segment to get corresponding y value
-        double xa = yi > 0 ? cdf[yi-1] : 0;
-        double ya = yi * oneOverNumElements;
-        double xb = cdf[yi];
-        double yb = (yi+1) * oneOverNumElements;
-        data[xi] = float(ya + (yb-ya)/(xb-xa) * (x-xa));
-    }
+    renderWithIBL = bool(iblRenderingMode > RENDER_NO_IBL);
 
-    return pdfSum;
+    resetComps();
 }
 
-void IBLWidget::computeEnvMapSamplingData()
+void IBLWidget::mouseDoubleClickEvent ( QMouseEvent *  )
 {
-    // create the "images" to store the tex and marginal tex
-    probTex.create( envTex.w, envTex.h );
-    marginalProbTex.create( envTex.h, 1 );
+    resetViewingParams();
+    resetComps();
+    updateGL();
+}
 
-    std::vector<double> marginalPdf(envTex.h);
-    std::vector<double> conditionalPdf(envTex.w);
+void IBLWidget::envSamplingModeChanged( int newmode )
+{
+    envSamplingMode = newmode;
 
-    // loop through each of the rows in the image
-    for( int row = 0; row < envTex.h; row++ )
-    {
-        double y = (row + 0.5)/envTex.h * 2 - 1, ysquared = y*y;
+    resetComps();
+}
 
-        // loop through the pixels of this row, computing and storing a probability for each pixel
-        for( int col = 0; col < envTex.w; col++ )
-        {
-            // compute the PDF value for this pixel
-            // (compensate for cubemap distortion - see pbrt v2 pg 947)
-            double x = ((col % envTex.h) + 0.5)/envTex.h * 2 - 1, xsquared = x*x;
-            double undistort = pow(xsquared + ysquared + 1, -1.5);
-            conditionalPdf[col] = envTex.getPixel( col, row ).luminance() * undistort;
-        }
+void IBLWidget::sampleSequenceChanged( int newSequence )
+{
+    sampleSequence = newSequence;
 
-        // compute the CDF and inverse CDF for this row
-        double pdfSum = calculateProbs( &conditionalPdf[0], (float*)probTex.getPtr(row), envTex.w );
+    resetComps();
+}
 
-        // save the integral of the PDF for this row in the marginal image
-        marginalPdf[row] = pdfSum;
-    }
+void IBLWidget::denoiseChanged( int d )
+{
+    denoise = bool(d);
 
-    // compute the CDF and inverse CDF for the marginal image
-    calculateProbs(&marginalPdf[0], (float*)marginalProbTex.getPtr(), envTex.h );
+    resetComps();
 }
 
-void IBLWidget::renderingModeChanged( int newmode )
+void IBLWidget::showGridChanged( int g )
 {
-    iblRenderingMode = newmode;
+    showGrid = bool(g);
 
-    renderWithIBL = bool(iblRenderingMode > RENDER_NO_IBL);
+    lastGridBRDFs.clear();
+    for( int i = 0; i < numGridTiles(); i++ )
+        lastGridBRDFs.push_back( brdfs[i].brdf );
 
     resetComps();
 }
 
-void IBLWidget::mouseDoubleClickEvent ( QMouseEvent *  )
+void IBLWidget::probeBudgetChanged( int megabytes )
 {
-    resetViewingParams();
-    resetComps();
-    updateGL();
+    probeLibrary->setBudget( size_t(megabytes) << 20 );
 }
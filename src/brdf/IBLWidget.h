@@ -52,6 +52,8 @@ infringement.
 #include "BRDFBase.h"
 #include "SharedContextGLWidget.h"
 #include "Quad.h"
+#include "ProbeLibrary.h"
+#include "Denoiser.h"
 
 class DGLFrameBuffer;
 class DGLShader;
@@ -63,7 +65,27 @@ class SimpleModel;
 #define RENDER_IBL_IS 2
 #define RENDER_BRDF_IS 3
 #define RENDER_MIS 4
+#define RENDER_SPLIT_SUM 5
+#define RENDER_SH_DIFFUSE 6
 
+// while the mouse is held, passes render at a fraction of the display
+// resolution, picked to keep each pass near this many milliseconds
+#define INTERACTIVE_FRAME_MS 33.f
+#define MAX_RENDER_SCALE 4
+
+// pass timings are read back from GL timer queries a frame or more after
+// they're issued; this many can be waiting at once
+#define PASS_TIMER_QUERIES 4
+
+#define ENV_SAMPLING_INVERSE_CDF 0
+#define ENV_SAMPLING_ALIAS_TABLE 1
+#define ENV_SAMPLING_HIERARCHICAL 2
+
+// the most BRDFs the comparison grid shows at once
+#define MAX_GRID_TILES 16
+
+#define SAMPLE_SEQUENCE_HAMMERSLEY 0
+#define SAMPLE_SEQUENCE_SOBOL 1
 
 
 class IBLWidget : public GLWindow
@@ -89,6 +111,12 @@ public slots:
     void updateTimerFired();
     void keepAddingSamplesChanged(int);
     void renderingModeChanged(int);
+    void envSamplingModeChanged(int);
+    void sampleSequenceChanged(int);
+    void denoiseChanged(int);
+    void showGridChanged(int);
+    void probeBudgetChanged(int);
+    void uploadsCompleted();
     
     void reloadAuxShaders();
 
@@ -101,7 +129,7 @@ protected:
     void mouseDoubleClickEvent ( QMouseEvent * event );
     
 signals:
-    void resetRenderingMode(bool);
+    void resetRenderingMode(bool, bool);
 
 private:
 
@@ -109,19 +137,35 @@ private:
 
     void setupProjectionMatrix();
     void renderObject();
-    void drawObject();
+    void drawObject( int brdfIndex );
+    void drawObjectGrid();
+    int numGridTiles();
+    void drawObjectPreview();
+    void bakeAlbedoLUT();
     void drawSphere( double, int lats, int longs );
 
     bool recreateFBO();
+    void adjustRenderScale( float passMS );
+    void readPassTimers();
 
     void drawResult();
     void compResult();
+    bool denoiseActive();
+    void denoiseResult();
     void resetComps();
 
     void startTimer();
     void stopTimer();
 
+    // converged accumulations are kept in the RenderCache, keyed by
+    // everything that went into them
+    bool accumulationIsCacheable();
+    std::string accumulationCacheKey();
+    bool loadCachedAccumulation();
+    void storeCachedAccumulation();
+
     void randomizeSampleGroupOrder();
+    void createSobolTexture();
 
     void updateEnvRot();
 
@@ -151,6 +195,17 @@ private:
     
     int mSize;
 
+    // the fbo and comp targets are mSize / renderScale on a side; the scale
+    // used while interacting is remembered between drags
+    int renderScale;
+    int interactiveRenderScale;
+    bool interacting;
+
+    // the passes being timed, oldest first, in a ring
+    GLuint passQueries[PASS_TIMER_QUERIES];
+    int firstPassQuery;
+    int numPassQueries;
+
     QPoint lastPos;
     bool tumbling;
     
@@ -168,6 +223,22 @@ private:
     DGLShader* resultShader;
     DGLShader* compShader;
 
+    // split-sum preview: the BRDF's directional albedo per view angle, baked
+    // whenever the BRDF or its parameters change
+    DGLShader* previewShader;
+    DGLFrameBuffer* albedoLUT;
+    Quad* albedoLUTQuad;
+    bool albedoLUTDirty;
+
+    // CPU denoising of the comp buffer, guided by the normals and depths
+    // rendered into the fbo's second colour buffer
+    bool denoise;
+    GLuint denoisedTexID;
+    std::vector<float> denoiseAccum;
+    std::vector<float> denoiseGuide;
+    std::vector<float> denoised;
+    DenoiseReport denoiseReport;
+
     QTimer* updateTimer;
 
     int numSampleGroupsRendered;
@@ -175,31 +246,30 @@ private:
     int stepSize;
     int totalSamples;
 
+    // the Sobol points for every sample of every pass
+    GLuint sobolTexID;
+    int sampleSequence;
+
     bool renderWithIBL;
     bool keepAddingSamples;
     BRDFBase* lastBRDFUsed;
 
-    void computeEnvMapSamplingData();
-    double calculateProbs( const double* pdf, float* data, int numElements );
-    void createGLSamplingTextures();
-
-    GLuint envTexID;
-    BitmapContainer<color3> envTex;
-
-    GLuint probTexID;
-    BitmapContainer<float> probTex;
+    // with the grid on, every BRDF in the list gets a tile of the same
+    // accumulation; these are the ones it was last started with
+    bool showGrid;
+    std::vector<BRDFBase*> lastGridBRDFs;
 
-    GLuint marginalProbTexID;
-    BitmapContainer<float> marginalProbTex;
+    int activeEnvSamplingMode();
 
-    int faceWidth;
-    int faceHeight;
-    int numColumns;
-    int numRows;
+    // the probes we've loaded, and the textures of the one being displayed
+    ProbeLibrary* probeLibrary;
+    ProbeTextures currentProbe;
     
     int iblRenderingMode;
+    int envSamplingMode;
 
     SimpleModel* model;
+    std::string modelFilename;
 };
 
 #endif
@@ -48,6 +48,9 @@ infringement.
 #include <QPushButton>
 #include <QCheckBox>
 #include <QFileDialog>
+#include <QSpinBox>
+#include <QDir>
+#include <QFileInfo>
 #include "IBLWindow.h"
 #include "IBLWidget.h"
 #include "ParameterWindow.h"
@@ -80,16 +83,63 @@ IBLWindow::IBLWindow( ParameterWindow* paramWindow )
     
     iblCombo = new QComboBox();
     iblCombo->setMinimumWidth( 100 );
-    connect( iblCombo, SIGNAL(activated(int)), glWidget, SLOT(renderingModeChanged(int)) );
+    connect( iblCombo, SIGNAL(activated(int)), this, SLOT(iblModeSelected(int)) );
     buttonLayout->addWidget( iblCombo );
+
+    QComboBox* samplingCombo = new QComboBox();
+    samplingCombo->addItem( "Inverse CDF" );
+    samplingCombo->addItem( "Alias Table" );
+    samplingCombo->addItem( "Hierarchical" );
+    samplingCombo->setToolTip( "Environment Map Importance Sampler" );
+    connect( samplingCombo, SIGNAL(activated(int)), glWidget, SLOT(envSamplingModeChanged(int)) );
+    buttonLayout->addWidget( samplingCombo );
+
+    QComboBox* sequenceCombo = new QComboBox();
+    sequenceCombo->addItem( "Hammersley" );
+    sequenceCombo->addItem( "Sobol" );
+    sequenceCombo->setCurrentIndex( SAMPLE_SEQUENCE_SOBOL );
+    sequenceCombo->setToolTip( "Sample Sequence" );
+    connect( sequenceCombo, SIGNAL(activated(int)), glWidget, SLOT(sampleSequenceChanged(int)) );
+    buttonLayout->addWidget( sequenceCombo );
     
 
     QCheckBox* keepAddingSamplesCheckbox = new QCheckBox( "Keep Sampling" );
     keepAddingSamplesCheckbox->setChecked(true);
     connect( keepAddingSamplesCheckbox, SIGNAL(stateChanged(int)), glWidget, SLOT(keepAddingSamplesChanged(int)) );
     buttonLayout->addWidget(keepAddingSamplesCheckbox);
+
+    QCheckBox* denoiseCheckbox = new QCheckBox( "Denoise" );
+    denoiseCheckbox->setChecked(false);
+    connect( denoiseCheckbox, SIGNAL(stateChanged(int)), glWidget, SLOT(denoiseChanged(int)) );
+    buttonLayout->addWidget(denoiseCheckbox);
+
+    QCheckBox* gridCheckbox = new QCheckBox( "Grid" );
+    gridCheckbox->setChecked(false);
+    gridCheckbox->setToolTip( "Show Every BRDF Side By Side" );
+    connect( gridCheckbox, SIGNAL(stateChanged(int)), glWidget, SLOT(showGridChanged(int)) );
+    buttonLayout->addWidget(gridCheckbox);
     
     
+    // the probes we know about; switching between recently used ones is cheap
+    probeCombo = new QComboBox();
+    probeCombo->setToolTip( "Environment Probe" );
+    QStringList probeNames = QDir( QString::fromStdString( getProbesPath() ) ).entryList( QStringList() << "*.penv" << "*.hdr" << "*.pfm" );
+    for( int i = 0; i < probeNames.size(); i++ )
+        addProbe( getProbesPath() + probeNames[i].toStdString() );
+    for( int i = 0; i < (int)probeFilenames.size(); i++ )
+        if( probeFilenames[i] == getProbesPath() + "beach.penv" )
+            probeCombo->setCurrentIndex( i );
+    connect( probeCombo, SIGNAL(activated(int)), this, SLOT(probeSelected(int)) );
+    buttonLayout->addWidget( probeCombo );
+
+    QSpinBox* probeBudgetSpinBox = new QSpinBox();
+    probeBudgetSpinBox->setRange( 16, 4096 );
+    probeBudgetSpinBox->setValue( 256 );
+    probeBudgetSpinBox->setSuffix( " MB" );
+    probeBudgetSpinBox->setToolTip( "GPU Memory For Resident Probes" );
+    connect( probeBudgetSpinBox, SIGNAL(valueChanged(int)), glWidget, SLOT(probeBudgetChanged(int)) );
+    buttonLayout->addWidget( probeBudgetSpinBox );
+
     // add the change probe button
     QPushButton* probeButton = new QPushButton();
     QPixmap* probePixmap = new QPixmap( (getImagesPath() + "imageSmall.png").c_str() );
@@ -127,7 +177,7 @@ IBLWindow::IBLWindow( ParameterWindow* paramWindow )
     
     setWindowTitle( "Lit Sphere" );
 
-    probeFileDialog =  new QFileDialog(this, "Open Cube Map", "", "Ptex Cube Maps (*.penv *.ptex *.ptx)");
+    probeFileDialog =  new QFileDialog(this, "Open Environment Probe", "", "Environment Probes (*.penv *.ptex *.ptx *.hdr *.pfm)");
     probeFileDialog->setFileMode(QFileDialog::ExistingFile);
 
     modelFileDialog =  new QFileDialog(this, "Open Model", "", "OBJ files (*.obj)");
@@ -143,13 +193,42 @@ void IBLWindow::loadIBLButtonClicked()
 
     if (probeFileDialog->exec()) {
         QStringList fileNames = probeFileDialog->selectedFiles();
-        if (fileNames.size() > 0)
-            glWidget->loadIBL( fileNames[0].toStdString().c_str() );
-        glWidget->redrawAll();
+        if (fileNames.size() > 0) {
+            addProbe( fileNames[0].toStdString() );
+            probeSelected( probeCombo->currentIndex() );
+        }
     }
 }
 
 
+void IBLWindow::probeSelected( int index )
+{
+    if( !glWidget || index < 0 || index >= (int)probeFilenames.size() )
+        return;
+
+    glWidget->loadIBL( probeFilenames[index].c_str() );
+    glWidget->redrawAll();
+}
+
+
+void IBLWindow::addProbe( const std::string& filename )
+{
+    // select it if it's already in the list
+    for( int i = 0; i < (int)probeFilenames.size(); i++ )
+    {
+        if( probeFilenames[i] == filename )
+        {
+            probeCombo->setCurrentIndex( i );
+            return;
+        }
+    }
+
+    probeFilenames.push_back( filename );
+    probeCombo->addItem( QFileInfo( QString::fromStdString( filename ) ).completeBaseName() );
+    probeCombo->setCurrentIndex( probeCombo->count() - 1 );
+}
+
+
 
 void IBLWindow::loadModelButtonClicked()
 {
@@ -165,35 +244,50 @@ void IBLWindow::loadModelButtonClicked()
 }
 
 
-void IBLWindow::renderingModeReset( bool hasBRDFIS )
+void IBLWindow::renderingModeReset( bool hasBRDFIS, bool isDiffuse )
 {      
-    int prevCurIndex = iblCombo->currentIndex();
+    int prevMode = iblCombo->currentIndex() >= 0 ? iblCombo->itemData( iblCombo->currentIndex() ).toInt() : -1;
     
+    // the item data is the rendering mode, since not every mode is always listed
     iblCombo->clear();
-    iblCombo->addItem( "No IBL" );
-    iblCombo->addItem( "IBL: No IS" );
-    iblCombo->addItem( "IBL: IBL IS" );
+    iblCombo->addItem( "No IBL", RENDER_NO_IBL );
+    iblCombo->addItem( "IBL: No IS", RENDER_REGULAR_SAMPLING );
+    iblCombo->addItem( "IBL: IBL IS", RENDER_IBL_IS );
     
     if( hasBRDFIS )
     {
-        iblCombo->addItem( "IBL: BRDF IS" );
-        iblCombo->addItem( "IBL: MIS" );
+        iblCombo->addItem( "IBL: BRDF IS", RENDER_BRDF_IS );
+        iblCombo->addItem( "IBL: MIS", RENDER_MIS );
     }
+
+    iblCombo->addItem( "IBL: Preview", RENDER_SPLIT_SUM );
+
+    // BRDFs hinted as diffuse can be lit by the probe's SH irradiance
+    if( isDiffuse )
+        iblCombo->addItem( "IBL: SH Diffuse", RENDER_SH_DIFFUSE );
    
     // make sure the previous mode is available with the new brdf
-    if( prevCurIndex >= 0 && prevCurIndex < iblCombo->count() )
+    int prevIndex = iblCombo->findData( prevMode );
+    if( prevIndex >= 0 )
     {
-        iblCombo->setCurrentIndex( prevCurIndex );
+        iblCombo->setCurrentIndex( prevIndex );
     }
     else
     {
         // if it's not, set the mode to regular IBL sampling
-        iblCombo->setCurrentIndex( RENDER_REGULAR_SAMPLING );
+        iblCombo->setCurrentIndex( iblCombo->findData( RENDER_REGULAR_SAMPLING ) );
         glWidget->renderingModeChanged( RENDER_REGULAR_SAMPLING );
     }
 }
 
 
+void IBLWindow::iblModeSelected( int index )
+{
+    if( glWidget && index >= 0 )
+        glWidget->renderingModeChanged( iblCombo->itemData( index ).toInt() );
+}
+
+
 void IBLWindow::setShowing( bool s )
 {
     if( glWidget ){
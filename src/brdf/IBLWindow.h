@@ -47,6 +47,8 @@ infringement.
 #define IBLWINDOW_H
 
 #include <QWidget>
+#include <string>
+#include <vector>
 #include "IBLWidget.h"
 #include "ShowingBase.h"
 
@@ -69,15 +71,21 @@ public:
 
 public slots:
     void loadIBLButtonClicked();
+    void probeSelected(int);
     void loadModelButtonClicked();
-    void renderingModeReset( bool hasBRDFIS );
+    void renderingModeReset( bool hasBRDFIS, bool isDiffuse );
+    void iblModeSelected(int);
 
 protected:
     void setShowing( bool s );
 
 private:
 
+    void addProbe( const std::string& filename );
+
     QComboBox* iblCombo;
+    QComboBox* probeCombo;
+    std::vector<std::string> probeFilenames;
     IBLWidget* glWidget;
     QFileDialog* probeFileDialog;
     QFileDialog* modelFileDialog;
@@ -0,0 +1,364 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#include "LatLongImage.h"
+#include "ParallelFor.h"
+
+
+static std::string lowercaseExtension( const char* filename )
+{
+    std::string name( filename );
+    size_t dot = name.rfind( '.' );
+    if( dot == std::string::npos )
+        return "";
+
+    std::string ext = name.substr( dot + 1 );
+    std::transform( ext.begin(), ext.end(), ext.begin(), ::tolower );
+    return ext;
+}
+
+
+LatLongImage::LatLongImage()
+    : _width(0), _height(0)
+{
+}
+
+
+bool LatLongImage::canLoad( const char* filename )
+{
+    std::string ext = lowercaseExtension( filename );
+    return ext == "hdr" || ext == "pfm";
+}
+
+
+bool LatLongImage::load( const char* filename )
+{
+    std::string ext = lowercaseExtension( filename );
+    if( ext == "hdr" )
+        return loadHDR( filename );
+    if( ext == "pfm" )
+        return loadPFM( filename );
+    return false;
+}
+
+
+// reads one line of a text header, without the newline
+static bool readLine( FILE* f, std::string& line )
+{
+    line.clear();
+    int c;
+    while( (c = fgetc( f )) != EOF && c != '\n' )
+        line += char(c);
+    return c != EOF || !line.empty();
+}
+
+
+static void rgbeToFloat( const unsigned char* rgbe, float* rgb )
+{
+    if( rgbe[3] == 0 )
+    {
+        rgb[0] = rgb[1] = rgb[2] = 0.f;
+        return;
+    }
+
+    float f = ldexpf( 1.f, int(rgbe[3]) - (128 + 8) );
+    rgb[0] = rgbe[0] * f;
+    rgb[1] = rgbe[1] * f;
+    rgb[2] = rgbe[2] * f;
+}
+
+
+bool LatLongImage::loadHDR( const char* filename )
+{
+    FILE* f = fopen( filename, "rb" );
+    if( !f )
+        return false;
+
+    std::string line;
+    if( !readLine( f, line ) || (line.compare( 0, 10, "#?RADIANCE" ) && line.compare( 0, 6, "#?RGBE" )) )
+    {
+        printf( "%s isn't a Radiance file\n", filename );
+        fclose( f );
+        return false;
+    }
+
+    // the rest of the header runs to an empty line
+    while( readLine( f, line ) && !line.empty() )
+    {
+        if( !line.compare( 0, 7, "FORMAT=" ) && line != "FORMAT=32-bit_rle_rgbe" )
+        {
+            printf( "%s: unsupported format %s\n", filename, line.c_str() + 7 );
+            fclose( f );
+            return false;
+        }
+    }
+
+    int w = 0, h = 0;
+    if( !readLine( f, line ) || sscanf( line.c_str(), "-Y %d +X %d", &h, &w ) != 2 || w <= 0 || h <= 0 )
+    {
+        printf( "%s: only -Y +X images are supported\n", filename );
+        fclose( f );
+        return false;
+    }
+
+    _width = w;
+    _height = h;
+    _pixels.resize( size_t(w) * h * 3 );
+
+    std::vector<unsigned char> scanline( w * 4 );
+    for( int y = 0; y < h; y++ )
+    {
+        unsigned char start[4];
+        if( fread( start, 1, 4, f ) != 4 )
+        {
+            printf( "%s: file is truncated\n", filename );
+            fclose( f );
+            return false;
+        }
+
+        // new-style run-length encoding: each of the four components is
+        // stored separately as runs and literals
+        if( w >= 8 && w < 32768 && start[0] == 2 && start[1] == 2 && ((start[2] << 8) | start[3]) == w )
+        {
+            bool ok = true;
+            for( int c = 0; c < 4 && ok; c++ )
+            {
+                int x = 0;
+                while( x < w && ok )
+                {
+                    int count = fgetc( f );
+                    if( count == EOF )
+                    {
+                        ok = false;
+                        break;
+                    }
+
+                    if( count > 128 )
+                    {
+                        count -= 128;
+                        int value = fgetc( f );
+                        ok = value != EOF && x + count <= w;
+                        for( int i = 0; i < count && ok; i++ )
+                            scanline[(x++)*4 + c] = (unsigned char)value;
+                    }
+                    else
+                    {
+                        ok = count > 0 && x + count <= w;
+                        for( int i = 0; i < count && ok; i++ )
+                        {
+                            int value = fgetc( f );
+                            ok = value != EOF;
+                            scanline[(x++)*4 + c] = (unsigned char)value;
+                        }
+                    }
+                }
+            }
+
+            if( !ok )
+            {
+                printf( "%s: bad scanline %d\n", filename, y );
+                fclose( f );
+                return false;
+            }
+        }
+
+        // otherwise the pixels are stored flat
+        else
+        {
+            memcpy( &scanline[0], start, 4 );
+            if( fread( &scanline[4], 4, w - 1, f ) != size_t(w - 1) )
+            {
+                printf( "%s: file is truncated\n", filename );
+                fclose( f );
+                return false;
+            }
+        }
+
+        float* row = &_pixels[size_t(y) * w * 3];
+        for( int x = 0; x < w; x++ )
+            rgbeToFloat( &scanline[x*4], row + x*3 );
+    }
+
+    fclose( f );
+    return true;
+}
+
+
+bool LatLongImage::loadPFM( const char* filename )
+{
+    FILE* f = fopen( filename, "rb" );
+    if( !f )
+        return false;
+
+    // "PF" is colour, "Pf" greyscale; then the size, and a scale whose sign
+    // gives the byte order
+    char type[3] = { 0, 0, 0 };
+    int w = 0, h = 0;
+    float scale = 0.f;
+    if( fscanf( f, "%2s %d %d %f", type, &w, &h, &scale ) != 4 ||
+        (strcmp( type, "PF" ) && strcmp( type, "Pf" )) || w <= 0 || h <= 0 )
+    {
+        printf( "%s isn't a PFM file\n", filename );
+        fclose( f );
+        return false;
+    }
+
+    // exactly one whitespace character separates the header from the data
+    fgetc( f );
+
+    int numChannels = type[1] == 'F' ? 3 : 1;
+    std::vector<float> data( size_t(w) * h * numChannels );
+    if( fread( &data[0], sizeof(float), data.size(), f ) != data.size() )
+    {
+        printf( "%s: file is truncated\n", filename );
+        fclose( f );
+        return false;
+    }
+    fclose( f );
+
+    // swap the bytes if the file's order isn't ours
+    unsigned int one = 1;
+    bool littleEndian = *(unsigned char*)&one == 1;
+    if( (scale < 0.f) != littleEndian )
+    {
+        for( size_t i = 0; i < data.size(); i++ )
+        {
+            unsigned char* b = (unsigned char*)&data[i];
+            std::swap( b[0], b[3] );
+            std::swap( b[1], b[2] );
+        }
+    }
+
+    // PFM rows go from the bottom up
+    _width = w;
+    _height = h;
+    _pixels.resize( size_t(w) * h * 3 );
+    for( int y = 0; y < h; y++ )
+    {
+        const float* src = &data[size_t(h - 1 - y) * w * numChannels];
+        float* dst = &_pixels[size_t(y) * w * 3];
+        for( int x = 0; x < w; x++ )
+            for( int c = 0; c < 3; c++ )
+                dst[x*3 + c] = src[x*numChannels + (numChannels == 3 ? c : 0)];
+    }
+
+    return true;
+}
+
+
+int LatLongImage::cubeFaceSize() const
+{
+    // a face spans a quarter of the way around the equator
+    int faceSize = 1;
+    while( faceSize * 4 < _width )
+        faceSize *= 2;
+    return faceSize;
+}
+
+
+void LatLongImage::toCubeStrip( float* strip, int faceSize ) const
+{
+    int stripWidth = faceSize * 6;
+    float invFaceSize = 1.f / float(faceSize);
+
+    // one strip row (all six faces) per work item
+    parallelFor( 0, faceSize, [&]( int y )
+    {
+        float tc = 2.f * (float(y) + 0.5f) * invFaceSize - 1.f;
+        float* row = strip + size_t(y) * stripWidth * 3;
+
+        for( int face = 0; face < 6; face++ )
+        {
+            for( int x = 0; x < faceSize; x++ )
+            {
+                float sc = 2.f * (float(x) + 0.5f) * invFaceSize - 1.f;
+
+                // GL cube map face directions
+                float dx, dy, dz;
+                switch( face )
+                {
+                    case 0:  dx =  1.f; dy = -tc; dz = -sc; break;
+                    case 1:  dx = -1.f; dy = -tc; dz =  sc; break;
+                    case 2:  dx =  sc;  dy = 1.f; dz =  tc; break;
+                    case 3:  dx =  sc;  dy = -1.f; dz = -tc; break;
+                    case 4:  dx =  sc;  dy = -tc; dz = 1.f; break;
+                    default: dx = -sc;  dy = -tc; dz = -1.f; break;
+                }
+
+                // to continuous pixel coordinates in the lat-long image
+                float len = sqrtf( dx*dx + dy*dy + dz*dz );
+                float u = (atan2f( dx, -dz ) * float(0.5 / M_PI) + 0.5f) * _width - 0.5f;
+                float v = acosf( std::max( -1.f, std::min( 1.f, dy / len ) ) ) * float(1.0 / M_PI) * _height - 0.5f;
+
+                // bilinear, wrapping around in u and clamping in v
+                float fu = floorf( u ), fv = floorf( v );
+                float au = u - fu, av = v - fv;
+                int u0 = int(fu), v0 = int(fv);
+                int u1 = u0 + 1, v1 = v0 + 1;
+                u0 = (u0 % _width + _width) % _width;
+                u1 = (u1 % _width + _width) % _width;
+                v0 = std::max( v0, 0 );
+                v1 = std::min( v1, _height - 1 );
+
+                const float* p00 = &_pixels[(size_t(v0) * _width + u0) * 3];
+                const float* p10 = &_pixels[(size_t(v0) * _width + u1) * 3];
+                const float* p01 = &_pixels[(size_t(v1) * _width + u0) * 3];
+                const float* p11 = &_pixels[(size_t(v1) * _width + u1) * 3];
+
+                float w00 = (1.f - au) * (1.f - av), w10 = au * (1.f - av);
+                float w01 = (1.f - au) * av,         w11 = au * av;
+
+                float* out = row + (face * faceSize + x) * 3;
+                for( int c = 0; c < 3; c++ )
+                    out[c] = p00[c]*w00 + p10[c]*w10 + p01[c]*w01 + p11[c]*w11;
+            }
+        }
+    });
+}
@@ -0,0 +1,94 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef LAT_LONG_IMAGE_H
+#define LAT_LONG_IMAGE_H
+
+#include <vector>
+
+
+/*
+Loader for latitude-longitude environment maps in Radiance .hdr (RGBE, flat or
+run-length encoded, -Y +X orientation) and PFM form, and the resampler that
+turns them into the cube face strip the ProbeCache stores.
+
+The image rows go from straight up (+Y) to straight down, and the left edge of
+the image faces -Z, turning towards +X.
+*/
+
+class LatLongImage
+{
+public:
+    LatLongImage();
+
+    // loads a .hdr or .pfm file, depending on the extension
+    bool load( const char* filename );
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    // resamples the image bilinearly into a strip of six faceSize x faceSize
+    // cube faces (px nx py ny pz nz) with rows in GL order, in parallel
+    void toCubeStrip( float* strip, int faceSize ) const;
+
+    // the face size to convert to: the smallest power of two that doesn't
+    // lose resolution around the equator
+    int cubeFaceSize() const;
+
+    // true if the filename looks like something load() can read
+    static bool canLoad( const char* filename );
+
+private:
+    bool loadHDR( const char* filename );
+    bool loadPFM( const char* filename );
+
+    int _width;
+    int _height;
+
+    // rgb, top row first
+    std::vector<float> _pixels;
+};
+
+#endif
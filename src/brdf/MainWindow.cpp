@@ -56,6 +56,7 @@ infringement.
 #include "IBLWindow.h"
 #include "ShowingDockWidget.h"
 #include "ViewerWindow.h"
+#include "UploadManager.h"
 
 
 
@@ -89,6 +90,10 @@ MainWindow::MainWindow()
 
     imageSlice = new ImageSliceWindow( paramWnd );
 
+    // measured BRDFs draw as black until their data has streamed in, so
+    // redraw everything when it has
+    connect( UploadManager::instance(), SIGNAL(uploadsCompleted()), paramWnd, SLOT(emitBRDFListChanged()) );
+
     
     
     
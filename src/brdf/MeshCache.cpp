@@ -0,0 +1,165 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <string.h>
+#include "MeshCache.h"
+#include "Paths.h"
+#include "PackedVertices.h"
+
+
+#define MESH_CACHE_MAGIC "BRDFMSH"
+#define MESH_CACHE_VERSION 3
+
+
+MeshCache::MeshCache()
+{
+}
+
+
+MeshCache::~MeshCache()
+{
+    close();
+}
+
+
+void MeshCache::close()
+{
+    _cache.close();
+}
+
+
+bool MeshCache::sourceIdentity( const char* objFilename, quint64& size, qint64& modified )
+{
+    QFileInfo info( objFilename );
+    if( !info.exists() )
+        return false;
+
+    size = info.size();
+    modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+
+std::string MeshCache::cacheFilename( const char* objFilename )
+{
+    // named after where the OBJ lives; its size and date say whether it's still the same
+    QString path = QFileInfo( objFilename ).absoluteFilePath();
+    QByteArray hash = QCryptographicHash::hash( path.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+    return getCachePath() + std::string( hash.constData(), 16 ) + ".mesh";
+}
+
+
+bool MeshCache::open( const char* objFilename, bool unitized )
+{
+    close();
+
+    quint64 sourceSize;
+    qint64 sourceModified;
+    if( !sourceIdentity( objFilename, sourceSize, sourceModified ) )
+        return false;
+
+    if( !_cache.open( cacheFilename( objFilename ), MESH_CACHE_MAGIC, MESH_CACHE_VERSION, sizeof(MeshCacheHeader) ) )
+        return false;
+
+    const MeshCacheHeader& h = header();
+    if( h.sourceSize != sourceSize || h.sourceModified != sourceModified ||
+        h.unitized != (unitized ? 1u : 0u) || h.totalSize != _cache.size() ||
+        !sectionsInBounds() )
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool MeshCache::sectionsInBounds()
+{
+    // a corrupt header mustn't send the vertex or index pointers past the end of the mapping
+    const MeshCacheHeader& h = header();
+    if( (h.positionFormat != PACKED_POSITION_FLOAT && h.positionFormat != PACKED_POSITION_HALF) ||
+        h.vertexStride != (quint32)PackedVertices::stride( h.positionFormat ) ||
+        (h.indexSize != 2 && h.indexSize != 4) )
+        return false;
+
+    return _cache.sectionFits( h.vertexOffset, quint64(h.vertexStride) * h.numVertices ) &&
+           _cache.sectionFits( h.indexOffset, quint64(h.indexSize) * 3 * h.numTriangles );
+}
+
+
+void MeshCache::allocate( const char* objFilename, bool unitized, int positionFormat, int numVertices, int numTriangles )
+{
+    close();
+
+    MeshCacheHeader hdr;
+    memset( &hdr, 0, sizeof(hdr) );
+    strncpy( hdr.magic, MESH_CACHE_MAGIC, sizeof(hdr.magic) );
+    hdr.version = MESH_CACHE_VERSION;
+    hdr.numVertices = numVertices;
+    hdr.numTriangles = numTriangles;
+    hdr.indexSize = numVertices <= 65536 ? 2 : 4;
+    hdr.unitized = unitized ? 1 : 0;
+    hdr.positionFormat = positionFormat;
+    hdr.vertexStride = PackedVertices::stride( positionFormat );
+    sourceIdentity( objFilename, hdr.sourceSize, hdr.sourceModified );
+
+    // the sections follow the header one after the other
+    CacheFileLayout layout( sizeof(MeshCacheHeader) );
+    hdr.vertexOffset = layout.addSection( hdr.vertexStride * quint64(numVertices) );
+    hdr.indexOffset = layout.addSection( hdr.indexSize * 3 * quint64(numTriangles) );
+    hdr.totalSize = layout.size();
+
+    _cache.allocate( cacheFilename( objFilename ), &hdr, sizeof(hdr), hdr.totalSize );
+}
+
+
+bool MeshCache::save()
+{
+    return _cache.save();
+}
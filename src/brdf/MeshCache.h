@@ -0,0 +1,132 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <QtGlobal>
+#include "CacheFile.h"
+
+/*
+MeshCache keeps a binary copy of a model after its OBJ has been parsed,
+indexed and reordered, so loading the same model again maps the copy and
+uploads it to the VBOs without going near the parser.
+
+A cache file is named after the OBJ's absolute path and checked against the
+OBJ's size and modification time. After the header come the arrays exactly
+as SimpleModel uploads them:
+
+    - the vertices, interleaved in one of the PackedVertices layouts
+    - the triangle indices, 16 or 32 bits each
+
+The bounds of the source positions are kept in the header, since the
+positions themselves are stored after unitizing (if asked for).
+*/
+
+// starts out like CacheFileHeader
+struct MeshCacheHeader
+{
+    char    magic[8];
+    quint32 version;
+
+    quint32 numVertices;
+    quint32 numTriangles;
+    quint32 indexSize;
+    quint32 unitized;
+    quint32 positionFormat;
+    quint32 vertexStride;
+
+    float   boundsMin[3];
+    float   boundsMax[3];
+
+    // identity of the source file
+    quint64 sourceSize;
+    qint64  sourceModified;
+
+    // byte offsets of the different sections, from the start of the file
+    quint64 vertexOffset;
+    quint64 indexOffset;
+    quint64 totalSize;
+};
+
+
+class MeshCache
+{
+public:
+    MeshCache();
+    ~MeshCache();
+
+    // maps the cached copy of the given OBJ, if there is an up-to-date one
+    bool open( const char* objFilename, bool unitized );
+
+    // sets up an empty in-memory copy with the correct layout for the given sizes
+    void allocate( const char* objFilename, bool unitized, int positionFormat, int numVertices, int numTriangles );
+
+    // writes the in-memory copy into the cache directory
+    bool save();
+
+    // unmaps or frees the data
+    void close();
+
+    bool isValid() const { return _cache.isValid(); }
+
+    MeshCacheHeader& header() { return *(MeshCacheHeader*)_cache.data(); }
+
+    // pointers to the different sections. Data from a mapped file is read-only.
+    void* vertices()    { return _cache.data() + header().vertexOffset; }
+    void* indices()     { return _cache.data() + header().indexOffset; }
+
+private:
+    bool sectionsInBounds();
+
+    static bool sourceIdentity( const char* objFilename, quint64& size, qint64& modified );
+    static std::string cacheFilename( const char* objFilename );
+
+    CacheFile _cache;
+};
+
+#endif
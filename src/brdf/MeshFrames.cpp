@@ -0,0 +1,297 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "MeshFrames.h"
+#include "ParallelFor.h"
+
+
+// triangles and corners are handed to the threads this many at a time
+#define FRAME_BLOCK_SIZE 4096
+
+
+struct vec3f
+{
+    vec3f() : x(0.f), y(0.f), z(0.f) {}
+    vec3f( float ix, float iy, float iz ) : x(ix), y(iy), z(iz) {}
+    vec3f( const float* v ) : x(v[0]), y(v[1]), z(v[2]) {}
+
+    vec3f operator+( const vec3f& b ) const { return vec3f( x + b.x, y + b.y, z + b.z ); }
+    vec3f operator-( const vec3f& b ) const { return vec3f( x - b.x, y - b.y, z - b.z ); }
+    vec3f operator*( float s ) const { return vec3f( x * s, y * s, z * s ); }
+
+    float dot( const vec3f& b ) const { return x*b.x + y*b.y + z*b.z; }
+    vec3f cross( const vec3f& b ) const { return vec3f( y*b.z - z*b.y, z*b.x - x*b.z, x*b.y - y*b.x ); }
+    float length() const { return sqrtf( dot( *this ) ); }
+
+    // zero vectors stay zero
+    vec3f normalized() const
+    {
+        float len = length();
+        return len > 0.f ? *this * (1.f / len) : vec3f();
+    }
+
+    float x, y, z;
+};
+
+
+template <typename Func>
+static void parallelForBlocks( int count, Func func )
+{
+    int numBlocks = (count + FRAME_BLOCK_SIZE - 1) / FRAME_BLOCK_SIZE;
+    parallelFor( 0, numBlocks, [&]( int b )
+    {
+        int end = std::min( (b + 1) * FRAME_BLOCK_SIZE, count );
+        for( int i = b * FRAME_BLOCK_SIZE; i < end; i++ )
+            func( i );
+    });
+}
+
+
+// the corners using each position: cornersOfPosition[firstCorner[p] .. firstCorner[p+1])
+static void buildPositionCorners( const int* triPositions, int numPositions, int numCorners,
+                                  std::vector<int>& firstCorner, std::vector<int>& cornersOfPosition )
+{
+    firstCorner.assign( numPositions + 1, 0 );
+    for( int c = 0; c < numCorners; c++ )
+        firstCorner[triPositions[c] + 1]++;
+    for( int p = 0; p < numPositions; p++ )
+        firstCorner[p + 1] += firstCorner[p];
+
+    std::vector<int> fill( firstCorner.begin(), firstCorner.end() - 1 );
+    cornersOfPosition.resize( numCorners );
+    for( int c = 0; c < numCorners; c++ )
+        cornersOfPosition[fill[triPositions[c]]++] = c;
+}
+
+
+// the angle of every triangle at each of its corners
+static void computeCornerAngles( const float* positions, const int* triPositions,
+                                 int numTriangles, std::vector<float>& cornerAngles )
+{
+    cornerAngles.resize( numTriangles * 3 );
+    parallelForBlocks( numTriangles, [&]( int t )
+    {
+        for( int i = 0; i < 3; i++ )
+        {
+            vec3f p( positions + triPositions[t*3 + i] * 3 );
+            vec3f e1 = (vec3f( positions + triPositions[t*3 + (i+1)%3] * 3 ) - p).normalized();
+            vec3f e2 = (vec3f( positions + triPositions[t*3 + (i+2)%3] * 3 ) - p).normalized();
+            cornerAngles[t*3 + i] = acosf( std::max( -1.f, std::min( 1.f, e1.dot( e2 ) ) ) );
+        }
+    });
+}
+
+
+void computeSmoothNormals( const float* positions, int numPositions, const int* triPositions,
+                           int numTriangles, float creaseDegrees, float* cornerNormals )
+{
+    int numCorners = numTriangles * 3;
+
+    // the cross product's length is twice the triangle's area, which is the
+    // area weighting
+    std::vector<vec3f> areaNormals( numTriangles ), faceNormals( numTriangles );
+    parallelForBlocks( numTriangles, [&]( int t )
+    {
+        vec3f p0( positions + triPositions[t*3 + 0] * 3 );
+        vec3f p1( positions + triPositions[t*3 + 1] * 3 );
+        vec3f p2( positions + triPositions[t*3 + 2] * 3 );
+        areaNormals[t] = (p1 - p0).cross( p2 - p0 );
+        faceNormals[t] = areaNormals[t].normalized();
+    });
+
+    std::vector<float> cornerAngles;
+    computeCornerAngles( positions, triPositions, numTriangles, cornerAngles );
+
+    std::vector<int> firstCorner, cornersOfPosition;
+    buildPositionCorners( triPositions, numPositions, numCorners, firstCorner, cornersOfPosition );
+
+    float cosCrease = cosf( creaseDegrees * float(M_PI) / 180.f );
+    parallelForBlocks( numCorners, [&]( int c )
+    {
+        int t = c / 3, p = triPositions[c];
+        const vec3f& own = faceNormals[t];
+
+        // degenerate triangles take whatever their neighbours agree on
+        bool degenerate = own.dot( own ) == 0.f;
+
+        vec3f sum;
+        for( int i = firstCorner[p]; i < firstCorner[p + 1]; i++ )
+        {
+            int other = cornersOfPosition[i];
+            if( degenerate || own.dot( faceNormals[other / 3] ) >= cosCrease )
+                sum = sum + areaNormals[other / 3] * cornerAngles[other];
+        }
+
+        vec3f n = sum.normalized();
+        if( n.dot( n ) == 0.f )
+            n = degenerate ? vec3f( 0.f, 0.f, 1.f ) : own;
+
+        cornerNormals[c*3 + 0] = n.x;
+        cornerNormals[c*3 + 1] = n.y;
+        cornerNormals[c*3 + 2] = n.z;
+    });
+}
+
+
+void computeTangents( const float* positions, int numPositions, const int* triPositions,
+                      const float* texCoords, const int* triTexCoords,
+                      const float* cornerNormals, int numTriangles, float* cornerTangents )
+{
+    int numCorners = numTriangles * 3;
+
+    // each triangle's tangent and bitangent: the directions u and v increase in
+    std::vector<vec3f> triTangents( numTriangles ), triBitangents( numTriangles );
+    std::vector<char> hasTexCoords( numTriangles, 0 );
+    if( texCoords && triTexCoords )
+    {
+        parallelForBlocks( numTriangles, [&]( int t )
+        {
+            const int* tc = triTexCoords + t*3;
+            if( tc[0] < 0 || tc[1] < 0 || tc[2] < 0 )
+                return;
+
+            vec3f p0( positions + triPositions[t*3 + 0] * 3 );
+            vec3f e1 = vec3f( positions + triPositions[t*3 + 1] * 3 ) - p0;
+            vec3f e2 = vec3f( positions + triPositions[t*3 + 2] * 3 ) - p0;
+
+            float du1 = texCoords[tc[1]*2 + 0] - texCoords[tc[0]*2 + 0];
+            float dv1 = texCoords[tc[1]*2 + 1] - texCoords[tc[0]*2 + 1];
+            float du2 = texCoords[tc[2]*2 + 0] - texCoords[tc[0]*2 + 0];
+            float dv2 = texCoords[tc[2]*2 + 1] - texCoords[tc[0]*2 + 1];
+
+            // only the directions matter, so the determinant just contributes its sign
+            float det = du1 * dv2 - du2 * dv1;
+            if( det == 0.f )
+                return;
+            float s = det > 0.f ? 1.f : -1.f;
+
+            triTangents[t] = (e1 * dv2 - e2 * dv1) * s;
+            triBitangents[t] = (e2 * du1 - e1 * du2) * s;
+            hasTexCoords[t] = 1;
+        });
+    }
+
+    std::vector<float> cornerAngles;
+    computeCornerAngles( positions, triPositions, numTriangles, cornerAngles );
+
+    std::vector<int> firstCorner, cornersOfPosition;
+    buildPositionCorners( triPositions, numPositions, numCorners, firstCorner, cornersOfPosition );
+
+    // which way round each corner's triangle is, seen along the corner's normal
+    std::vector<char> cornerFlipped( numCorners, 0 );
+    parallelForBlocks( numCorners, [&]( int c )
+    {
+        int t = c / 3;
+        vec3f n( cornerNormals + c*3 );
+        cornerFlipped[c] = n.cross( triTangents[t] ).dot( triBitangents[t] ) < 0.f;
+    });
+
+    parallelForBlocks( numCorners, [&]( int c )
+    {
+        int t = c / 3, p = triPositions[c];
+        vec3f n( cornerNormals + c*3 );
+        float* out = cornerTangents + c*4;
+
+        // the corners this one shares a vertex with all see the same set of
+        // corners here, in the same order, so they get identical tangents
+        vec3f sum;
+        if( hasTexCoords[t] )
+        {
+            for( int i = firstCorner[p]; i < firstCorner[p + 1]; i++ )
+            {
+                int other = cornersOfPosition[i];
+                if( !hasTexCoords[other / 3] || triTexCoords[other] != triTexCoords[c] ||
+                    cornerFlipped[other] != cornerFlipped[c] ||
+                    memcmp( cornerNormals + other*3, cornerNormals + c*3, 3 * sizeof(float) ) )
+                    continue;
+
+                const vec3f& tangent = triTangents[other / 3];
+                sum = sum + (tangent - n * n.dot( tangent )).normalized() * cornerAngles[other];
+            }
+        }
+
+        vec3f tangent = sum.normalized();
+        if( tangent.dot( tangent ) == 0.f )
+        {
+            float u[3], v[3];
+            tangentFrame( cornerNormals + c*3, u, v );
+            out[0] = u[0]; out[1] = u[1]; out[2] = u[2];
+            out[3] = 1.f;
+            return;
+        }
+
+        out[0] = tangent.x;
+        out[1] = tangent.y;
+        out[2] = tangent.z;
+        out[3] = cornerFlipped[c] ? -1.f : 1.f;
+    });
+}
+
+
+void tangentFrame( const float* n, float* u, float* v )
+{
+    float a[3] = { 1.f, 0.f, 0.f };
+    if( fabsf( n[0] ) >= 0.999f )
+    {
+        a[0] = 0.f;
+        a[1] = 1.f;
+    }
+
+    u[0] = n[1]*a[2] - n[2]*a[1];
+    u[1] = n[2]*a[0] - n[0]*a[2];
+    u[2] = n[0]*a[1] - n[1]*a[0];
+    float len = sqrtf( u[0]*u[0] + u[1]*u[1] + u[2]*u[2] );
+    u[0] /= len; u[1] /= len; u[2] /= len;
+
+    v[0] = n[1]*u[2] - n[2]*u[1];
+    v[1] = n[2]*u[0] - n[0]*u[2];
+    v[2] = n[0]*u[1] - n[1]*u[0];
+    len = sqrtf( v[0]*v[0] + v[1]*v[1] + v[2]*v[2] );
+    v[0] /= len; v[1] /= len; v[2] /= len;
+}
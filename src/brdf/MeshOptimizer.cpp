@@ -0,0 +1,251 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "MeshOptimizer.h"
+
+
+// the cache the scores model; a little bigger than most hardware's, which
+// does no harm (Forsyth's recommended tuning)
+#define VC_CACHE_SIZE 32
+#define VC_CACHE_DECAY_POWER 1.5f
+#define VC_LAST_TRIANGLE_SCORE 0.75f
+#define VC_VALENCE_BOOST_SCALE 2.0f
+#define VC_VALENCE_BOOST_POWER 0.5f
+
+
+static float vertexScore( int cachePosition, int numActiveTriangles )
+{
+    // no triangles left to draw, so it's of no use any more
+    if( numActiveTriangles == 0 )
+        return -1.f;
+
+    float score = 0.f;
+    if( cachePosition >= 0 )
+    {
+        // the triangle just drawn used these three; they get a fixed score so
+        // that the next triangle doesn't simply reuse the same edge
+        if( cachePosition < 3 )
+            score = VC_LAST_TRIANGLE_SCORE;
+        else
+        {
+            float scale = 1.f / (VC_CACHE_SIZE - 3);
+            score = powf( 1.f - (cachePosition - 3) * scale, VC_CACHE_DECAY_POWER );
+        }
+    }
+
+    // vertices with few triangles left get a boost, to finish them off
+    // rather than leave lone triangles to draw later
+    score += VC_VALENCE_BOOST_SCALE * powf( float(numActiveTriangles), -VC_VALENCE_BOOST_POWER );
+    return score;
+}
+
+
+void optimizeVertexCache( unsigned int* indices, int numTriangles, int numVertices )
+{
+    if( numTriangles == 0 )
+        return;
+
+    // the triangles using each vertex, as one array with offsets
+    std::vector<int> numActive( numVertices, 0 );
+    for( int i = 0; i < numTriangles * 3; i++ )
+        numActive[indices[i]]++;
+
+    std::vector<int> firstTriangle( numVertices + 1, 0 );
+    for( int v = 0; v < numVertices; v++ )
+        firstTriangle[v+1] = firstTriangle[v] + numActive[v];
+
+    std::vector<int> vertexTriangles( numTriangles * 3 );
+    std::vector<int> fill( firstTriangle.begin(), firstTriangle.end() - 1 );
+    for( int t = 0; t < numTriangles; t++ )
+        for( int c = 0; c < 3; c++ )
+            vertexTriangles[fill[indices[t*3+c]]++] = t;
+
+    std::vector<int> cachePosition( numVertices, -1 );
+    std::vector<float> score( numVertices );
+    for( int v = 0; v < numVertices; v++ )
+        score[v] = vertexScore( -1, numActive[v] );
+
+    std::vector<char> emitted( numTriangles, 0 );
+
+    // the extra slots hold the vertices pushed out of the cache by a triangle
+    int cache[VC_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    std::vector<unsigned int> output( numTriangles * 3 );
+    int bestTriangle = 0;
+    int nextUnemitted = 0;
+
+    for( int emittedCount = 0; emittedCount < numTriangles; emittedCount++ )
+    {
+        // nothing in the cache leads anywhere; start again from the first
+        // triangle left in the input
+        if( bestTriangle < 0 )
+        {
+            while( emitted[nextUnemitted] )
+                nextUnemitted++;
+            bestTriangle = nextUnemitted;
+        }
+
+        int t = bestTriangle;
+        const unsigned int* tri = &indices[t*3];
+        memcpy( &output[emittedCount*3], tri, 3 * sizeof(unsigned int) );
+        emitted[t] = 1;
+
+        // take the triangle out of its vertices' lists
+        for( int c = 0; c < 3; c++ )
+        {
+            int v = tri[c];
+            int* list = &vertexTriangles[firstTriangle[v]];
+            int n = numActive[v];
+            for( int i = 0; i < n; i++ )
+                if( list[i] == t )
+                {
+                    list[i] = list[n-1];
+                    break;
+                }
+            numActive[v]--;
+        }
+
+        // the triangle's vertices go to the front of the cache, and everything
+        // else moves back
+        int newCache[VC_CACHE_SIZE + 3];
+        int newCount = 0;
+        for( int c = 0; c < 3; c++ )
+            newCache[newCount++] = tri[c];
+        for( int i = 0; i < cacheCount; i++ )
+        {
+            int v = cache[i];
+            if( v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2] )
+                newCache[newCount++] = v;
+        }
+
+        // rescore everything that was or is in the cache, and their
+        // triangles, looking for the best one to draw next
+        for( int i = 0; i < newCount; i++ )
+        {
+            int v = newCache[i];
+            cachePosition[v] = i < VC_CACHE_SIZE ? i : -1;
+            score[v] = vertexScore( cachePosition[v], numActive[v] );
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.f;
+        for( int i = 0; i < newCount; i++ )
+        {
+            int v = newCache[i];
+            const int* list = &vertexTriangles[firstTriangle[v]];
+            for( int j = 0; j < numActive[v]; j++ )
+            {
+                int u = list[j];
+                float s = score[indices[u*3]] + score[indices[u*3+1]] + score[indices[u*3+2]];
+                if( s > bestScore )
+                {
+                    bestScore = s;
+                    bestTriangle = u;
+                }
+            }
+        }
+
+        cacheCount = newCount < VC_CACHE_SIZE ? newCount : VC_CACHE_SIZE;
+        memcpy( cache, newCache, cacheCount * sizeof(int) );
+    }
+
+    memcpy( indices, &output[0], output.size() * sizeof(unsigned int) );
+}
+
+
+void optimizeVertexFetch( unsigned int* indices, int numIndices, int numVertices, unsigned int* vertexRemap )
+{
+    const unsigned int unused = 0xffffffffu;
+    for( int v = 0; v < numVertices; v++ )
+        vertexRemap[v] = unused;
+
+    unsigned int next = 0;
+    for( int i = 0; i < numIndices; i++ )
+    {
+        unsigned int& r = vertexRemap[indices[i]];
+        if( r == unused )
+            r = next++;
+        indices[i] = r;
+    }
+
+    // vertices no triangle uses go at the end
+    for( int v = 0; v < numVertices; v++ )
+        if( vertexRemap[v] == unused )
+            vertexRemap[v] = next++;
+}
+
+
+float computeACMR( const unsigned int* indices, int numTriangles, int cacheSize )
+{
+    if( numTriangles == 0 )
+        return 0.f;
+
+    std::vector<unsigned int> fifo( cacheSize, 0xffffffffu );
+    int head = 0;
+    int misses = 0;
+    for( int i = 0; i < numTriangles * 3; i++ )
+    {
+        bool hit = false;
+        for( int j = 0; j < cacheSize; j++ )
+            if( fifo[j] == indices[i] )
+            {
+                hit = true;
+                break;
+            }
+
+        if( !hit )
+        {
+            fifo[head] = indices[i];
+            head = (head + 1) % cacheSize;
+            misses++;
+        }
+    }
+
+    return float(misses) / float(numTriangles);
+}
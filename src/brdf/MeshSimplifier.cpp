@@ -0,0 +1,389 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "MeshSimplifier.h"
+
+
+// boundary edges are held in place by a plane through them, at right angles
+// to their triangle, weighted this much more than the surface
+#define SIMPLIFY_BOUNDARY_WEIGHT 10.0
+
+// a collapse is refused if it turns any triangle by more than this (cosine)
+#define SIMPLIFY_MAX_FLIP_COSINE 0.25
+
+#define SIMPLIFY_MAX_PASSES 32
+
+
+// a symmetric 4x4 matrix: the sum of squared distances to a set of planes
+struct Quadric
+{
+    Quadric() { memset( q, 0, sizeof(q) ); }
+
+    void addPlane( double a, double b, double c, double d, double weight )
+    {
+        q[0] += weight*a*a; q[1] += weight*a*b; q[2] += weight*a*c; q[3] += weight*a*d;
+        q[4] += weight*b*b; q[5] += weight*b*c; q[6] += weight*b*d;
+        q[7] += weight*c*c; q[8] += weight*c*d;
+        q[9] += weight*d*d;
+    }
+
+    void add( const Quadric& o )
+    {
+        for( int i = 0; i < 10; i++ )
+            q[i] += o.q[i];
+    }
+
+    double error( const float* p ) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+        return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x
+             + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y
+             + q[7]*z*z + 2*q[8]*z
+             + q[9];
+    }
+
+    double q[10];
+};
+
+
+struct Collapse
+{
+    int from, to;
+    int numTriangles;   // how many triangles it removes
+    double error;
+
+    bool operator<( const Collapse& o ) const { return error < o.error; }
+};
+
+
+struct TriangleEdge
+{
+    int a, b;           // a < b
+    int triangle;
+
+    bool operator<( const TriangleEdge& o ) const { return a < o.a || (a == o.a && b < o.b); }
+};
+
+
+static void triangleNormal( const float* p0, const float* p1, const float* p2, double* n )
+{
+    double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+    n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+    n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+}
+
+
+static int findPosition( std::vector<int>& collapsedInto, int p )
+{
+    int root = p;
+    while( collapsedInto[root] != root )
+        root = collapsedInto[root];
+    while( collapsedInto[p] != root )
+    {
+        int next = collapsedInto[p];
+        collapsedInto[p] = root;
+        p = next;
+    }
+    return root;
+}
+
+
+int simplifyMesh( unsigned int* destination, const unsigned int* indices, int numTriangles,
+                  const float* positions, const float* normals, int numVertices, int targetTriangles )
+{
+    // weld the vertices by position; vertexOrder groups the vertices of each
+    // position together, starting at firstVertex[p]
+    std::vector<int> vertexOrder( numVertices );
+    for( int v = 0; v < numVertices; v++ )
+        vertexOrder[v] = v;
+    std::sort( vertexOrder.begin(), vertexOrder.end(), [&]( int a, int b )
+    {
+        return memcmp( positions + a*3, positions + b*3, 3 * sizeof(float) ) < 0;
+    });
+
+    std::vector<int> positionOf( numVertices ), firstVertex;
+    for( int i = 0; i < numVertices; i++ )
+    {
+        int v = vertexOrder[i];
+        if( i == 0 || memcmp( positions + v*3, positions + vertexOrder[i-1]*3, 3 * sizeof(float) ) )
+            firstVertex.push_back( i );
+        positionOf[v] = (int)firstVertex.size() - 1;
+    }
+    int numPositions = (int)firstVertex.size();
+    firstVertex.push_back( numVertices );
+
+    auto positionCoords = [&]( int p ) { return positions + vertexOrder[firstVertex[p]] * 3; };
+
+    // the triangles still standing, by original index and in positions
+    std::vector<int> live, corners( numTriangles * 3 );
+    for( int t = 0; t < numTriangles; t++ )
+    {
+        int* c = &corners[t*3];
+        for( int i = 0; i < 3; i++ )
+            c[i] = positionOf[indices[t*3 + i]];
+        if( c[0] != c[1] && c[1] != c[2] && c[0] != c[2] )
+            live.push_back( t );
+    }
+
+    // every position's quadric: the planes of its triangles, weighted by area,
+    // and of the boundary edges it's on
+    std::vector<Quadric> quadrics( numPositions );
+    std::vector<TriangleEdge> triangleEdges;
+    for( size_t i = 0; i < live.size(); i++ )
+    {
+        const int* c = &corners[live[i]*3];
+        double n[3];
+        triangleNormal( positionCoords( c[0] ), positionCoords( c[1] ), positionCoords( c[2] ), n );
+        double len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        if( len == 0. )
+            continue;
+        n[0] /= len; n[1] /= len; n[2] /= len;
+
+        const float* p0 = positionCoords( c[0] );
+        double d = -(n[0]*p0[0] + n[1]*p0[1] + n[2]*p0[2]);
+        for( int k = 0; k < 3; k++ )
+            quadrics[c[k]].addPlane( n[0], n[1], n[2], d, len * 0.5 );
+
+        for( int k = 0; k < 3; k++ )
+        {
+            TriangleEdge e = { std::min( c[k], c[(k+1)%3] ), std::max( c[k], c[(k+1)%3] ), live[i] };
+            triangleEdges.push_back( e );
+        }
+    }
+
+    // edges with only one triangle are on the boundary
+    std::sort( triangleEdges.begin(), triangleEdges.end() );
+    for( size_t i = 0; i < triangleEdges.size(); )
+    {
+        size_t j = i + 1;
+        while( j < triangleEdges.size() && triangleEdges[j].a == triangleEdges[i].a && triangleEdges[j].b == triangleEdges[i].b )
+            j++;
+
+        if( j == i + 1 )
+        {
+            int a = triangleEdges[i].a, b = triangleEdges[i].b;
+            const int* c = &corners[triangleEdges[i].triangle*3];
+            const float* pa = positionCoords( a );
+            const float* pb = positionCoords( b );
+            double n[3];
+            triangleNormal( positionCoords( c[0] ), positionCoords( c[1] ), positionCoords( c[2] ), n );
+
+            // the plane through the edge, at right angles to the triangle
+            double e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+            double m[3] = { e[1]*n[2] - e[2]*n[1], e[2]*n[0] - e[0]*n[2], e[0]*n[1] - e[1]*n[0] };
+            double len = sqrt( m[0]*m[0] + m[1]*m[1] + m[2]*m[2] );
+            if( len > 0. )
+            {
+                m[0] /= len; m[1] /= len; m[2] /= len;
+                double d = -(m[0]*pa[0] + m[1]*pa[1] + m[2]*pa[2]);
+                double weight = SIMPLIFY_BOUNDARY_WEIGHT * (e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+                quadrics[a].addPlane( m[0], m[1], m[2], d, weight );
+                quadrics[b].addPlane( m[0], m[1], m[2], d, weight );
+            }
+        }
+        i = j;
+    }
+    std::vector<TriangleEdge>().swap( triangleEdges );
+
+    std::vector<int> collapsedInto( numPositions );
+    for( int p = 0; p < numPositions; p++ )
+        collapsedInto[p] = p;
+
+    // each pass collapses the cheapest edges it can without two collapses
+    // touching the same position, then starts over with the new mesh
+    std::vector<int> firstTriangle, trianglesOfPosition;
+    std::vector<char> locked( numPositions );
+    for( int pass = 0; pass < SIMPLIFY_MAX_PASSES && (int)live.size() > targetTriangles; pass++ )
+    {
+        // the live triangles around each position
+        firstTriangle.assign( numPositions + 1, 0 );
+        for( size_t i = 0; i < live.size(); i++ )
+            for( int k = 0; k < 3; k++ )
+                firstTriangle[corners[live[i]*3 + k] + 1]++;
+        for( int p = 0; p < numPositions; p++ )
+            firstTriangle[p + 1] += firstTriangle[p];
+        std::vector<int> fill( firstTriangle.begin(), firstTriangle.end() - 1 );
+        trianglesOfPosition.resize( live.size() * 3 );
+        for( size_t i = 0; i < live.size(); i++ )
+            for( int k = 0; k < 3; k++ )
+                trianglesOfPosition[fill[corners[live[i]*3 + k]]++] = live[i];
+
+        // the edges, each with the cheaper of its two directions
+        std::vector<Collapse> edges;
+        for( size_t i = 0; i < live.size(); i++ )
+        {
+            const int* c = &corners[live[i]*3];
+            for( int k = 0; k < 3; k++ )
+            {
+                Collapse e;
+                e.from = std::min( c[k], c[(k+1)%3] );
+                e.to = std::max( c[k], c[(k+1)%3] );
+                e.numTriangles = 1;
+                edges.push_back( e );
+            }
+        }
+        std::sort( edges.begin(), edges.end(), []( const Collapse& a, const Collapse& b )
+        {
+            return a.from < b.from || (a.from == b.from && a.to < b.to);
+        });
+
+        std::vector<Collapse> collapses;
+        for( size_t i = 0; i < edges.size(); )
+        {
+            Collapse e = edges[i++];
+            while( i < edges.size() && edges[i].from == e.from && edges[i].to == e.to )
+            {
+                e.numTriangles++;
+                i++;
+            }
+
+            Quadric q = quadrics[e.from];
+            q.add( quadrics[e.to] );
+            double toError = q.error( positionCoords( e.to ) );
+            double fromError = q.error( positionCoords( e.from ) );
+            if( fromError < toError )
+                std::swap( e.from, e.to );
+            e.error = std::min( fromError, toError );
+            collapses.push_back( e );
+        }
+        std::sort( collapses.begin(), collapses.end() );
+
+        // locking the positions each collapse touches keeps a pass from
+        // doing too much at once, so it can aim for the whole reduction
+        int goal = (int)live.size() - targetTriangles;
+        int removed = 0;
+        std::fill( locked.begin(), locked.end(), 0 );
+
+        for( size_t i = 0; i < collapses.size() && removed < goal; i++ )
+        {
+            const Collapse& e = collapses[i];
+            if( locked[e.from] || locked[e.to] )
+                continue;
+
+            // refuse collapses that flip or flatten any of the triangles that
+            // would survive them
+            bool ok = true;
+            for( int j = firstTriangle[e.from]; j < firstTriangle[e.from + 1] && ok; j++ )
+            {
+                const int* c = &corners[trianglesOfPosition[j]*3];
+                int moved[3];
+                for( int k = 0; k < 3; k++ )
+                    moved[k] = findPosition( collapsedInto, c[k] );
+                if( moved[0] == e.to || moved[1] == e.to || moved[2] == e.to )
+                    continue;
+
+                double before[3], after[3];
+                triangleNormal( positionCoords( moved[0] ), positionCoords( moved[1] ), positionCoords( moved[2] ), before );
+                for( int k = 0; k < 3; k++ )
+                    if( moved[k] == e.from )
+                        moved[k] = e.to;
+                triangleNormal( positionCoords( moved[0] ), positionCoords( moved[1] ), positionCoords( moved[2] ), after );
+
+                double dot = before[0]*after[0] + before[1]*after[1] + before[2]*after[2];
+                double lengths = sqrt( (before[0]*before[0] + before[1]*before[1] + before[2]*before[2]) *
+                                       (after[0]*after[0] + after[1]*after[1] + after[2]*after[2]) );
+                ok = dot > SIMPLIFY_MAX_FLIP_COSINE * lengths;
+            }
+            if( !ok )
+                continue;
+
+            collapsedInto[e.from] = e.to;
+            quadrics[e.to].add( quadrics[e.from] );
+            locked[e.from] = locked[e.to] = 1;
+            removed += e.numTriangles;
+        }
+
+        if( removed == 0 )
+            break;
+
+        // the triangles that survived, with their corners moved
+        size_t numLive = 0;
+        for( size_t i = 0; i < live.size(); i++ )
+        {
+            int* c = &corners[live[i]*3];
+            for( int k = 0; k < 3; k++ )
+                c[k] = findPosition( collapsedInto, c[k] );
+            if( c[0] != c[1] && c[1] != c[2] && c[0] != c[2] )
+                live[numLive++] = live[i];
+        }
+        live.resize( numLive );
+    }
+
+    // back to vertices: corners that stayed put keep theirs, the others take
+    // the closest match at their new position
+    for( size_t i = 0; i < live.size(); i++ )
+    {
+        int t = live[i];
+        for( int k = 0; k < 3; k++ )
+        {
+            int v = indices[t*3 + k];
+            int p = corners[t*3 + k];
+            if( p != positionOf[v] )
+            {
+                const float* n = normals + v*3;
+                float best = -2.f;
+                for( int j = firstVertex[p]; j < firstVertex[p + 1]; j++ )
+                {
+                    int w = vertexOrder[j];
+                    float d = n[0]*normals[w*3] + n[1]*normals[w*3+1] + n[2]*normals[w*3+2];
+                    if( d > best )
+                    {
+                        best = d;
+                        v = w;
+                    }
+                }
+            }
+            destination[i*3 + k] = v;
+        }
+    }
+
+    return (int)live.size();
+}
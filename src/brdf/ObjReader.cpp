@@ -0,0 +1,625 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QFile>
+#include <QDir>
+#include <QElapsedTimer>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include "ObjReader.h"
+#include "ParallelFor.h"
+
+
+// chunks are about this big, unless that would leave cores idle
+#define OBJ_CHUNK_BYTES (4 << 20)
+#define OBJ_MIN_CHUNK_BYTES (64 << 10)
+
+
+struct ObjReader::Chunk
+{
+    const char* begin;
+    const char* end;
+
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    std::vector<int> faceSizes;
+    std::vector<int> cornerPositions;
+    std::vector<int> cornerNormals;
+    std::vector<int> cornerTexCoords;
+
+    // where this chunk's results go in the merged arrays
+    size_t positionOffset, normalOffset, texCoordOffset, faceOffset, cornerOffset;
+};
+
+
+static inline bool isBlank( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+static inline bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+
+static inline void skipBlanks( const char*& p, const char* end )
+{
+    while( p < end && isBlank( *p ) )
+        p++;
+}
+
+
+static inline bool parseInt( const char*& p, const char* end, int& value )
+{
+    bool negative = false;
+    if( p < end && (*p == '-' || *p == '+') )
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    if( p >= end || !isDigit( *p ) )
+        return false;
+
+    int v = 0;
+    while( p < end && isDigit( *p ) )
+        v = v * 10 + (*p++ - '0');
+
+    value = negative ? -v : v;
+    return true;
+}
+
+
+// falls back on strtof for anything unusual (inf, nan, hex floats); the
+// mapping isn't null terminated, so the token is copied out first
+static bool parseFloatSlow( const char*& p, const char* end, float& value )
+{
+    char token[64];
+    int n = 0;
+    while( p + n < end && n < 63 && !isBlank( p[n] ) && p[n] != '\n' )
+    {
+        token[n] = p[n];
+        n++;
+    }
+    token[n] = '\0';
+
+    char* tokenEnd;
+    value = strtof( token, &tokenEnd );
+    if( tokenEnd == token )
+        return false;
+
+    p += tokenEnd - token;
+    return true;
+}
+
+
+static inline bool parseFloat( const char*& p, const char* end, float& value )
+{
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* start = p;
+    bool negative = false;
+    if( p < end && (*p == '-' || *p == '+') )
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    // up to 19 significant digits fit in the mantissa; the rest only move
+    // the decimal point
+    unsigned long long mantissa = 0;
+    int numDigits = 0, exponent = 0;
+    bool anyDigits = false;
+    while( p < end && isDigit( *p ) )
+    {
+        if( numDigits < 19 )
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if( mantissa )
+                numDigits++;
+        }
+        else
+            exponent++;
+        anyDigits = true;
+        p++;
+    }
+    if( p < end && *p == '.' )
+    {
+        p++;
+        while( p < end && isDigit( *p ) )
+        {
+            if( numDigits < 19 )
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if( mantissa )
+                    numDigits++;
+                exponent--;
+            }
+            anyDigits = true;
+            p++;
+        }
+    }
+
+    if( !anyDigits )
+    {
+        p = start;
+        return parseFloatSlow( p, end, value );
+    }
+
+    if( p < end && (*p == 'e' || *p == 'E') )
+    {
+        const char* e = p++;
+        int exponentValue;
+        if( parseInt( p, end, exponentValue ) )
+            exponent += std::max( std::min( exponentValue, 1000 ), -1000 );
+        else
+            p = e;
+    }
+
+    // exact for mantissas below 2^53 and exponents the table covers, which
+    // is every number an exporter writes in practice
+    double v = double(mantissa);
+    if( exponent < 0 && exponent >= -22 )
+        v /= powersOf10[-exponent];
+    else if( exponent > 0 && exponent <= 22 )
+        v *= powersOf10[exponent];
+    else if( exponent )
+        v *= pow( 10.0, exponent );
+
+    value = float(negative ? -v : v);
+    return true;
+}
+
+
+// one face corner: v, v/t, v//n or v/t/n
+static inline bool parseCorner( const char*& p, const char* end, int& position, int& normal, int& texture )
+{
+    normal = texture = 0;
+    if( !parseInt( p, end, position ) )
+        return false;
+
+    if( p < end && *p == '/' )
+    {
+        p++;
+        if( p < end && *p != '/' && !parseInt( p, end, texture ) )
+            return false;
+
+        if( p < end && *p == '/' )
+        {
+            p++;
+            if( !parseInt( p, end, normal ) )
+                return false;
+        }
+    }
+
+    // the corner has to end at a space or the end of the line
+    return p >= end || isBlank( *p ) || *p == '\n';
+}
+
+
+bool ObjReader::parseChunk( const char* p, const char* end, Chunk& chunk )
+{
+    while( p < end )
+    {
+        skipBlanks( p, end );
+
+        if( p + 1 < end && p[0] == 'v' && isBlank( p[1] ) )
+        {
+            p += 2;
+            // a malformed line still counts, with zeros for what couldn't
+            // be read, so the indices the faces use stay the same
+            float xyz[3] = { 0.f, 0.f, 0.f };
+            for( int i = 0; i < 3; i++ )
+            {
+                skipBlanks( p, end );
+                if( !parseFloat( p, end, xyz[i] ) )
+                {
+                    xyz[i] = 0.f;
+                    break;
+                }
+            }
+            chunk.positions.insert( chunk.positions.end(), xyz, xyz + 3 );
+        }
+
+        else if( p + 2 < end && p[0] == 'v' && p[1] == 'n' && isBlank( p[2] ) )
+        {
+            p += 3;
+            // zeros for a malformed line, as with positions
+            float xyz[3] = { 0.f, 0.f, 0.f };
+            for( int i = 0; i < 3; i++ )
+            {
+                skipBlanks( p, end );
+                if( !parseFloat( p, end, xyz[i] ) )
+                {
+                    xyz[i] = 0.f;
+                    break;
+                }
+            }
+            chunk.normals.insert( chunk.normals.end(), xyz, xyz + 3 );
+        }
+
+        else if( p + 2 < end && p[0] == 'v' && p[1] == 't' && isBlank( p[2] ) )
+        {
+            // v and w are optional; a third (w) coordinate is ignored, and
+            // a missing or unreadable one is zero, so the vt still counts
+            // towards the indices the faces use
+            p += 3;
+            float uv[2] = { 0.f, 0.f };
+            for( int i = 0; i < 2; i++ )
+            {
+                skipBlanks( p, end );
+                if( !parseFloat( p, end, uv[i] ) )
+                {
+                    uv[i] = 0.f;
+                    break;
+                }
+            }
+            chunk.texCoords.insert( chunk.texCoords.end(), uv, uv + 2 );
+        }
+
+        else if( p + 1 < end && p[0] == 'f' && isBlank( p[1] ) )
+        {
+            p += 2;
+            int numCorners = 0;
+            for( ;; )
+            {
+                skipBlanks( p, end );
+                if( p >= end || *p == '\n' )
+                    break;
+
+                int position, normal, texture;
+                if( !parseCorner( p, end, position, normal, texture ) )
+                    return false;
+
+                // still 1-based here; zero means none
+                chunk.cornerPositions.push_back( position );
+                chunk.cornerNormals.push_back( normal );
+                chunk.cornerTexCoords.push_back( texture );
+                numCorners++;
+            }
+            chunk.faceSizes.push_back( numCorners );
+        }
+
+        // on to the next line
+        while( p < end && *p != '\n' )
+            p++;
+        if( p < end )
+            p++;
+    }
+
+    return true;
+}
+
+
+void ObjReader::clear()
+{
+    positions.clear();
+    normals.clear();
+    texCoords.clear();
+    faceSizes.clear();
+    cornerPositions.clear();
+    cornerNormals.clear();
+    cornerTexCoords.clear();
+}
+
+
+bool ObjReader::read( const char* filename )
+{
+    clear();
+
+    QFile file( filename );
+    if( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    qint64 size = file.size();
+    if( size == 0 )
+        return true;
+
+    const char* data = (const char*)file.map( 0, size );
+    if( !data )
+        return false;
+    const char* dataEnd = data + size;
+
+    // cut the file into chunks, each ending just after a newline
+    int numThreads = std::max( (int)std::thread::hardware_concurrency(), 1 );
+    qint64 chunkBytes = std::max<qint64>( std::min<qint64>( OBJ_CHUNK_BYTES, size / (numThreads * 4) ), OBJ_MIN_CHUNK_BYTES );
+
+    std::vector<Chunk> chunks;
+    const char* p = data;
+    while( p < dataEnd )
+    {
+        Chunk chunk;
+        chunk.begin = p;
+        p = std::min( p + chunkBytes, dataEnd );
+        while( p < dataEnd && p[-1] != '\n' )
+            p++;
+        chunk.end = p;
+        chunks.push_back( chunk );
+    }
+
+    int numChunks = (int)chunks.size();
+    std::vector<char> chunkOK( numChunks, 0 );
+    parallelFor( 0, numChunks, [&]( int i )
+    {
+        chunkOK[i] = parseChunk( chunks[i].begin, chunks[i].end, chunks[i] );
+    });
+
+    file.unmap( (uchar*)data );
+
+    for( int i = 0; i < numChunks; i++ )
+        if( !chunkOK[i] )
+            return false;
+
+    size_t numPositions = 0, numNormals = 0, numTexCoords = 0, numFaces = 0, numCorners = 0;
+    for( int i = 0; i < numChunks; i++ )
+    {
+        Chunk& chunk = chunks[i];
+        chunk.positionOffset = numPositions;
+        chunk.normalOffset = numNormals;
+        chunk.texCoordOffset = numTexCoords;
+        chunk.faceOffset = numFaces;
+        chunk.cornerOffset = numCorners;
+        numPositions += chunk.positions.size();
+        numNormals += chunk.normals.size();
+        numTexCoords += chunk.texCoords.size();
+        numFaces += chunk.faceSizes.size();
+        numCorners += chunk.cornerPositions.size();
+    }
+
+    positions.resize( numPositions );
+    normals.resize( numNormals );
+    texCoords.resize( numTexCoords );
+    faceSizes.resize( numFaces );
+    cornerPositions.resize( numCorners );
+    cornerNormals.resize( numCorners );
+    cornerTexCoords.resize( numCorners );
+
+    // gather the chunks into place, making the indices 0-based and checking
+    // them against the whole file's counts on the way
+    int vertexCount = int(numPositions / 3), normalCount = int(numNormals / 3), texCoordCount = int(numTexCoords / 2);
+    parallelFor( 0, numChunks, [&]( int i )
+    {
+        Chunk& chunk = chunks[i];
+        std::copy( chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset );
+        std::copy( chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalOffset );
+        std::copy( chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordOffset );
+        std::copy( chunk.faceSizes.begin(), chunk.faceSizes.end(), faceSizes.begin() + chunk.faceOffset );
+
+        for( size_t c = 0; c < chunk.cornerPositions.size(); c++ )
+        {
+            int v = chunk.cornerPositions[c];
+            int n = chunk.cornerNormals[c];
+            int t = chunk.cornerTexCoords[c];
+            if( v < 1 || v > vertexCount || n < 0 || n > normalCount || t < 0 || t > texCoordCount )
+                chunkOK[i] = false;
+            cornerPositions[chunk.cornerOffset + c] = v - 1;
+            cornerNormals[chunk.cornerOffset + c] = n - 1;
+            cornerTexCoords[chunk.cornerOffset + c] = t - 1;
+        }
+    });
+
+    for( int i = 0; i < numChunks; i++ )
+        if( !chunkOK[i] )
+        {
+            clear();
+            return false;
+        }
+
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// the fgets/sscanf parser SimpleModel used to have, for comparison
+static bool readObjReference( const char* filename, ObjReader& obj )
+{
+    obj.clear();
+
+    FILE* file = fopen( filename, "r" );
+    if( !file )
+        return false;
+
+    char line[2048];
+    while( fgets( line, sizeof(line), file ) )
+    {
+        float x, y, z;
+        if( line[0] == 'v' && line[1] == ' ' && sscanf( line, "v %f %f %f", &x, &y, &z ) == 3 )
+        {
+            obj.positions.push_back( x );
+            obj.positions.push_back( y );
+            obj.positions.push_back( z );
+        }
+        else if( line[0] == 'v' && line[1] == 'n' && sscanf( line, "vn %f %f %f", &x, &y, &z ) == 3 )
+        {
+            obj.normals.push_back( x );
+            obj.normals.push_back( y );
+            obj.normals.push_back( z );
+        }
+        else if( line[0] == 'f' && line[1] == ' ' )
+        {
+            int numCorners = 0;
+            int v, t, n, numRead;
+            const char* cp = &line[2];
+            while( *cp == ' ' ) cp++;
+            while( *cp && *cp != '\n' && *cp != '\r' )
+            {
+                if( sscanf( cp, "%d//%d%n", &v, &n, &numRead ) == 2 ) {}
+                else if( sscanf( cp, "%d/%d/%d%n", &v, &t, &n, &numRead ) == 3 ) {}
+                else if( sscanf( cp, "%d/%d%n", &v, &t, &numRead ) == 2 ) n = 0;
+                else if( sscanf( cp, "%d%n", &v, &numRead ) == 1 ) n = 0;
+                else
+                {
+                    fclose( file );
+                    return false;
+                }
+                obj.cornerPositions.push_back( v - 1 );
+                obj.cornerNormals.push_back( n - 1 );
+                numCorners++;
+                cp += numRead;
+                while( *cp == ' ' ) cp++;
+            }
+            obj.faceSizes.push_back( numCorners );
+        }
+    }
+
+    fclose( file );
+    return true;
+}
+
+
+// a torus with a million vertices, in the v//n form most exporters write
+static bool writeBenchmarkMesh( const char* filename )
+{
+    FILE* file = fopen( filename, "w" );
+    if( !file )
+        return false;
+
+    const int rings = 1000, sides = 1000;
+    for( int i = 0; i < rings; i++ )
+        for( int j = 0; j < sides; j++ )
+        {
+            double u = 2.0 * M_PI * i / rings, v = 2.0 * M_PI * j / sides;
+            double r = 1.0 + 0.35 * cos(v);
+            fprintf( file, "v %.6f %.6f %.6f\n", r * cos(u), 0.35 * sin(v), r * sin(u) );
+            fprintf( file, "vn %.6f %.6f %.6f\n", cos(v) * cos(u), sin(v), cos(v) * sin(u) );
+        }
+
+    for( int i = 0; i < rings; i++ )
+        for( int j = 0; j < sides; j++ )
+        {
+            int a = i * sides + j + 1;
+            int b = ((i + 1) % rings) * sides + j + 1;
+            int c = ((i + 1) % rings) * sides + (j + 1) % sides + 1;
+            int d = i * sides + (j + 1) % sides + 1;
+            fprintf( file, "f %d//%d %d//%d %d//%d %d//%d\n", a, a, b, b, c, c, d, d );
+        }
+
+    fclose( file );
+    return true;
+}
+
+
+static void benchmarkFile( const char* filename )
+{
+    QFile file( filename );
+    double megabytes = double(file.size()) / (1 << 20);
+
+    ObjReader reference, obj;
+    double referenceMS = 1e30, readerMS = 1e30;
+
+    // best of a few runs, so the page cache is warm for both
+    for( int run = 0; run < 3; run++ )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if( !readObjReference( filename, reference ) )
+        {
+            printf( "couldn't read %s\n", filename );
+            return;
+        }
+        referenceMS = std::min( referenceMS, timer.nsecsElapsed() * 1e-6 );
+
+        timer.restart();
+        if( !obj.read( filename ) )
+        {
+            printf( "couldn't read %s\n", filename );
+            return;
+        }
+        readerMS = std::min( readerMS, timer.nsecsElapsed() * 1e-6 );
+    }
+
+    bool same = obj.positions.size() == reference.positions.size() &&
+                obj.normals.size() == reference.normals.size() &&
+                obj.faceSizes == reference.faceSizes &&
+                obj.cornerPositions == reference.cornerPositions &&
+                obj.cornerNormals == reference.cornerNormals;
+
+    float maxError = 0.f;
+    if( same )
+    {
+        for( size_t i = 0; i < obj.positions.size(); i++ )
+            maxError = std::max( maxError, fabsf( obj.positions[i] - reference.positions[i] ) );
+        for( size_t i = 0; i < obj.normals.size(); i++ )
+            maxError = std::max( maxError, fabsf( obj.normals[i] - reference.normals[i] ) );
+    }
+
+    printf( "%s: %.1f MB, %d vertices, %d faces\n", filename, megabytes,
+            int(obj.positions.size() / 3), int(obj.faceSizes.size()) );
+    printf( "    sscanf:    %9.2f ms (%7.1f MB/s)\n", referenceMS, megabytes / (referenceMS * 1e-3) );
+    printf( "    ObjReader: %9.2f ms (%7.1f MB/s), %.1fx\n", readerMS, megabytes / (readerMS * 1e-3),
+            referenceMS / readerMS );
+    if( same )
+        printf( "    same faces, largest difference in a coordinate %g\n", maxError );
+    else
+        printf( "    MISMATCH against the sscanf parser\n" );
+}
+
+
+void benchmarkObjReader( const char* filename )
+{
+    benchmarkFile( filename );
+
+    std::string meshFilename = QDir::tempPath().toStdString() + "/brdf_benchmark_torus.obj";
+    printf( "writing %s...\n", meshFilename.c_str() );
+    if( !writeBenchmarkMesh( meshFilename.c_str() ) )
+    {
+        printf( "couldn't write %s\n", meshFilename.c_str() );
+        return;
+    }
+
+    benchmarkFile( meshFilename.c_str() );
+    QFile::remove( QString::fromStdString( meshFilename ) );
+}
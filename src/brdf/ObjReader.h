@@ -0,0 +1,95 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+#include <vector>
+
+
+/*
+Reads the geometry of a Wavefront OBJ file: vertex positions, normals and
+texture coordinates, and faces, whose corners can be v, v//n, v/t/n or v/t.
+Everything else in the file is skipped.
+
+The file is mapped and cut into line-aligned chunks that are parsed on all
+the cores at once, with hand-written number parsing in place of sscanf. OBJ
+indices count from the start of the file, so the chunks don't depend on each
+other and their results are simply concatenated in order.
+*/
+
+class ObjReader
+{
+public:
+    bool read( const char* filename );
+
+    void clear();
+
+    // xyz triples
+    std::vector<float> positions;
+    std::vector<float> normals;
+
+    // uv pairs
+    std::vector<float> texCoords;
+
+    // the number of corners of each face, and the 0-based position, normal and
+    // texture coordinate index of every corner in turn; the normal and texture
+    // coordinate indices are -1 if a corner has none
+    std::vector<int> faceSizes;
+    std::vector<int> cornerPositions;
+    std::vector<int> cornerNormals;
+    std::vector<int> cornerTexCoords;
+
+private:
+    struct Chunk;
+    static bool parseChunk( const char* begin, const char* end, Chunk& chunk );
+};
+
+
+// times the reader against a single threaded fgets/sscanf parser on the given
+// file and on a large generated mesh, and checks that they agree
+void benchmarkObjReader( const char* filename );
+
+#endif
@@ -0,0 +1,202 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "PackedVertices.h"
+#include "MeshFrames.h"
+#include "DGLShader.h"
+
+
+int PackedVertices::stride( int positionFormat )
+{
+    int positionBytes = positionFormat == PACKED_POSITION_HALF ? 4 * sizeof(GLushort) : 3 * sizeof(float);
+    return positionBytes + 4 * sizeof(GLshort);
+}
+
+
+void PackedVertices::pack( int positionFormat, int numVertices, const float* positions,
+                           const float* normals, const float* tangents, void* vertices )
+{
+    int vertexStride = stride( positionFormat );
+    int positionBytes = vertexStride - 4 * sizeof(GLshort);
+
+    unsigned char* out = (unsigned char*)vertices;
+    for( int i = 0; i < numVertices; i++, out += vertexStride )
+    {
+        const float* p = positions + i * 3;
+        if( positionFormat == PACKED_POSITION_HALF )
+        {
+            GLushort h[4] = { floatToHalf( p[0] ), floatToHalf( p[1] ), floatToHalf( p[2] ), 0 };
+            memcpy( out, h, sizeof(h) );
+        }
+        else
+            memcpy( out, p, 3 * sizeof(float) );
+
+        GLshort frame[4] = { 0, 0, 0, 32767 };
+        octEncode( normals + i * 3, frame );
+        if( tangents )
+        {
+            // measure the angle against the frame the shader will build from
+            // the decoded normal, not the exact one
+            const float* t = tangents + i * 4;
+            float n[3], u[3], v[3];
+            octDecode( frame, n );
+            tangentFrame( n, u, v );
+
+            float angle = atan2f( t[0]*v[0] + t[1]*v[1] + t[2]*v[2], t[0]*u[0] + t[1]*u[1] + t[2]*u[2] );
+            frame[2] = GLshort( lrintf( angle / float(M_PI) * 32767.f ) );
+            frame[3] = t[3] < 0.f ? -32767 : 32767;
+        }
+        memcpy( out + positionBytes, frame, sizeof(frame) );
+    }
+}
+
+
+void PackedVertices::setAttributes( const DGLShader* shader, int positionFormat )
+{
+    int vertexStride = stride( positionFormat );
+    int positionBytes = vertexStride - 4 * sizeof(GLshort);
+
+    int position_loc = shader->getAttribLocation("vtx_position");
+    if( position_loc >= 0 ) {
+        if( positionFormat == PACKED_POSITION_HALF )
+            glf->glVertexAttribPointer( position_loc, 3, GL_HALF_FLOAT, GL_FALSE, vertexStride, 0 );
+        else
+            glf->glVertexAttribPointer( position_loc, 3, GL_FLOAT, GL_FALSE, vertexStride, 0 );
+        glf->glEnableVertexAttribArray( position_loc );
+    }
+
+    int normal_loc = shader->getAttribLocation("vtx_normal");
+    if( normal_loc >= 0 ) {
+        glf->glVertexAttribPointer( normal_loc, 2, GL_SHORT, GL_TRUE, vertexStride, (void*)(size_t)positionBytes );
+        glf->glEnableVertexAttribArray( normal_loc );
+    }
+
+    int tangent_loc = shader->getAttribLocation("vtx_tangent");
+    if( tangent_loc >= 0 ) {
+        glf->glVertexAttribPointer( tangent_loc, 2, GL_SHORT, GL_TRUE, vertexStride, (void*)(size_t)(positionBytes + 2 * sizeof(GLshort)) );
+        glf->glEnableVertexAttribArray( tangent_loc );
+    }
+}
+
+
+void PackedVertices::octEncode( const float* v, GLshort* e )
+{
+    // project onto the octahedron |x| + |y| + |z| = 1, and fold the lower
+    // half over the upper one
+    float l1 = fabsf( v[0] ) + fabsf( v[1] ) + fabsf( v[2] );
+    float x = l1 > 0.f ? v[0] / l1 : 0.f;
+    float y = l1 > 0.f ? v[1] / l1 : 0.f;
+    if( v[2] < 0.f )
+    {
+        float fx = (1.f - fabsf( y )) * (x >= 0.f ? 1.f : -1.f);
+        float fy = (1.f - fabsf( x )) * (y >= 0.f ? 1.f : -1.f);
+        x = fx;
+        y = fy;
+    }
+
+    e[0] = GLshort( lrintf( fminf( fmaxf( x, -1.f ), 1.f ) * 32767.f ) );
+    e[1] = GLshort( lrintf( fminf( fmaxf( y, -1.f ), 1.f ) * 32767.f ) );
+}
+
+
+void PackedVertices::octDecode( const GLshort* e, float* v )
+{
+    // the same as octDecode() in brdfIBL.vert
+    float x = fmaxf( e[0] / 32767.f, -1.f );
+    float y = fmaxf( e[1] / 32767.f, -1.f );
+    float z = 1.f - fabsf( x ) - fabsf( y );
+    if( z < 0.f )
+    {
+        float fx = (1.f - fabsf( y )) * (x >= 0.f ? 1.f : -1.f);
+        float fy = (1.f - fabsf( x )) * (y >= 0.f ? 1.f : -1.f);
+        x = fx;
+        y = fy;
+    }
+
+    float len = sqrtf( x*x + y*y + z*z );
+    v[0] = x / len;
+    v[1] = y / len;
+    v[2] = z / len;
+}
+
+
+GLushort PackedVertices::floatToHalf( float f )
+{
+    unsigned int bits;
+    memcpy( &bits, &f, sizeof(bits) );
+
+    unsigned int sign = (bits >> 16) & 0x8000;
+    int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = bits & 0x7fffff;
+
+    // too small even for a denormal, or infinite (NaN isn't expected here)
+    if( exponent < -10 )
+        return GLushort(sign);
+    if( exponent >= 31 )
+        return GLushort(sign | 0x7c00);
+
+    // denormals shift the implicit one down into the mantissa
+    if( exponent <= 0 )
+    {
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int halfway = 1u << (shift - 1);
+        if( rest > halfway || (rest == halfway && (half & 1)) )
+            half++;
+        return GLushort(sign | half);
+    }
+
+    // round to nearest even; a carry out of the mantissa bumps the exponent,
+    // which is still correct
+    unsigned int half = (unsigned int)(exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+    if( rest > 0x1000 || (rest == 0x1000 && (half & 1)) )
+        half++;
+    return GLushort(sign | half);
+}
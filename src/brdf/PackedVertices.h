@@ -0,0 +1,91 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef PACKED_VERTICES_H
+#define PACKED_VERTICES_H
+
+#include "SharedContextGLWidget.h"
+
+class DGLShader;
+
+
+#define PACKED_POSITION_FLOAT 0
+#define PACKED_POSITION_HALF 1
+
+
+/*
+The interleaved vertex layout SimpleModel and Sphere upload: the position as
+three floats (or three half floats and a pad), then the normal and the
+tangent, as two snorm16s each. That's 20 bytes a vertex (16 with half
+positions), where separate float buffers took 24 for a model and 56 for a
+sphere.
+
+The normal is octahedrally mapped onto a square. The tangent is stored as its
+angle about the normal, measured from the tangent tangentFrame() (in
+MeshFrames.h) picks for that normal, and the handedness of the bitangent.
+brdfIBL.vert decodes both.
+*/
+
+class PackedVertices : GLContext
+{
+public:
+    static int stride( int positionFormat );
+
+    // positions and normals are xyz triples, tangents xyzw with the handedness
+    // in w (bitangent = w * cross(normal, tangent)); tangents may be NULL,
+    // leaving each vertex with the frame tangentFrame() picks
+    static void pack( int positionFormat, int numVertices, const float* positions,
+                      const float* normals, const float* tangents, void* vertices );
+
+    // points the shader's vtx_position, vtx_normal and vtx_tangent at the
+    // buffer bound to GL_ARRAY_BUFFER
+    static void setAttributes( const DGLShader* shader, int positionFormat );
+
+    static void octEncode( const float* v, GLshort* e );
+    static void octDecode( const GLshort* e, float* v );
+    static GLushort floatToHalf( float f );
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// calls func(i) for every i in [begin, end), spreading the calls across the
+// hardware threads. Items are handed out one at a time, so this is meant for
+// a modest number of chunky work items (cube faces, mesh chunks, ...).
+template <typename Func>
+void parallelFor( int begin, int end, Func func )
+{
+    int numItems = end - begin;
+    if( numItems <= 0 )
+        return;
+
+    int numThreads = std::min( (int)std::thread::hardware_concurrency(), numItems );
+    if( numThreads <= 1 )
+    {
+        for( int i = begin; i < end; i++ )
+            func( i );
+        return;
+    }
+
+    std::atomic<int> next( begin );
+    auto worker = [&]()
+    {
+        for( int i = next++; i < end; i = next++ )
+            func( i );
+    };
+
+    // the calling thread does its share of the work too
+    std::vector<std::thread> threads;
+    for( int t = 1; t < numThreads; t++ )
+        threads.push_back( std::thread( worker ) );
+    worker();
+
+    for( size_t t = 0; t < threads.size(); t++ )
+        threads[t].join();
+}
+
+#endif
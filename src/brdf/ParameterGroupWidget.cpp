@@ -49,6 +49,8 @@ infringement.
 
 #include <QVBoxLayout>
 #include <QCheckBox>
+#include <QComboBox>
+#include <QSpinBox>
 #include <QMenu>
 #include <QFileDialog>
 #include <QString>
@@ -322,6 +324,9 @@ void ParameterGroupWidget::paramChanged()
 
 void ParameterGroupWidget::addParameterWidgets()
 {
+    sweepCombo = NULL;
+    sweepCountSpinBox = NULL;
+
     // no BRDF? No parameters to load.
     if( !brdf )
             return;
@@ -365,6 +370,52 @@ void ParameterGroupWidget::addParameterWidgets()
             break;
         }
     }
+
+    // any float parameter can be swept across its range, which the plots
+    // show as a curve per value
+    if( brdf->getFloatParameterCount() == 0 )
+        return;
+
+    QFrame* sweepFrame = new QFrame;
+    QHBoxLayout* sweepLayout = new QHBoxLayout;
+    sweepLayout->setMargin( 0 );
+    sweepLayout->setContentsMargins( 0, 0, 0, 0 );
+    sweepFrame->setLayout( sweepLayout );
+
+    sweepCombo = new QComboBox();
+    sweepCombo->addItem( "No Sweep" );
+    for( int i = 0; i < brdf->getFloatParameterCount(); i++ )
+        sweepCombo->addItem( QString("Sweep ") + QString(brdf->getFloatParameter(i)->name.c_str()) );
+    sweepCombo->setToolTip( "Plot A Curve For Each Value Of A Parameter" );
+    connect( sweepCombo, SIGNAL(activated(int)), this, SLOT(paramChanged()) );
+    sweepLayout->addWidget( sweepCombo );
+
+    sweepCountSpinBox = new QSpinBox();
+    sweepCountSpinBox->setRange( 2, MAX_SWEEP_CURVES );
+    sweepCountSpinBox->setValue( 8 );
+    sweepCountSpinBox->setSuffix( " curves" );
+    sweepCountSpinBox->setToolTip( "Number Of Curves In The Sweep" );
+    connect( sweepCountSpinBox, SIGNAL(valueChanged(int)), this, SLOT(paramChanged()) );
+    sweepLayout->addWidget( sweepCountSpinBox );
+
+    containerLayout->addWidget( sweepFrame );
+}
+
+
+void ParameterGroupWidget::setSweep( brdfPackage& pkg )
+{
+    if( !sweepCombo || sweepCombo->currentIndex() < 1 )
+        return;
+
+    // the first entry is "No Sweep"
+    const brdfFloatParam* p = brdf->getFloatParameter( sweepCombo->currentIndex() - 1 );
+    if( !p )
+        return;
+
+    pkg.sweepParameter = sweepCombo->currentIndex() - 1;
+    pkg.sweepMin = p->minVal;
+    pkg.sweepMax = p->maxVal;
+    pkg.sweepCount = sweepCountSpinBox->value();
 }
 
 
@@ -51,8 +51,11 @@ infringement.
 class QVBoxLayout;
 class QPushButton;
 class QCheckBox;
+class QComboBox;
+class QSpinBox;
 class ParameterWindow;
 class BRDFBase;
+struct brdfPackage;
 
 
 struct BRDFParamWidget
@@ -80,6 +83,9 @@ public:
     // returns either an updated BRDF (with all parameters set) or NULL
     BRDFBase* getUpdatedBRDF();
     QColor getDrawColor();
+
+    // fills in the package's parameter sweep, if one's been picked
+    void setSweep( brdfPackage& pkg );
     
     bool isDirty() { return dirty; }
     void setDirty( bool d ) { dirty = d; }
@@ -119,6 +125,8 @@ private:
     QPushButton* titleButton;
     QFrame* containerFrame;
     QVBoxLayout* containerLayout;
+    QComboBox* sweepCombo;
+    QSpinBox* sweepCountSpinBox;
     
     bool dirty;
 
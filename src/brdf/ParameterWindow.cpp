@@ -313,6 +313,7 @@ void ParameterWindow::emitBRDFListChanged()
 
             // set the BRDF
             pkg.brdf = brdf;
+            soloBRDFWidget->setSweep( pkg );
 
             // if we are we displaying all three channels, 
             if( soloBRDFUsesColors )
@@ -386,6 +387,7 @@ std::vector<brdfPackage> ParameterWindow::getBRDFList()
 
             // set the BRDF
             pkg.brdf = brdf;
+            pgw->setSweep( pkg );
 
             // set the draw color
             QColor drawColor = pgw->getDrawColor();
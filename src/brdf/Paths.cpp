@@ -43,6 +43,8 @@ implied warranties of merchantability, fitness for a particular purpose and non-
 infringement.
 */
 
+#include <QStandardPaths>
+#include <QDir>
 #include "Paths.h"
 
 
@@ -68,3 +70,12 @@ std::string getProbesPath()
 {
     return "./probes/";
 }
+
+
+std::string getCachePath()
+{
+    // per-user cache directory, created the first time it's asked for
+    QString path = QStandardPaths::writableLocation( QStandardPaths::CacheLocation );
+    QDir().mkpath( path );
+    return path.toStdString() + "/";
+}
@@ -93,12 +93,9 @@ Plot3DWidget::~Plot3DWidget()
     // delete the VBO
     glf->glDeleteVertexArrays(1, &hemisphereVerticesVAO);
     glf->glDeleteBuffers(1, &hemisphereVerticesVBO);
-    glf->glDeleteVertexArrays(1, &planeVAO);
-    glf->glDeleteBuffers(1, &planeVBO);
-    glf->glDeleteVertexArrays(1, &directionVAO);
-    glf->glDeleteBuffers(2, directionVBO);
-    glf->glDeleteVertexArrays(1, &circleVAO);
-    glf->glDeleteBuffers(2, circleVBO);
+    delete plane;
+    delete directionLines;
+    delete circle;
 
     delete planeShader;
     delete plotShader;
@@ -126,7 +123,9 @@ void Plot3DWidget::initializeGL()
     planeShader = new DGLShader( (getShaderTemplatesPath() + "Plane.vert").c_str(),
                                  (getShaderTemplatesPath() + "Plane.frag").c_str() );
     createPlaneVAO();
-    createDirectionVAO();
+
+    directionLines = new PlotGeometry( &uploads );
+    updateDirectionVAO();
 }
 
 
@@ -141,20 +140,8 @@ void Plot3DWidget::createPlaneVAO()
     vertices.push_back(glm::vec3(-planeSize, planeSize, planeHeight));
     vertices.push_back(glm::vec3(-planeSize, -planeSize, planeHeight));
 
-    glf->glGenVertexArrays(1, &planeVAO);
-    glf->glBindVertexArray(planeVAO);
-
-    glf->glGenBuffers(1, &planeVBO);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    GLint vertex_loc = planeShader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(vertex_loc);
-    }
-
-    glf->glBindVertexArray(0);
-
+    plane = new PlotGeometry( &uploads );
+    plane->set( planeShader->getAttribLocation("vtx_position"), vertices );
 
     vertices.clear();
     std::vector<glm::vec3> colors;
@@ -170,32 +157,13 @@ void Plot3DWidget::createPlaneVAO()
         ucAngle += ucInc;
     }
 
-    glf->glGenVertexArrays(1, &circleVAO);
-    glf->glBindVertexArray(circleVAO);
-
-    glf->glGenBuffers(2, circleVBO);
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, circleVBO[0]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    vertex_loc = plotShader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(vertex_loc);
-    }
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, circleVBO[1]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), colors.data(), GL_STATIC_DRAW);
-    int color_loc = plotShader->getAttribLocation("vtx_color");
-    if(color_loc>=0){
-        glf->glEnableVertexAttribArray(color_loc);
-        glf->glVertexAttribPointer(color_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glBindVertexArray(0);
+    circle = new PlotGeometry( &uploads );
+    circle->set( plotShader->getAttribLocation("vtx_position"), vertices,
+                 plotShader->getAttribLocation("vtx_color"), colors );
 }
 
 
-void Plot3DWidget::createDirectionVAO()
+void Plot3DWidget::updateDirectionVAO()
 {
     const float vectorLength = 5.0;
 
@@ -234,26 +202,8 @@ void Plot3DWidget::createDirectionVAO()
     vertices.push_back(glm::vec3(0, 0, 0));
     vertices.push_back(glm::vec3(0, planeSize, 0));
 
-    glf->glGenVertexArrays(1, &directionVAO);
-    glf->glBindVertexArray(directionVAO);
-
-    glf->glGenBuffers(2, directionVBO);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, directionVBO[0]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    int vertex_loc = plotShader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glEnableVertexAttribArray(vertex_loc);
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, directionVBO[1]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), colors.data(), GL_STATIC_DRAW);
-    int color_loc = plotShader->getAttribLocation("vtx_color");
-    if(color_loc>=0){
-        glf->glEnableVertexAttribArray(color_loc);
-        glf->glVertexAttribPointer(color_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-    glf->glBindVertexArray(0);
+    directionLines->set( plotShader->getAttribLocation("vtx_position"), vertices,
+                         plotShader->getAttribLocation("vtx_color"), colors );
 }
 
 
@@ -342,15 +292,8 @@ void Plot3DWidget::paintGL()
     plotShader->setUniformFloat("nearPlane_dist", nearPlane);
     plotShader->setUniformFloat("thickness", 3.f);
 
-    glf->glBindVertexArray(directionVAO);
-
-    glf->glDrawArrays(GL_LINES, 0, 10);
-
-    glf->glBindVertexArray(circleVAO);
-
-    glf->glDrawArrays(GL_LINE_LOOP, 0, 60);
-
-    glf->glBindVertexArray(0);
+    directionLines->draw( GL_LINES );
+    circle->draw( GL_LINE_LOOP );
 
     plotShader->disable();
 
@@ -361,14 +304,12 @@ void Plot3DWidget::paintGL()
     planeShader->setUniformMatrix4("modelViewMatrix",  glm::value_ptr(modelViewMatrix));
     planeShader->setUniformFloat("drawColor",0.5, 0.5, 0.5);
 
-    glf->glBindVertexArray(planeVAO);
-
-    glf->glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glf->glBindVertexArray(0);
+    plane->draw( GL_TRIANGLES );
 
     planeShader->disable();
 
+    uploads.endFrame();
+
     glcontext->swapBuffers(this);
 }
 
@@ -483,6 +424,7 @@ void Plot3DWidget::makeGeodesicHemisphereVBO()
 
     // copy the data into a buffer on the GPU
     glf->glBufferData(GL_ARRAY_BUFFER, numTrianglesInHemisphere*sizeof(float)*9, hemisphereVertices, GL_STATIC_DRAW);
+    uploads.add( numTrianglesInHemisphere*sizeof(float)*9 );
     glf->glBindVertexArray(0);
 
     // now that the hemisphere vertices are on the GPU, we're done with the local copy
@@ -497,9 +439,9 @@ void Plot3DWidget::incidentDirectionChanged( float theta, float phi )
     inTheta = theta;
     inPhi = phi;
 
-    glf->glDeleteVertexArrays(1, &directionVAO);
-    glf->glDeleteBuffers(2, directionVBO);
-    createDirectionVAO();
+    // the lines keep their buffers; only the vertices are sent again
+    glcontext->makeCurrent(this);
+    updateDirectionVAO();
 
     // repaint!
     updateGL();
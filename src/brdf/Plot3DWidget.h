@@ -48,6 +48,7 @@ infringement.
 
 #include "BRDFBase.h"
 #include "SharedContextGLWidget.h"
+#include "PlotGeometry.h"
 
 class Plot3DWidget : public GLWindow
 {
@@ -60,6 +61,8 @@ public:
     QSize minimumSizeHint() const;
     QSize sizeHint() const;
 
+    const PlotUploadCounter& getUploadCounter() const { return uploads; }
+
 private slots:
     void incidentDirectionChanged( float theta, float phi );
     void graphParametersChanged( bool logPlot, bool nDotL );
@@ -80,15 +83,16 @@ private:
 	void makeGeodesicHemisphereVBO();
     void drawBRDFHemisphere( brdfPackage brdf );
     void createPlaneVAO();
-    void createDirectionVAO();
+    void updateDirectionVAO();
 
 	GLuint hemisphereVerticesVBO;
     GLuint hemisphereVerticesVAO;
 	int numTrianglesInHemisphere;	
 
-    GLuint planeVAO, planeVBO;
-    GLuint circleVAO, circleVBO[2];
-    GLuint directionVAO, directionVBO[2];
+    PlotGeometry* plane;
+    PlotGeometry* circle;
+    PlotGeometry* directionLines;
+    PlotUploadCounter uploads;
 
 	float lookPhi;
 	float lookTheta;
@@ -45,11 +45,17 @@ infringement.
 
 
 #include <QtGui>
+#include <QTimer>
 #include <QString>
 #include <math.h>
 #include <iostream>
+#include <map>
 #include "DGLShader.h"
+#include "DGLFrameBuffer.h"
 #include "PlotCartesianWidget.h"
+#include "CurveSampler.h"
+#include "AlbedoCurveCache.h"
+#include "RenderCache.h"
 #include "Paths.h"
 
 PlotCartesianWidget::PlotCartesianWidget(QWindow *parent, std::vector<brdfPackage> bList, int type )
@@ -67,6 +73,18 @@ PlotCartesianWidget::PlotCartesianWidget(QWindow *parent, std::vector<brdfPackag
     useNDotL = false;
     useSampleMult = false;
 
+    axisGridLevel = -1;
+    dataLineStart = dataLineEnd = 0.0;
+    dataLineSegments = 0;
+    labelsUploaded = 0;
+    curvesDirty = true;
+    curveSampler = NULL;
+    albedoCurves = NULL;
+
+    albedoTimer = new QTimer( this );
+    albedoTimer->setSingleShot( true );
+    connect( albedoTimer, SIGNAL(timeout()), this, SLOT(albedoTimerFired()) );
+
     initializeGL();
 }
 
@@ -93,16 +111,15 @@ void PlotCartesianWidget::resetViewingParams()
 PlotCartesianWidget::~PlotCartesianWidget()
 {
     glcontext->makeCurrent(this);
-    glf->glDeleteVertexArrays(1,&axisVAO);
-    glf->glDeleteBuffers(2,axisVBO);
+    delete axisLines;
+    delete dataLine;
+    delete curveSampler;
+    delete albedoCurves;
 
     glf->glDeleteTextures(1,&textTexureID);
     glf->glDeleteVertexArrays(1,&textVAO);
     glf->glDeleteBuffers(1,&textVBO);
 
-    glf->glDeleteVertexArrays(1, &dataLineVAO);
-    glf->glDeleteBuffers(1, &dataLineVBO);
-
     delete plotShader;
     delete textShader;
 }
@@ -135,14 +152,15 @@ void PlotCartesianWidget::initializeGL()
     plotShader = new DGLShader( (getShaderTemplatesPath() + "Plots.vert").c_str(),
                                 (getShaderTemplatesPath() + "Plots.frag").c_str(),
                                 (getShaderTemplatesPath() + "Plots.geom").c_str());
-    glf->glGenVertexArrays(1,&axisVAO);
-    glf->glGenBuffers(2, axisVBO);
+    axisLines = new PlotGeometry( &uploads );
     updateAxisVAO();
 
-    glf->glGenVertexArrays(1, &dataLineVAO);
-    glf->glGenBuffers(1, &dataLineVBO);
+    dataLine = new PlotGeometry( &uploads );
+    curveSampler = new CurveSampler();
+    albedoCurves = new AlbedoCurveCache();
     fWidth = float(width()*devicePixelRatio());
     fHeight = float(height()*devicePixelRatio());
+    mAspect = fHeight > 0.f ? fWidth / fHeight : 1.f;
     updateInputDataLineVAO();
 }
 
@@ -179,13 +197,22 @@ void PlotCartesianWidget::initializeText()
 
 void PlotCartesianWidget::updateAxisVAO()
 {
+    float zoomY = lookZoom * 1.0f/scaleY;
+
+    // the grid only changes when the zoom crosses one of the levels
+    int gridLevel = 0;
+    while( gridLevel < 3 && zoomY < zoomLevel[gridLevel] )
+        gridLevel++;
+    if( gridLevel == axisGridLevel )
+        return;
+    axisGridLevel = gridLevel;
+
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec3> colors;
 
     float minX = -M_PI_2;
     float maxX = M_PI_2;
 
-    float zoomY = lookZoom * 1.0f/scaleY;
     // y ticks
     for( int i = 1; i <= 10; i++ )
     {
@@ -265,30 +292,8 @@ void PlotCartesianWidget::updateAxisVAO()
 
 
 
-    glf->glBindVertexArray(axisVAO);
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, axisVBO[0]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-
-    int vertex_loc = plotShader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glEnableVertexAttribArray(vertex_loc);
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, axisVBO[1]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), colors.data(), GL_STATIC_DRAW);
-
-    int color_loc = plotShader->getAttribLocation("vtx_color");
-    if(color_loc>=0){
-        glf->glEnableVertexAttribArray(color_loc);
-        glf->glVertexAttribPointer(color_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glBindVertexArray(0);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    axisNIndices = vertices.size();
+    axisLines->set( plotShader->getAttribLocation("vtx_position"), vertices,
+                    plotShader->getAttribLocation("vtx_color"), colors );
 }
 
 void PlotCartesianWidget::updateInputDataLineVAO()
@@ -300,41 +305,103 @@ void PlotCartesianWidget::updateInputDataLineVAO()
     double thetaend = (centerX + 1.0*mAspect*lookZoom)/scaleX;
     if (thetastart < -0.5*M_PI || sliceType == THETA_H_PLOT) thetastart = -0.5*M_PI;
     if (thetaend > 0.5*M_PI  || sliceType == THETA_H_PLOT) thetaend = 0.5*M_PI;
-    const double inc = (thetaend-thetastart) / (double)nlinesegments;
+
+    // panning a clamped range, or the theta_h plot, leaves the line as it
+    // is; it's only resampled when the curves themselves change
+    if( thetastart == dataLineStart && thetaend == dataLineEnd &&
+        nlinesegments == dataLineSegments && !curvesDirty )
+        return;
+    dataLineStart = thetastart;
+    dataLineEnd = thetaend;
+    dataLineSegments = nlinesegments;
+    curvesDirty = false;
 
     std::vector<glm::vec3> vertices;
-    vertices.reserve(nlinesegments);
 
-    vertices.push_back(glm::vec3(thetastart, 0.0, thetastart ));
-    for( int i = 1; i < nlinesegments - 1 ; i++ )
+    if( sliceType == ALBEDO_PLOT )
     {
-        double theta = thetastart + (i+0.5) * inc;
-        if (sliceType == THETA_H_PLOT) {
-            // square thetaH to concentrate samples around thetaH==0
-            theta *= theta * (1.0/(0.5*M_PI)) * (theta > 0 ? -1 : 1);
-        } else if (sliceType == ALBEDO_PLOT) {
+        const double inc = (thetaend-thetastart) / (double)nlinesegments;
+        vertices.reserve(nlinesegments);
+
+        vertices.push_back(glm::vec3(thetastart, 0.0, thetastart ));
+        for( int i = 1; i < nlinesegments - 1 ; i++ )
+        {
+            double theta = thetastart + (i+0.5) * inc;
             // limit number of directions albedo is calculated on
             if (theta>=-1.0*inc && (i%4 == 0 || i==nlinesegments-1) )
                 vertices.push_back(glm::vec3(theta, 0.0, theta ));
+            vertices.push_back(glm::vec3(theta, 0.0, theta ));
         }
-        vertices.push_back(glm::vec3(theta, 0.0, theta ));
+        vertices.push_back(glm::vec3(thetaend, 0.0, thetaend));
+
+        if(!vertices.empty())
+            vertices.push_back(vertices.front());
+
+        dataLineNPoints = vertices.size()-3;
     }
-    vertices.push_back(glm::vec3(thetaend, 0.0, thetaend));
+    else
+    {
+        // put the vertices where the curves need them; the ends are
+        // repeated to give the line its adjacency
+        std::vector<float> angles;
+        sampleCurves( thetastart, thetaend, nlinesegments, angles );
 
-    if(!vertices.empty())
-        vertices.push_back(vertices.front());
+        vertices.push_back(glm::vec3(angles.front(), 0.0, angles.front()));
+        for( int i = 0; i < (int)angles.size(); i++ )
+            vertices.push_back(glm::vec3(angles[i], 0.0, angles[i]));
+        vertices.push_back(glm::vec3(angles.back(), 0.0, angles.back()));
 
-    dataLineNPoints = vertices.size()-3;
+        dataLineNPoints = vertices.size();
+    }
 
-    glf->glBindVertexArray(dataLineVAO);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, dataLineVBO);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    const int vertex_loc = 0;
+    // the plot templates have just the one input
+    dataLine->set( 0, vertices );
+}
 
-    glf->glEnableVertexAttribArray(vertex_loc);
-    glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glf->glBindVertexArray(0);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, 0);
+void PlotCartesianWidget::sampleCurves( float thetaStart, float thetaEnd, int budget, std::vector<float>& angles )
+{
+    int probeMode = CURVE_PROBE_THETA_V;
+    if( sliceType == THETA_H_PLOT )
+        probeMode = CURVE_PROBE_THETA_H;
+    else if( sliceType == THETA_D_PLOT )
+        probeMode = CURVE_PROBE_THETA_D;
+
+    curveSampler->begin( thetaStart, thetaEnd );
+
+    for( int i = 0; i < (int)brdfs.size(); i++ )
+    {
+        if( !brdfs[i].brdf )
+            continue;
+
+        DGLShader* shader = brdfs[i].brdf->getUpdatedShader( SHADER_CURVE_PROBE, &brdfs[i] );
+        if( !shader )
+            continue;
+
+        // only the one for this slice is used
+        shader->setUniformFloat( "phiV", angleParam );
+        shader->setUniformFloat( "thetaD", angleParam );
+        shader->setUniformFloat( "thetaH", angleParam );
+
+        shader->setUniformFloat( "useLogPlot", useLogPlot ? 1.0 : 0.0 );
+        shader->setUniformFloat( "useNDotL", useNDotL ? 1.0 : 0.0 );
+        shader->setUniformFloat( "incidentVector", incidentVector[0], incidentVector[1], incidentVector[2] );
+        shader->setUniformFloat( "incidentPhi", inPhi );
+        curveSampler->addCurve( shader, probeMode );
+
+        // a sweep's curves are sampled at both ends of its range as well
+        brdfFloatParam* swept = brdfs[i].brdf->getFloatParameter( brdfs[i].sweepParameter );
+        if( swept && brdfs[i].sweepCount > 0 )
+        {
+            shader->setUniformFloat( swept->name.c_str(), brdfs[i].sweepMin );
+            curveSampler->addCurve( shader, probeMode );
+            shader->setUniformFloat( swept->name.c_str(), brdfs[i].sweepMax );
+            curveSampler->addCurve( shader, probeMode );
+        }
+
+        brdfs[i].brdf->disableShader( SHADER_CURVE_PROBE );
+    }
+
+    curveSampler->sample( budget, angles );
 }
 
 void PlotCartesianWidget::updateProjectionMatrix()
@@ -368,28 +435,40 @@ void PlotCartesianWidget::paintGL()
         fWidth = currentFWidth;
         fHeight = currentFHeight;
         mAspect = fWidth / fHeight;
-        updateInputDataLineVAO();
         updateProjectionMatrix();
     }
 
+    // resamples the curves if they've changed
+    updateInputDataLineVAO();
+
     glf->glViewport(0, 0, fWidth, fHeight);
     glf->glEnable(GL_MULTISAMPLE);
 
     drawAxis();
     drawLabels();
 
-    glf->glBindVertexArray(dataLineVAO);
     for( int i = 0; i < (int)brdfs.size(); i++ )
     {
         DGLShader* shader = updateShader( brdfs[i] );
-        glf->glDrawArrays(GL_LINE_STRIP_ADJACENCY, 0,  dataLineNPoints);
+        if( !shader )
+            continue;
+
+        // all of a sweep's curves go in the one draw
+        if( isSweep( brdfs[i] ) )
+        {
+            dataLine->setInstances( SWEEP_VALUE_LOCATION, brdfs[i].sweepValues() );
+            dataLine->drawInstanced( GL_LINE_STRIP_ADJACENCY, 0, dataLineNPoints );
+        }
+        else
+            dataLine->draw( GL_LINE_STRIP_ADJACENCY, 0, dataLineNPoints );
         shader->disable();
     }
-    glf->glBindVertexArray(0);
 
     glf->glDisable(GL_BLEND);
     glf->glEnable(GL_DEPTH_TEST);
 
+    uploads.endFrame();
+
     glcontext->swapBuffers(this);
 }
 
@@ -400,9 +479,7 @@ void PlotCartesianWidget::drawAxis()
     plotShader->setUniformMatrix4("modelViewMatrix",  glm::value_ptr(modelViewMatrix));
     plotShader->setUniformFloat("viewport_size", fWidth, fHeight);
     plotShader->setUniformFloat("thickness", 2.5f);
-    glf->glBindVertexArray(axisVAO);
-    glf->glDrawArrays(GL_LINES, 0, axisNIndices);
-    glf->glBindVertexArray(0);
+    axisLines->draw( GL_LINES );
     plotShader->disable();
 }
 
@@ -456,52 +533,78 @@ void PlotCartesianWidget::renderText(float pos_x, float pos_y, const QString& te
     textShader->setUniformFloat("RenderOrigin", pos_x, pos_y);
     textShader->setUniformTexture("Sampler",textTexureID);
 
-    glf->glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(char) * text.size(), text.toStdString().c_str(), GL_STATIC_DRAW);
+    // every label goes into the one character buffer the first time it's
+    // drawn, and stays there
+    std::string chars = text.toStdString();
+    std::map<std::string,int>::iterator label = labelOffsets.find( chars );
+    if( label == labelOffsets.end() )
+    {
+        label = labelOffsets.insert( std::make_pair(chars, (int)labelCharacters.size()) ).first;
+        labelCharacters.insert( labelCharacters.end(), chars.begin(), chars.end() );
+    }
 
-    int character_loc = textShader->getAttribLocation("Character");
-    glf->glVertexAttribIPointer(character_loc, 1, GL_UNSIGNED_BYTE, 1, 0);
-    glf->glEnableVertexAttribArray(character_loc);
+    if( labelsUploaded != (int)labelCharacters.size() )
+    {
+        labelsUploaded = labelCharacters.size();
+        glf->glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+        glf->glBufferData(GL_ARRAY_BUFFER, labelCharacters.size(), labelCharacters.data(), GL_STATIC_DRAW);
+        uploads.add( labelCharacters.size() );
+
+        int character_loc = textShader->getAttribLocation("Character");
+        glf->glVertexAttribIPointer(character_loc, 1, GL_UNSIGNED_BYTE, 1, 0);
+        glf->glEnableVertexAttribArray(character_loc);
+    }
 
-    glf->glDrawArrays(GL_POINTS, 0, text.size());
+    textShader->setUniformInt("FirstCharacter", label->second);
+    glf->glDrawArrays(GL_POINTS, label->second, chars.size());
 
     textShader->disable();
     glf->glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+bool PlotCartesianWidget::isSweep( const brdfPackage& pkg )
+{
+    // the albedo plot shows the BRDF as it's set
+    return pkg.sweepParameter >= 0 && pkg.sweepCount > 0 && sliceType != ALBEDO_PLOT;
+}
+
 DGLShader* PlotCartesianWidget::updateShader( brdfPackage pkg )
 {
     if( !pkg.brdf )
         return NULL;
     DGLShader* shader = NULL;
     int shaderType = 0;
+    bool sweep = isSweep( pkg );
 
     if( sliceType == THETA_V_PLOT )
     {
         shaderType = SHADER_CARTESIAN;
-        shader = pkg.brdf->getUpdatedShader( shaderType, &pkg );
+        shader = sweep ? pkg.brdf->getUpdatedSweepShader( shaderType, &pkg ) : pkg.brdf->getUpdatedShader( shaderType, &pkg );
         if( shader ) shader->setUniformFloat( "phiV", angleParam );
     }
     else if( sliceType == THETA_H_PLOT )
     {
         shaderType = SHADER_CARTESIAN_THETA_H;
-        shader = pkg.brdf->getUpdatedShader( shaderType, &pkg );
+        shader = sweep ? pkg.brdf->getUpdatedSweepShader( shaderType, &pkg ) : pkg.brdf->getUpdatedShader( shaderType, &pkg );
         if( shader ) shader->setUniformFloat( "thetaD", angleParam );
     }
     else if( sliceType == THETA_D_PLOT )
     {
         shaderType = SHADER_CARTESIAN_THETA_D;
-        shader = pkg.brdf->getUpdatedShader( shaderType, &pkg );
+        shader = sweep ? pkg.brdf->getUpdatedSweepShader( shaderType, &pkg ) : pkg.brdf->getUpdatedShader( shaderType, &pkg );
         if( shader ) shader->setUniformFloat( "thetaH", angleParam );
     }
     else if( sliceType == ALBEDO_PLOT )
     {
+        // bring the curve's samples up to date before drawing it
+        AlbedoCurve* curve = refineAlbedoCurve( pkg );
+
         shaderType = SHADER_CARTESIAN_ALBEDO;
         shader = pkg.brdf->getUpdatedShader( shaderType, &pkg );
         if( shader ) {
-            shader->setUniformInt( "nSamples", nSamples );
-            shader->setUniformFloat( "sampleMultOn", useSampleMult );
-            shader->setUniformInt( "samplingMode", samplingMode );
+            shader->setUniformTexture( "albedoCurve", curve->accum->colorBufferID() );
+            shader->setUniformInt( "numAngles", ALBEDO_CURVE_SAMPLES );
+            shader->setUniformInt( "numAlbedoSamples", curve->numSamples );
         }
     }
 
@@ -520,6 +623,42 @@ DGLShader* PlotCartesianWidget::updateShader( brdfPackage pkg )
     return shader;
 }
 
+AlbedoCurve* PlotCartesianWidget::refineAlbedoCurve( brdfPackage& pkg )
+{
+    // the draw colour and the colour mask are applied afterwards
+    RenderCacheKey key( "albedo" );
+    key.addBRDF( pkg.brdf );
+    key.addFloat( inPhi );
+    key.addInt( samplingMode );
+
+    // the target only grows, so samples once taken are always shown
+    AlbedoCurve* curve = albedoCurves->curve( key.result() );
+    curve->targetSamples = std::max( curve->targetSamples, useSampleMult ? nSamples * 10 : nSamples );
+
+    if( !AlbedoCurveCache::converged( curve ) )
+    {
+        DGLShader* shader = pkg.brdf->getUpdatedShader( SHADER_ALBEDO_CURVE, &pkg );
+        if( shader )
+        {
+            shader->setUniformFloat( "incidentPhi", inPhi );
+            shader->setUniformInt( "samplingMode", samplingMode );
+            albedoCurves->refine( curve, shader );
+            pkg.brdf->disableShader( SHADER_ALBEDO_CURVE );
+        }
+
+        // keep repainting until it's done
+        if( !AlbedoCurveCache::converged( curve ) )
+            albedoTimer->start( 10 );
+    }
+
+    return curve;
+}
+
+void PlotCartesianWidget::albedoTimerFired()
+{
+    updateGL();
+}
+
 void PlotCartesianWidget::mousePressEvent(QMouseEvent *event)
 {
     lastPos = event->pos();
@@ -537,7 +676,6 @@ void PlotCartesianWidget::mouseMoveEvent(QMouseEvent *event)
         scaleX += float(d) * scaleX * 0.05;
         scaleX = std::max<float>( scaleX, 0.01 );
         scaleX = std::min<float>( scaleX, 50.0 );
-        updateInputDataLineVAO();
         updateViewMatrix();
     }
 
@@ -562,7 +700,6 @@ void PlotCartesianWidget::mouseMoveEvent(QMouseEvent *event)
         centerX += float(-dx)*maxScalar*2.0*lookZoom;
         centerY += float( dy)*maxScalar*2.0*lookZoom;
         updateProjectionMatrix();
-        updateInputDataLineVAO();
     }
 
     // right mouse button adjusts the zoom
@@ -576,7 +713,6 @@ void PlotCartesianWidget::mouseMoveEvent(QMouseEvent *event)
         lookZoom = std::min<float>( lookZoom, 50.0f );
 
         updateAxisVAO();
-        updateInputDataLineVAO();
         updateProjectionMatrix();
     }
 
@@ -594,6 +730,7 @@ void PlotCartesianWidget::incidentDirectionChanged( float theta, float phi )
     incidentVector[0] = sin(inTheta) * cos(inPhi);
     incidentVector[1] = sin(inTheta) * sin(inPhi);
     incidentVector[2] = cos(inTheta);
+    curvesDirty = true;
 
     // repaint!
     updateGL();
@@ -604,6 +741,7 @@ void PlotCartesianWidget::graphParametersChanged( bool logPlot, bool nDotL )
     // update the graph parameters
     useLogPlot = logPlot;
     useNDotL = nDotL;
+    curvesDirty = true;
 
     // repaint!
     updateGL();
@@ -613,6 +751,7 @@ void PlotCartesianWidget::brdfListChanged( std::vector<brdfPackage> brdfList )
 {
     // replace the BRDF pointers
     brdfs = brdfList;
+    curvesDirty = true;
 
     // repaint!
     updateGL();
@@ -633,6 +772,6 @@ void PlotCartesianWidget::samplingModeChanged(int newmode)
 void PlotCartesianWidget::mouseDoubleClickEvent ( QMouseEvent *  )
 {
     resetViewingParams();
-    updateInputDataLineVAO();
+    updateAxisVAO();
     updateGL();
 }
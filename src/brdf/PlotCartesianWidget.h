@@ -48,6 +48,14 @@ infringement.
 
 #include "BRDFBase.h"
 #include "SharedContextGLWidget.h"
+#include "PlotGeometry.h"
+
+#include <map>
+
+class CurveSampler;
+class AlbedoCurveCache;
+struct AlbedoCurve;
+class QTimer;
 
 
 #define THETA_V_PLOT 0
@@ -71,6 +79,8 @@ public:
     void setAngleParam( float ap ) { angleParam = ap; }
     void setAngles( float theta, float phi, float angParam ); 
 
+    const PlotUploadCounter& getUploadCounter() const { return uploads; }
+
 public slots:
     void incidentDirectionChanged( float theta, float phi );
     void graphParametersChanged( bool logPlot, bool nDotL );
@@ -78,6 +88,9 @@ public slots:
     void samplingModeChanged(int newmode);
     void resamplePushed();
 
+private slots:
+    void albedoTimerFired();
+
 protected:
     void initializeGL();
     void paintGL();
@@ -90,6 +103,7 @@ private:
     void initializeText();
     void updateAxisVAO();
     void updateInputDataLineVAO();
+    void sampleCurves( float thetaStart, float thetaEnd, int budget, std::vector<float>& angles );
     void updateProjectionMatrix();
     void updateViewMatrix();
 
@@ -97,6 +111,8 @@ private:
     void drawLabels();
     void renderText(float pos_x, float pos_y, const QString& text, const glm::vec3 &color);
     DGLShader* updateShader(brdfPackage base);
+    bool isSweep( const brdfPackage& pkg );
+    AlbedoCurve* refineAlbedoCurve( brdfPackage& pkg );
 
     void drawThetaHSlice( DGLShader* shader );
     void drawThetaLSlice( DGLShader* shader );
@@ -139,13 +155,32 @@ private:
     int sliceType;
 
     ///OpenGL resource
-    GLuint axisVAO, axisVBO[2];
-    int axisNIndices;
+    // the grid is rebuilt when the zoom crosses a level, and the data line
+    // when the range of angles it covers changes
+    PlotGeometry* axisLines;
+    int axisGridLevel;
     DGLShader* plotShader;
     GLuint textVAO, textVBO, textTexureID;
     DGLShader* textShader;
-    GLuint dataLineVAO, dataLineVBO;
+    std::vector<char> labelCharacters;
+    std::map<std::string,int> labelOffsets;
+    int labelsUploaded;
+    PlotGeometry* dataLine;
     int dataLineNPoints;
+    double dataLineStart, dataLineEnd;
+    int dataLineSegments;
+
+    // the curves are probed again, and the vertices placed to match, only
+    // when the BRDFs, their parameters or the incident direction change
+    CurveSampler* curveSampler;
+    bool curvesDirty;
+
+    // the albedo plot's curves, with their samples kept across repaints; the
+    // timer keeps repainting while any of them is still taking samples
+    AlbedoCurveCache* albedoCurves;
+    QTimer* albedoTimer;
+
+    PlotUploadCounter uploads;
 };
 
 #endif
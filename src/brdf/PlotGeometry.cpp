@@ -0,0 +1,142 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include "PlotGeometry.h"
+
+
+PlotGeometry::PlotGeometry( PlotUploadCounter* counter ) : _numVertices(0), _counter(counter)
+{
+    glf->glGenVertexArrays( 1, &_vao );
+    glf->glGenBuffers( 3, _buffers );
+    _capacity[0] = _capacity[1] = _capacity[2] = 0;
+}
+
+
+PlotGeometry::~PlotGeometry()
+{
+    glf->glDeleteVertexArrays( 1, &_vao );
+    glf->glDeleteBuffers( 3, _buffers );
+}
+
+
+void PlotGeometry::upload( int buffer, const void* data, size_t numBytes )
+{
+    glf->glBindBuffer( GL_ARRAY_BUFFER, _buffers[buffer] );
+
+    // only grow the storage when we have to
+    if( numBytes > _capacity[buffer] )
+    {
+        glf->glBufferData( GL_ARRAY_BUFFER, numBytes, data, GL_DYNAMIC_DRAW );
+        _capacity[buffer] = numBytes;
+    }
+    else if( numBytes )
+        glf->glBufferSubData( GL_ARRAY_BUFFER, 0, numBytes, data );
+
+    if( _counter )
+        _counter->add( numBytes );
+}
+
+
+void PlotGeometry::set( int positionLocation, const std::vector<glm::vec3>& vertices,
+                        int colorLocation, const std::vector<glm::vec3>& colors )
+{
+    _numVertices = (int)vertices.size();
+
+    glf->glBindVertexArray( _vao );
+
+    upload( 0, vertices.data(), sizeof(glm::vec3) * vertices.size() );
+    if( positionLocation >= 0 )
+    {
+        glf->glVertexAttribPointer( positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0 );
+        glf->glEnableVertexAttribArray( positionLocation );
+    }
+
+    if( colorLocation >= 0 )
+    {
+        upload( 1, colors.data(), sizeof(glm::vec3) * colors.size() );
+        glf->glVertexAttribPointer( colorLocation, 3, GL_FLOAT, GL_FALSE, 0, 0 );
+        glf->glEnableVertexAttribArray( colorLocation );
+    }
+
+    glf->glBindVertexArray( 0 );
+    glf->glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
+void PlotGeometry::draw( GLenum mode, int first, int count ) const
+{
+    glf->glBindVertexArray( _vao );
+    glf->glDrawArrays( mode, first, count );
+    glf->glBindVertexArray( 0 );
+}
+
+
+void PlotGeometry::setInstances( int valueLocation, const std::vector<float>& values )
+{
+    if( values == _instanceValues )
+        return;
+    _instanceValues = values;
+
+    glf->glBindVertexArray( _vao );
+
+    upload( 2, values.data(), sizeof(float) * values.size() );
+    if( valueLocation >= 0 )
+    {
+        glf->glVertexAttribPointer( valueLocation, 1, GL_FLOAT, GL_FALSE, 0, 0 );
+        glf->glVertexAttribDivisor( valueLocation, 1 );
+        glf->glEnableVertexAttribArray( valueLocation );
+    }
+
+    glf->glBindVertexArray( 0 );
+    glf->glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
+void PlotGeometry::drawInstanced( GLenum mode, int first, int count ) const
+{
+    glf->glBindVertexArray( _vao );
+    glf->glDrawArraysInstanced( mode, first, count, (GLsizei)_instanceValues.size() );
+    glf->glBindVertexArray( 0 );
+}
@@ -0,0 +1,113 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef PLOT_GEOMETRY_H
+#define PLOT_GEOMETRY_H
+
+#include <vector>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "SharedContextGLWidget.h"
+
+
+// what a plot widget has sent to the GL for its geometry: the bytes of the
+// frame in progress, of the last finished frame, and altogether
+struct PlotUploadCounter
+{
+    PlotUploadCounter() : frameBytes(0), lastFrameBytes(0), totalBytes(0), numFrames(0) {}
+
+    void add( size_t numBytes ) { frameBytes += numBytes; totalBytes += numBytes; }
+    void endFrame() { lastFrameBytes = frameBytes; frameBytes = 0; numFrames++; }
+
+    size_t frameBytes;
+    size_t lastFrameBytes;
+    size_t totalBytes;
+    int numFrames;
+};
+
+
+/*
+Lines for the plot widgets, kept in a VAO from one frame to the next: a
+position, and optionally a colour, per vertex. Static geometry is set once;
+dynamic geometry is set again only when something it depends on changes.
+A float per instance can be added, for drawing the lines many times over.
+The buffers keep their storage, and are updated in place with
+glBufferSubData whenever the new vertices fit. Everything sent is added to
+the owning widget's counter.
+*/
+
+class PlotGeometry : GLContext
+{
+public:
+    PlotGeometry( PlotUploadCounter* counter );
+    ~PlotGeometry();
+
+    // colors is only used if colorLocation is a valid attribute location
+    void set( int positionLocation, const std::vector<glm::vec3>& vertices,
+              int colorLocation = -1, const std::vector<glm::vec3>& colors = std::vector<glm::vec3>() );
+
+    // values only reach the GL when they differ from the last ones set
+    void setInstances( int valueLocation, const std::vector<float>& values );
+
+    void draw( GLenum mode ) const { draw( mode, 0, _numVertices ); }
+    void draw( GLenum mode, int first, int count ) const;
+    void drawInstanced( GLenum mode, int first, int count ) const;
+
+    int numVertices() const { return _numVertices; }
+    int numInstances() const { return (int)_instanceValues.size(); }
+
+private:
+    void upload( int buffer, const void* data, size_t numBytes );
+
+    GLuint _vao;
+    GLuint _buffers[3];
+    size_t _capacity[3];
+    int _numVertices;
+    std::vector<float> _instanceValues;
+    PlotUploadCounter* _counter;
+};
+
+#endif
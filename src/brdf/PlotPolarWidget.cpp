@@ -50,6 +50,7 @@ infringement.
 #include <iostream>
 #include "DGLShader.h"
 #include "PlotPolarWidget.h"
+#include "CurveSampler.h"
 #include "Paths.h"
 
 
@@ -70,12 +71,19 @@ PlotPolarWidget::PlotPolarWidget(QWindow *parent, std::vector<brdfPackage> bList
 	useLogPlot = false;
 	useNDotL = false;
 
+    axisTheta = -1.f;
+    curvesDirty = true;
+
     initializeGL();
 }
 
 PlotPolarWidget::~PlotPolarWidget()
 {
     glcontext->makeCurrent(this);
+    delete dataLine;
+    delete curveSampler;
+    delete axisLines;
+    delete hemisphereOutline;
     delete plotShader;
 }
 
@@ -110,17 +118,133 @@ void PlotPolarWidget::initializeGL()
     plotShader = new DGLShader( (getShaderTemplatesPath() + "Plots.vert").c_str(),
                                 (getShaderTemplatesPath() + "Plots.frag").c_str(),
                                 (getShaderTemplatesPath() + "Plots.geom").c_str());
+
+    dataLine = new PlotGeometry( &uploads );
+    curveSampler = new CurveSampler();
+
+    // the outline of the hemisphere
+    const float c = 173.f/255.f;
+    const float c2 = 226.f/255.f;
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> colors;
+    float inc = 3.14159265 / 180.;
+    float angle = 0.0;
+    for( int i = 0; i <= 180; i++ )
+    {
+        colors.push_back(glm::vec3(c2,c2,c));
+        vertices.push_back(glm::vec3(cos(angle), sin(angle), 0));
+        angle += inc;
+    }
+
+    hemisphereOutline = new PlotGeometry( &uploads );
+    hemisphereOutline->set( plotShader->getAttribLocation("vtx_position"), vertices,
+                            plotShader->getAttribLocation("vtx_color"), colors );
+
+    axisLines = new PlotGeometry( &uploads );
+}
+
+
+void PlotPolarWidget::updateDataLine()
+{
+    if( !curvesDirty )
+        return;
+    curvesDirty = false;
+
+    curveSampler->begin( 0.f, 3.14159265f );
+
+    for( int i = 0; i < (int)brdfs.size(); i++ )
+    {
+        if( !brdfs[i].brdf )
+            continue;
+
+        DGLShader* shader = brdfs[i].brdf->getUpdatedShader( SHADER_CURVE_PROBE, &brdfs[i] );
+        if( !shader )
+            continue;
+
+        shader->setUniformFloat( "incidentVector", incidentVector[0], incidentVector[1], incidentVector[2] );
+        shader->setUniformFloat( "incidentPhi", inPhi );
+        shader->setUniformFloat( "useLogPlot", useLogPlot ? 1.0 : 0.0 );
+        shader->setUniformFloat( "useNDotL", useNDotL ? 1.0 : 0.0 );
+        curveSampler->addCurve( shader, CURVE_PROBE_POLAR );
+
+        // a sweep's curves are sampled at both ends of its range as well
+        brdfFloatParam* swept = brdfs[i].brdf->getFloatParameter( brdfs[i].sweepParameter );
+        if( swept && brdfs[i].sweepCount > 0 )
+        {
+            shader->setUniformFloat( swept->name.c_str(), brdfs[i].sweepMin );
+            curveSampler->addCurve( shader, CURVE_PROBE_POLAR );
+            shader->setUniformFloat( swept->name.c_str(), brdfs[i].sweepMax );
+            curveSampler->addCurve( shader, CURVE_PROBE_POLAR );
+        }
+
+        brdfs[i].brdf->disableShader( SHADER_CURVE_PROBE );
+    }
+
+    std::vector<float> angles;
+    curveSampler->sample( POLAR_CURVE_VERTICES, angles );
+
+    // the plot templates take a single vec3(cos, sin, angle) input, so the
+    // one line serves every BRDF's shader; the ends are repeated to give the
+    // line its adjacency
+    std::vector<glm::vec3> vertices;
+    vertices.push_back(glm::vec3(cos(angles.front()), sin(angles.front()), angles.front()));
+    for( int i = 0; i < (int)angles.size(); i++ )
+        vertices.push_back(glm::vec3(cos(angles[i]), sin(angles[i]), angles[i]));
+    vertices.push_back(glm::vec3(cos(angles.back()), sin(angles.back()), angles.back()));
+
+    dataLine->set( 0, vertices );
+}
+
+
+void PlotPolarWidget::updateAxisLines()
+{
+    // the axes only move with the incident direction
+    if( inTheta == axisTheta )
+        return;
+    axisTheta = inTheta;
+
+    float vectorSize = 2.0;
+
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> colors;
+
+    // normal vector
+    const float c = 173.f/255.f;
+    colors.push_back(glm::vec3(c, 1, c));
+    colors.push_back(glm::vec3(c, 1, c));
+    vertices.push_back(glm::vec3(0, 0, 0));
+    vertices.push_back(glm::vec3(0, vectorSize, 0));
+
+    // bottom of the hemisphere
+    colors.push_back(glm::vec3(0, 0, 0));
+    colors.push_back(glm::vec3(0, 0, 0));
+    vertices.push_back(glm::vec3(-vectorSize, 0, 0));
+    vertices.push_back(glm::vec3(vectorSize, 0, 0));
+
+    colors.push_back(glm::vec3(c, 1, 1));
+    colors.push_back(glm::vec3(c, 1, 1));
+    vertices.push_back(glm::vec3(0, 0, 0));
+    vertices.push_back(glm::vec3( vectorSize*cos(1.57079633 - inTheta) * -1.0, vectorSize*sin(1.57079633 - inTheta), 0 ));
+
+    colors.push_back(glm::vec3(1, c, 1));
+    colors.push_back(glm::vec3(1, c, 1));
+    vertices.push_back(glm::vec3(0, 0, 0));
+    vertices.push_back(glm::vec3( vectorSize*cos(1.57079633 - inTheta), vectorSize*sin(1.57079633 - inTheta), 0 ));
+
+    axisLines->set( plotShader->getAttribLocation("vtx_position"), vertices,
+                    plotShader->getAttribLocation("vtx_color"), colors );
 }
 
 
 void PlotPolarWidget::DrawBRDFHemisphere( brdfPackage pkg )
 {
     DGLShader* shader = NULL;
+    bool sweep = pkg.sweepParameter >= 0 && pkg.sweepCount > 0;
 
     // if there's a BRDF, the BRDF pbject sets up and enables the shader
     if( pkg.brdf )
     {
-        shader = pkg.brdf->getUpdatedShader( SHADER_POLAR, &pkg );
+        shader = sweep ? pkg.brdf->getUpdatedSweepShader( SHADER_POLAR, &pkg ) : pkg.brdf->getUpdatedShader( SHADER_POLAR, &pkg );
         if( shader )
         {
             glm::mat4 id(1.f);
@@ -136,41 +260,20 @@ void PlotPolarWidget::DrawBRDFHemisphere( brdfPackage pkg )
         }
     }
 
-    float inc = 3.14159265 / 360.;
-    float angle = 0.0;
-
-    std::vector<glm::vec3> vertices;
-    vertices.reserve(360);
-
-    for( int i = 0; i <= 360; i++ )
+    // all of a sweep's curves go in the one draw
+    if( shader && sweep )
     {
-        vertices.push_back(glm::vec3(cos(angle), sin(angle), angle));
-        angle += inc;
+        dataLine->setInstances( SWEEP_VALUE_LOCATION, pkg.sweepValues() );
+        dataLine->drawInstanced( GL_LINE_STRIP_ADJACENCY, 0, dataLine->numVertices() );
     }
-
-    GLuint vao;
-    glf->glGenVertexArrays(1, &vao);
-    glf->glBindVertexArray(vao);
-    GLuint vbo;
-    glf->glGenBuffers(1, &vbo);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    int vertex_loc = shader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glEnableVertexAttribArray(vertex_loc);
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glDrawArrays(GL_LINE_STRIP_ADJACENCY, 0, vertices.size());
-
-    glf->glBindVertexArray(0);
+    else if( shader )
+        dataLine->draw( GL_LINE_STRIP_ADJACENCY );
 
     // if there was a shader, now we have to disable it
-    if( pkg.brdf )
+    if( pkg.brdf && sweep )
+        pkg.brdf->disableSweepShader( SHADER_POLAR );
+    else if( pkg.brdf )
         pkg.brdf->disableShader( SHADER_POLAR );
-
-    glf->glDeleteVertexArrays(1,&vao);
-    glf->glDeleteBuffers(1,&vbo);
 }
 
 
@@ -183,8 +286,6 @@ void PlotPolarWidget::paintGL()
 
     CKGL();
 
-    float vectorSize = 2.0;
-
     incidentVector[0] = sin(inTheta) * cos(inPhi);
     incidentVector[1] = sin(inTheta) * sin(inPhi);
     incidentVector[2] = cos(inTheta);
@@ -203,31 +304,8 @@ void PlotPolarWidget::paintGL()
     projectionMatrix = glm::ortho(centerX + -1.0*aspect*lookZoom, centerX + 1.0*aspect*lookZoom,
                                   centerY + -1.0*lookZoom, centerY + 1.0*lookZoom);
 
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> colors;
-
-    // normal vector
-    const float c = 173.f/255.f;
-    colors.push_back(glm::vec3(c, 1, c));
-    colors.push_back(glm::vec3(c, 1, c));
-    vertices.push_back(glm::vec3(0, 0, 0));
-    vertices.push_back(glm::vec3(0, vectorSize, 0));
-
-    // bottom of the hemisphere
-    colors.push_back(glm::vec3(0, 0, 0));
-    colors.push_back(glm::vec3(0, 0, 0));
-    vertices.push_back(glm::vec3(-vectorSize, 0, 0));
-    vertices.push_back(glm::vec3(vectorSize, 0, 0));
-
-    colors.push_back(glm::vec3(c, 1, 1));
-    colors.push_back(glm::vec3(c, 1, 1));
-    vertices.push_back(glm::vec3(0, 0, 0));
-    vertices.push_back(glm::vec3( vectorSize*cos(1.57079633 - inTheta) * -1.0, vectorSize*sin(1.57079633 - inTheta), 0 ));
-
-    colors.push_back(glm::vec3(1, c, 1));
-    colors.push_back(glm::vec3(1, c, 1));
-    vertices.push_back(glm::vec3(0, 0, 0));
-    vertices.push_back(glm::vec3( vectorSize*cos(1.57079633 - inTheta), vectorSize*sin(1.57079633 - inTheta), 0 ));
+    updateAxisLines();
+    updateDataLine();
 
     plotShader->enable();
     glm::mat4 id(1.f);
@@ -236,66 +314,19 @@ void PlotPolarWidget::paintGL()
     plotShader->setUniformFloat("viewport_size", fWidth, fHeight);
     plotShader->setUniformFloat("thickness", 2.5f);
 
-    GLuint vao;
-    glf->glGenVertexArrays(1, &vao);
-    glf->glBindVertexArray(vao);
-    GLuint vbo[2];
-    glf->glGenBuffers(2, vbo);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    int vertex_loc = plotShader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glEnableVertexAttribArray(vertex_loc);
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), colors.data(), GL_STATIC_DRAW);
-    int color_loc = plotShader->getAttribLocation("vtx_color");
-    if(color_loc>=0){
-        glf->glEnableVertexAttribArray(color_loc);
-        glf->glVertexAttribPointer(color_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    glf->glDrawArrays(GL_LINES, 0, vertices.size());
-
-
-    // draw the hemisphere
-    colors.clear();
-    vertices.clear();
-
-    const float c2 = 226.f/255.f;
-
-    float inc = 3.14159265 / 180.;
-    float angle = 0.0;
-
-    for( int i = 0; i <= 180; i++ )
-    {
-        colors.push_back(glm::vec3(c2,c2,c));
-        vertices.push_back(glm::vec3(cos(angle), sin(angle), 0));
-        angle += inc;
-    }
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    glf->glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), colors.data(), GL_STATIC_DRAW);
-
-    glf->glDrawArrays(GL_LINE_STRIP, 0, vertices.size());
-
-    glf->glBindVertexArray(0);
+    axisLines->draw( GL_LINES );
+    hemisphereOutline->draw( GL_LINE_STRIP );
 
     plotShader->disable();
 
-    glf->glDeleteVertexArrays(1,&vao);
-    glf->glDeleteBuffers(2,vbo);
-
     // draw the hemispheres
     for( int i = 0; i < (int)brdfs.size(); i++ )
         DrawBRDFHemisphere( brdfs[i] );
 
     CKGL();
 
+    uploads.endFrame();
+
     glcontext->swapBuffers(this);
 }
 
@@ -344,6 +375,7 @@ void PlotPolarWidget::incidentDirectionChanged( float theta, float phi )
     // update the incident direction
     inTheta = theta;
     inPhi = phi;
+    curvesDirty = true;
 
     // repaint!
     updateGL();
@@ -355,6 +387,7 @@ void PlotPolarWidget::graphParametersChanged( bool logPlot, bool nDotL )
     // update the graph parameters
     useLogPlot = logPlot;
     useNDotL = nDotL;
+    curvesDirty = true;
     
     // repaint!
     updateGL();
@@ -365,6 +398,7 @@ void PlotPolarWidget::brdfListChanged( std::vector<brdfPackage> brdfList )
 {
     // replace the BRDF pointers
     brdfs = brdfList;
+    curvesDirty = true;
     
     // repaint!
     updateGL();
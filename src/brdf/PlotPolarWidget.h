@@ -48,6 +48,12 @@ infringement.
 
 #include "BRDFBase.h"
 #include "SharedContextGLWidget.h"
+#include "PlotGeometry.h"
+
+class CurveSampler;
+
+// the most vertices the BRDF curves get
+#define POLAR_CURVE_VERTICES 361
 
 class PlotPolarWidget : public GLWindow
 {
@@ -60,6 +66,8 @@ public:
     QSize minimumSizeHint() const;
     QSize sizeHint() const;
 
+    const PlotUploadCounter& getUploadCounter() const { return uploads; }
+
 private slots:
     void incidentDirectionChanged( float theta, float phi );
     void graphParametersChanged( bool logPlot, bool nDotL );
@@ -78,6 +86,8 @@ private:
     void resetViewingParams();
 
 	void DrawBRDFHemisphere( brdfPackage brdf );
+    void updateAxisLines();
+    void updateDataLine();
 
 	float lookZoom;
 	float centerX;
@@ -101,6 +111,17 @@ private:
 
     glm::mat4 projectionMatrix;
     DGLShader* plotShader;
+
+    // the hemisphere outline never changes; the axis lines are rebuilt when
+    // the incident angle they were made for changes, and the BRDF curve is
+    // resampled when the BRDFs, their parameters or the incident direction do
+    PlotGeometry* dataLine;
+    PlotGeometry* hemisphereOutline;
+    PlotGeometry* axisLines;
+    float axisTheta;
+    CurveSampler* curveSampler;
+    bool curvesDirty;
+    PlotUploadCounter uploads;
 };
 
 #endif
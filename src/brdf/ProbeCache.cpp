@@ -0,0 +1,254 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "ProbeCache.h"
+#include "Paths.h"
+
+
+#define PROBE_CACHE_MAGIC "BRDFPRB"
+#define PROBE_CACHE_VERSION 2
+
+
+ProbeCache::ProbeCache() : _sourceSize(0), _sourceHash(0)
+{
+}
+
+
+ProbeCache::~ProbeCache()
+{
+    close();
+}
+
+
+void ProbeCache::close()
+{
+    _cache.close();
+}
+
+
+int ProbeCache::faceLevelWidth( int level ) const
+{
+    int w = header().faceWidth >> level;
+    return w > 0 ? w : 1;
+}
+
+
+int ProbeCache::faceLevelHeight( int level ) const
+{
+    int h = header().faceHeight >> level;
+    return h > 0 ? h : 1;
+}
+
+
+bool ProbeCache::hashFile( const char* filename, quint64& size, quint64& hash )
+{
+    FILE* file = fopen( filename, "rb" );
+    if( !file )
+        return false;
+
+    // 64 bit FNV-1a over the whole file
+    hash = 14695981039346656037ULL;
+    size = 0;
+
+    std::vector<unsigned char> buffer( 1 << 20 );
+    size_t numRead;
+    while( (numRead = fread( &buffer[0], 1, buffer.size(), file )) > 0 )
+    {
+        for( size_t i = 0; i < numRead; i++ )
+        {
+            hash ^= buffer[i];
+            hash *= 1099511628211ULL;
+        }
+        size += numRead;
+    }
+
+    fclose( file );
+    return true;
+}
+
+
+std::string ProbeCache::cacheFilename( quint64 hash )
+{
+    char name[32];
+    snprintf( name, sizeof(name), "%016llx.probe", (unsigned long long)hash );
+    return getCachePath() + name;
+}
+
+
+bool ProbeCache::open( const char* probeFilename )
+{
+    close();
+
+    _sourceFilename.clear();
+    if( !hashFile( probeFilename, _sourceSize, _sourceHash ) )
+        return false;
+    _sourceFilename = probeFilename;
+
+    if( !_cache.open( cacheFilename( _sourceHash ), PROBE_CACHE_MAGIC, PROBE_CACHE_VERSION, sizeof(ProbeCacheHeader) ) )
+        return false;
+
+    // make sure this is really the processed version of the probe we asked for
+    const ProbeCacheHeader& h = header();
+    if( h.sourceSize != _sourceSize || h.sourceHash != _sourceHash || h.totalSize != _cache.size() ||
+        !sectionsInBounds() )
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool ProbeCache::sectionsInBounds() const
+{
+    // a corrupt header mustn't send any of the accessors past the end of the
+    // mapping. The size limits keep the section sizes below from overflowing
+    const ProbeCacheHeader& h = header();
+    if( h.faceWidth < 1 || h.faceWidth > 65536 || h.faceHeight < 1 || h.faceHeight > 65536 ||
+        h.numFaceLevels < 1 || h.numFaceLevels > 16 || h.numPyramidLevels > 16 ||
+        h.tableLevel >= h.numFaceLevels ||
+        h.tableWidth != quint32( std::max( int(h.faceWidth >> h.tableLevel), 1 ) * 6 ) ||
+        h.tableHeight != quint32( std::max( int(h.faceHeight >> h.tableLevel), 1 ) ) )
+        return false;
+
+    for( int level = 0; level < (int)h.numFaceLevels; level++ )
+    {
+        quint64 numTexels = 6 * quint64(faceLevelWidth( level )) * faceLevelHeight( level );
+        if( !_cache.sectionFits( h.faceLevelOffsets[level], numTexels * 3 * sizeof(float) ) )
+            return false;
+    }
+
+    quint64 numTableTexels = quint64(h.tableWidth) * h.tableHeight;
+    if( !_cache.sectionFits( h.probOffset, numTableTexels * sizeof(float) ) ||
+        !_cache.sectionFits( h.marginalProbOffset, h.tableHeight * sizeof(float) ) ||
+        !_cache.sectionFits( h.aliasOffset, numTableTexels * 4 * sizeof(float) ) )
+        return false;
+
+    for( int level = 0; level < (int)h.numPyramidLevels; level++ )
+    {
+        quint64 numTexels = quint64(h.tableWidth >> level) * (h.tableHeight >> level);
+        if( !_cache.sectionFits( h.pyramidLevelOffsets[level], numTexels * sizeof(float) ) )
+            return false;
+    }
+
+    return true;
+}
+
+
+void ProbeCache::allocate( const char* probeFilename, int faceWidth, int faceHeight,
+                           int tableLevel, bool withPyramid )
+{
+    close();
+
+    ProbeCacheHeader hdr;
+    memset( &hdr, 0, sizeof(hdr) );
+    strncpy( hdr.magic, PROBE_CACHE_MAGIC, sizeof(hdr.magic) );
+    hdr.version = PROBE_CACHE_VERSION;
+    hdr.faceWidth = faceWidth;
+    hdr.faceHeight = faceHeight;
+    hdr.tableLevel = tableLevel;
+    if( _sourceFilename != probeFilename )
+    {
+        _sourceFilename = probeFilename;
+        if( !hashFile( probeFilename, _sourceSize, _sourceHash ) )
+            _sourceSize = _sourceHash = 0;
+    }
+    hdr.sourceSize = _sourceSize;
+    hdr.sourceHash = _sourceHash;
+
+    // the sections follow the header one after the other
+    CacheFileLayout layout( sizeof(ProbeCacheHeader) );
+
+    // full mip chain, down to 1x1 faces
+    int w = faceWidth, h = faceHeight;
+    while( hdr.numFaceLevels < 16 )
+    {
+        hdr.faceLevelOffsets[hdr.numFaceLevels] = layout.addSection( sizeof(float) * 6 * w * h * 3 );
+        hdr.numFaceLevels++;
+        if( w == 1 && h == 1 )
+            break;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    // the tables have one entry per texel of the chosen mip level
+    int tableWidth = std::max( faceWidth >> tableLevel, 1 ) * 6;
+    int tableHeight = std::max( faceHeight >> tableLevel, 1 );
+    hdr.tableWidth = tableWidth;
+    hdr.tableHeight = tableHeight;
+
+    hdr.probOffset = layout.addSection( sizeof(float) * tableWidth * tableHeight );
+    hdr.marginalProbOffset = layout.addSection( sizeof(float) * tableHeight );
+    hdr.aliasOffset = layout.addSection( sizeof(float) * tableWidth * tableHeight * 4 );
+
+    // the pyramid halves the table until it's a single row
+    if( withPyramid )
+    {
+        w = tableWidth;
+        h = tableHeight;
+        while( hdr.numPyramidLevels < 16 )
+        {
+            hdr.pyramidLevelOffsets[hdr.numPyramidLevels] = layout.addSection( sizeof(float) * w * h );
+            hdr.numPyramidLevels++;
+            if( h == 1 )
+                break;
+            w /= 2;
+            h /= 2;
+        }
+    }
+
+    hdr.totalSize = layout.size();
+    _cache.allocate( cacheFilename( _sourceHash ), &hdr, sizeof(hdr), hdr.totalSize );
+}
+
+
+bool ProbeCache::save()
+{
+    return _cache.save();
+}
@@ -0,0 +1,156 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef PROBE_CACHE_H
+#define PROBE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <QtGlobal>
+#include "CacheFile.h"
+
+/*
+ProbeCache keeps the fully processed form of an environment probe on disk, so
+that re-opening a probe doesn't need to decompress the ptex file and rebuild
+the sampling tables.
+
+A cache file is keyed by a hash of the probe file's contents and holds a
+header followed by float arrays laid out exactly as they get uploaded:
+
+    - the cube map mip chain; each level is a horizontal strip of the six
+      faces (px nx py ny pz nz), with rows flipped to match GL
+    - the PDF/inverse CDF rows and the marginal inverse CDF, built from one
+      of the smaller mip levels for large probes
+    - the alias table
+    - the sampling pyramid levels (if the faces are a power of two)
+
+On a hit the file is mapped read-only and the textures are uploaded straight
+from the mapping. On a miss, allocate() sets up an in-memory copy with the
+same layout to be filled in and then save()d.
+*/
+
+// starts out like CacheFileHeader
+struct ProbeCacheHeader
+{
+    char    magic[8];
+    quint32 version;
+
+    // dimensions of a cube face, and how many mip levels are stored for the faces
+    quint32 faceWidth;
+    quint32 faceHeight;
+    quint32 numFaceLevels;
+
+    // dimensions of the sampling tables, the face mip level they were built
+    // from, and how many pyramid levels there are
+    quint32 tableWidth;
+    quint32 tableHeight;
+    quint32 tableLevel;
+    quint32 numPyramidLevels;
+
+    // identity of the source file
+    quint64 sourceSize;
+    quint64 sourceHash;
+
+    // byte offsets of the different sections, from the start of the file
+    quint64 faceLevelOffsets[16];
+    quint64 probOffset;
+    quint64 marginalProbOffset;
+    quint64 aliasOffset;
+    quint64 pyramidLevelOffsets[16];
+    quint64 totalSize;
+};
+
+
+class ProbeCache
+{
+public:
+    ProbeCache();
+    ~ProbeCache();
+
+    // maps the cached copy of the given probe, if there is an up-to-date one
+    bool open( const char* probeFilename );
+
+    // sets up an empty in-memory copy with the correct layout for the given sizes
+    void allocate( const char* probeFilename, int faceWidth, int faceHeight,
+                   int tableLevel, bool withPyramid );
+
+    // writes the in-memory copy into the cache directory
+    bool save();
+
+    // unmaps or frees the data
+    void close();
+
+    bool isValid() const { return _cache.isValid(); }
+
+    const ProbeCacheHeader& header() const { return *(const ProbeCacheHeader*)_cache.data(); }
+
+    // pointers to the different sections. Data from a mapped file is read-only.
+    float* faceLevel( int level )    { return section( header().faceLevelOffsets[level] ); }
+    float* probTex()                 { return section( header().probOffset ); }
+    float* marginalProbTex()         { return section( header().marginalProbOffset ); }
+    float* aliasTex()                { return section( header().aliasOffset ); }
+    float* pyramidLevel( int level ) { return section( header().pyramidLevelOffsets[level] ); }
+
+    // dimensions of a given face mip level
+    int faceLevelWidth( int level ) const;
+    int faceLevelHeight( int level ) const;
+
+private:
+    float* section( quint64 offset ) { return (float*)(_cache.data() + offset); }
+    bool sectionsInBounds() const;
+
+    static bool hashFile( const char* filename, quint64& size, quint64& hash );
+    static std::string cacheFilename( quint64 hash );
+
+    CacheFile _cache;
+
+    // the identity of the last probe hashed, so that allocate() after a
+    // missed open() doesn't read the whole probe file again
+    std::string _sourceFilename;
+    quint64 _sourceSize;
+    quint64 _sourceHash;
+};
+
+#endif
@@ -0,0 +1,1230 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QElapsedTimer>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include "ptex/Ptexture.h"
+#include "bitmapContainer.h"
+#include "ProbeLibrary.h"
+#include "ProbeCache.h"
+#include "ParallelFor.h"
+#include "DGLShader.h"
+#include "Quad.h"
+#include "Paths.h"
+#include "LatLongImage.h"
+#include "UploadManager.h"
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+ProbeTextures::ProbeTextures()
+    : envTexID(0), probTexID(0), marginalProbTexID(0), aliasTexID(0),
+      samplingPyramidTexID(0), numSamplingPyramidLevels(0),
+      prefilteredTexID(0), numPrefilteredLevels(0), irradianceTexID(0),
+      faceWidth(0), faceHeight(0), numColumns(0), numRows(0), tableLevel(0),
+      numBytes(0), lastUsed(0), uploadGroup(0)
+{
+    memset( shIrradiance, 0, sizeof(shIrradiance) );
+}
+
+
+ProbeLibrary::ProbeLibrary()
+    : _budget(256 << 20), _useCounter(0), _prefilterShader(NULL), _quad(NULL), _fboID(0)
+{
+}
+
+
+ProbeLibrary::~ProbeLibrary()
+{
+    for( size_t i = 0; i < _resident.size(); i++ )
+        deleteTextures( _resident[i] );
+
+    delete _prefilterShader;
+    delete _quad;
+    if( _fboID )
+        glf->glDeleteFramebuffers( 1, &_fboID );
+}
+
+
+bool ProbeLibrary::acquire( const char* filename, ProbeTextures& textures )
+{
+    _useCounter++;
+
+    // switching back to a resident probe doesn't touch the disk at all
+    for( size_t i = 0; i < _resident.size(); i++ )
+    {
+        if( _resident[i].filename == filename )
+        {
+            _resident[i].lastUsed = _useCounter;
+            textures = _resident[i];
+            return true;
+        }
+    }
+
+    printf( "opening %s... ", filename );
+
+    // use the processed copy from the cache if there is one, otherwise
+    // build it from the ptex file and save it for next time. It's shared with
+    // the uploads, which keep it around until they're done with it
+    std::shared_ptr<ProbeCache> probe( new ProbeCache );
+    if( probe->open( filename ) )
+    {
+        printf( "success (cached)\n" );
+    }
+    else
+    {
+        if( !processProbe( filename, *probe ) )
+            return false;
+
+        printf( "success\n" );
+
+        if( !probe->save() )
+            printf( "couldn't write the probe cache for %s\n", filename );
+    }
+
+    ProbeTextures loaded;
+    loaded.filename = filename;
+    loaded.faceWidth = probe->header().faceWidth;
+    loaded.faceHeight = probe->header().faceHeight;
+    loaded.lastUsed = _useCounter;
+    loaded.uploadGroup = UploadManager::instance()->newGroup();
+
+    glf->glGenTextures( 1, &loaded.envTexID );
+    glf->glGenTextures( 1, &loaded.probTexID );
+    glf->glGenTextures( 1, &loaded.marginalProbTexID );
+    glf->glGenTextures( 1, &loaded.aliasTexID );
+    glf->glGenTextures( 1, &loaded.samplingPyramidTexID );
+
+    CKGL();
+
+    createGLEnvMap( probe, loaded );
+    createGLSamplingTextures( probe, loaded );
+    createGLPrefilteredMaps( loaded );
+    computeSHIrradiance( *probe, loaded );
+
+    // the preview maps are rendered from the env map once it has all arrived
+    ProbeTextures targets = loaded;
+    UploadManager::instance()->afterUploads( loaded.uploadGroup, [this, targets]()
+    {
+        renderPrefilteredMaps( targets );
+    });
+
+    // R11F_G11F_B10F faces plus a third for the mips, then the sampling tables
+    // and the preview maps
+    size_t numTexels = size_t(loaded.numColumns) * loaded.numRows;
+    loaded.numBytes = size_t(6) * loaded.faceWidth * loaded.faceHeight * 4 * 4 / 3 +
+                      numTexels * 4 + loaded.numRows * 4 + numTexels * 16 +
+                      (loaded.numSamplingPyramidLevels ? numTexels * 4 * 4 / 3 : 0) +
+                      size_t(6) * PREFILTERED_FACE_SIZE * PREFILTERED_FACE_SIZE * 4 * 4 / 3 +
+                      size_t(6) * IRRADIANCE_FACE_SIZE * IRRADIANCE_FACE_SIZE * 4;
+
+    _resident.push_back( loaded );
+    evict();
+
+    textures = loaded;
+    return true;
+}
+
+
+bool ProbeLibrary::isReady( const ProbeTextures& textures ) const
+{
+    return !UploadManager::instance()->isPending( textures.uploadGroup );
+}
+
+
+bool ProbeLibrary::isResident( const char* filename ) const
+{
+    for( size_t i = 0; i < _resident.size(); i++ )
+        if( _resident[i].filename == filename )
+            return true;
+    return false;
+}
+
+
+void ProbeLibrary::setBudget( size_t numBytes )
+{
+    _budget = numBytes;
+    evict();
+}
+
+
+size_t ProbeLibrary::residentBytes() const
+{
+    size_t total = 0;
+    for( size_t i = 0; i < _resident.size(); i++ )
+        total += _resident[i].numBytes;
+    return total;
+}
+
+
+void ProbeLibrary::evict()
+{
+    // drop the least recently used probes until we're under budget, but
+    // always keep the most recent one (it's the one being displayed)
+    while( _resident.size() > 1 && residentBytes() > _budget )
+    {
+        size_t oldest = 0;
+        for( size_t i = 1; i < _resident.size(); i++ )
+            if( _resident[i].lastUsed < _resident[oldest].lastUsed )
+                oldest = i;
+
+        deleteTextures( _resident[oldest] );
+        _resident.erase( _resident.begin() + oldest );
+    }
+}
+
+
+void ProbeLibrary::deleteTextures( ProbeTextures& textures )
+{
+    UploadManager::instance()->cancel( textures.uploadGroup );
+
+    glf->glDeleteTextures( 1, &textures.envTexID );
+    glf->glDeleteTextures( 1, &textures.probTexID );
+    glf->glDeleteTextures( 1, &textures.marginalProbTexID );
+    glf->glDeleteTextures( 1, &textures.aliasTexID );
+    glf->glDeleteTextures( 1, &textures.samplingPyramidTexID );
+    glf->glDeleteTextures( 1, &textures.prefilteredTexID );
+    glf->glDeleteTextures( 1, &textures.irradianceTexID );
+}
+
+
+void ProbeLibrary::createGLEnvMap( std::shared_ptr<ProbeCache> probe, ProbeTextures& textures )
+{
+    const ProbeCacheHeader& header = probe->header();
+    UploadManager* uploads = UploadManager::instance();
+
+    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, textures.envTexID );
+    // the IBL view picks fractional levels from each sample's pdf
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0 );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, header.numFaceLevels - 1 );
+
+    for( int level = 0; level < (int)header.numFaceLevels; level++ )
+        for( int face = 0; face < 6; face++ )
+            glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_R11F_G11F_B10F,
+                               probe->faceLevelWidth( level ), probe->faceLevelHeight( level ), 0,
+                               GL_RGB, GL_FLOAT, NULL );
+    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+
+    // each level is stored as a strip of the six faces, so rather than copying
+    // the faces out we stream each one straight out of the strip
+    for( int level = 0; level < (int)header.numFaceLevels; level++ )
+    {
+        int w = probe->faceLevelWidth( level );
+        int h = probe->faceLevelHeight( level );
+        size_t rowBytes = size_t(w) * 6 * 3 * sizeof(float);
+
+        for( int face = 0; face < 6; face++ )
+            uploads->uploadTexture( textures.uploadGroup, textures.envTexID, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                                    level, w, h, GL_RGB, GL_FLOAT, probe->faceLevel( level ) + w * face * 3,
+                                    rowBytes, probe );
+    }
+
+    CKGL();
+}
+
+void ProbeLibrary::createGLSamplingTextures( std::shared_ptr<ProbeCache> probe, ProbeTextures& textures )
+{
+    const ProbeCacheHeader& header = probe->header();
+    UploadManager* uploads = UploadManager::instance();
+    textures.numColumns = header.tableWidth;
+    textures.numRows = header.tableHeight;
+    textures.tableLevel = header.tableLevel;
+
+    glf->glBindTexture( GL_TEXTURE_2D, textures.probTexID );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, textures.numColumns, textures.numRows, 0, GL_RED, GL_FLOAT, NULL );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+    uploads->uploadTexture( textures.uploadGroup, textures.probTexID, GL_TEXTURE_2D, 0, textures.numColumns, textures.numRows,
+                            GL_RED, GL_FLOAT, probe->probTex(), textures.numColumns * sizeof(float), probe );
+
+    glf->glBindTexture( GL_TEXTURE_2D, textures.marginalProbTexID );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+    glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, textures.numRows, 1, 0, GL_RED, GL_FLOAT, NULL );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+    uploads->uploadTexture( textures.uploadGroup, textures.marginalProbTexID, GL_TEXTURE_2D, 0, textures.numRows, 1,
+                            GL_RED, GL_FLOAT, probe->marginalProbTex(), textures.numRows * sizeof(float), probe );
+
+    glf->glBindTexture( GL_TEXTURE_2D, textures.aliasTexID );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F, textures.numColumns, textures.numRows, 0, GL_RGBA, GL_FLOAT, NULL );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+    uploads->uploadTexture( textures.uploadGroup, textures.aliasTexID, GL_TEXTURE_2D, 0, textures.numColumns, textures.numRows,
+                            GL_RGBA, GL_FLOAT, probe->aliasTex(), textures.numColumns * 4 * sizeof(float), probe );
+
+    // the pyramid is only ever read with texelFetch, one level at a time
+    textures.numSamplingPyramidLevels = header.numPyramidLevels;
+    glf->glBindTexture( GL_TEXTURE_2D, textures.samplingPyramidTexID );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0 );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, std::max( textures.numSamplingPyramidLevels - 1, 0 ) );
+    for( int level = 0; level < textures.numSamplingPyramidLevels; level++ )
+        glf->glTexImage2D( GL_TEXTURE_2D, level, GL_R32F, textures.numColumns >> level, textures.numRows >> level, 0,
+                           GL_RED, GL_FLOAT, NULL );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+    for( int level = 0; level < textures.numSamplingPyramidLevels; level++ )
+        uploads->uploadTexture( textures.uploadGroup, textures.samplingPyramidTexID, GL_TEXTURE_2D, level,
+                                textures.numColumns >> level, textures.numRows >> level, GL_RED, GL_FLOAT,
+                                probe->pyramidLevel( level ), (textures.numColumns >> level) * sizeof(float), probe );
+
+    CKGL();
+}
+
+void ProbeLibrary::createGLPrefilteredMaps( ProbeTextures& textures )
+{
+    if( !_prefilterShader )
+    {
+        _prefilterShader = new DGLShader( (getShaderTemplatesPath() + "Quad.vert").c_str(),
+                                          (getShaderTemplatesPath() + "IBLPrefilter.frag").c_str() );
+        _quad = new Quad( 0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f );
+        glf->glGenFramebuffers( 1, &_fboID );
+    }
+
+    // allocate the cube maps we're going to render into
+    textures.numPrefilteredLevels = PREFILTERED_LEVELS;
+    glf->glGenTextures( 1, &textures.prefilteredTexID );
+    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, textures.prefilteredTexID );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0 );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, PREFILTERED_LEVELS - 1 );
+    for( int level = 0; level < PREFILTERED_LEVELS; level++ )
+        for( int face = 0; face < 6; face++ )
+            glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_R11F_G11F_B10F,
+                               PREFILTERED_FACE_SIZE >> level, PREFILTERED_FACE_SIZE >> level, 0,
+                               GL_RGB, GL_FLOAT, NULL );
+
+    glf->glGenTextures( 1, &textures.irradianceTexID );
+    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, textures.irradianceTexID );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glf->glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0 );
+    for( int face = 0; face < 6; face++ )
+        glf->glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_R11F_G11F_B10F,
+                           IRRADIANCE_FACE_SIZE, IRRADIANCE_FACE_SIZE, 0, GL_RGB, GL_FLOAT, NULL );
+    glf->glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+
+    CKGL();
+}
+
+
+void ProbeLibrary::renderPrefilteredMaps( const ProbeTextures& textures )
+{
+    // save the bits of state we're about to change
+    GLint lastFramebuffer, viewport[4];
+    glf->glGetIntegerv( GL_FRAMEBUFFER_BINDING, &lastFramebuffer );
+    glf->glGetIntegerv( GL_VIEWPORT, viewport );
+    GLboolean depthTest = glf->glIsEnabled( GL_DEPTH_TEST );
+    GLboolean blend = glf->glIsEnabled( GL_BLEND );
+
+    glf->glBindFramebuffer( GL_FRAMEBUFFER, _fboID );
+    glf->glDisable( GL_DEPTH_TEST );
+    glf->glDisable( GL_BLEND );
+    glf->glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+
+    glm::mat4 projection = glm::ortho( 0.f, 1.f, 0.f, 1.f );
+    glm::mat4 id(1.f);
+
+    _prefilterShader->enable();
+    _prefilterShader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(projection) );
+    _prefilterShader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(id) );
+    _prefilterShader->setUniformTexture( "envCube", textures.envTexID, GL_TEXTURE_CUBE_MAP );
+    _prefilterShader->setUniformFloat( "sourceFaceSize", float(textures.faceWidth) );
+
+    // one roughness per mip level, from a mirror at the top to fully rough at the bottom
+    _prefilterShader->setUniformFloat( "irradiance", 0.0 );
+    _prefilterShader->setUniformInt( "numSamples", 256 );
+    for( int level = 0; level < PREFILTERED_LEVELS; level++ )
+    {
+        _prefilterShader->setUniformFloat( "roughness", float(level) / float(PREFILTERED_LEVELS - 1) );
+        renderCubeFaces( textures.prefilteredTexID, PREFILTERED_FACE_SIZE >> level, level );
+    }
+
+    _prefilterShader->setUniformFloat( "irradiance", 1.0 );
+    _prefilterShader->setUniformInt( "numSamples", 512 );
+    renderCubeFaces( textures.irradianceTexID, IRRADIANCE_FACE_SIZE, 0 );
+
+    _prefilterShader->disable();
+
+    glf->glDisable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+    if( depthTest )
+        glf->glEnable( GL_DEPTH_TEST );
+    if( blend )
+        glf->glEnable( GL_BLEND );
+    glf->glViewport( viewport[0], viewport[1], viewport[2], viewport[3] );
+    glf->glBindFramebuffer( GL_FRAMEBUFFER, lastFramebuffer );
+
+    CKGL();
+}
+
+
+void ProbeLibrary::computeSHIrradiance( ProbeCache& probe, ProbeTextures& textures )
+{
+    // a small mip level is plenty for the low frequencies SH can represent
+    int level = 0;
+    while( level < (int)probe.header().numFaceLevels - 1 &&
+           (probe.faceLevelWidth( level ) > SH_PROJECTION_FACE_SIZE ||
+            probe.faceLevelHeight( level ) > SH_PROJECTION_FACE_SIZE) )
+        level++;
+
+    int w = probe.faceLevelWidth( level ), h = probe.faceLevelHeight( level );
+    const color3* texels = (const color3*)probe.faceLevel( level );
+
+    // each face accumulates on its own, then the faces get summed up
+    double faceSH[6][27];
+    double faceWeight[6];
+
+    parallelFor( 0, 6, [&]( int face )
+    {
+        double* sh = faceSH[face];
+        memset( sh, 0, sizeof(double) * 27 );
+        faceWeight[face] = 0.0;
+
+        for( int y = 0; y < h; y++ )
+        {
+            float tc = 2.f * (float(y) + 0.5f) / float(h) - 1.f;
+            for( int x = 0; x < w; x++ )
+            {
+                float sc = 2.f * (float(x) + 0.5f) / float(w) - 1.f;
+
+                // the strip is laid out like the GL cube map faces
+                glm::vec3 dir;
+                switch( face )
+                {
+                    case 0:  dir = glm::vec3(  1.f, -tc, -sc ); break;
+                    case 1:  dir = glm::vec3( -1.f, -tc,  sc ); break;
+                    case 2:  dir = glm::vec3(  sc,  1.f,  tc ); break;
+                    case 3:  dir = glm::vec3(  sc, -1.f, -tc ); break;
+                    case 4:  dir = glm::vec3(  sc, -tc,  1.f ); break;
+                    default: dir = glm::vec3( -sc, -tc, -1.f ); break;
+                }
+
+                // solid angle of the texel
+                float r2 = glm::dot( dir, dir );
+                double dw = 4.0 / (double(w) * h * r2 * sqrtf(r2));
+                dir /= sqrtf(r2);
+
+                float basis[9];
+                basis[0] = 0.282095f;
+                basis[1] = 0.488603f * dir.y;
+                basis[2] = 0.488603f * dir.z;
+                basis[3] = 0.488603f * dir.x;
+                basis[4] = 1.092548f * dir.x * dir.y;
+                basis[5] = 1.092548f * dir.y * dir.z;
+                basis[6] = 0.315392f * (3.f * dir.z * dir.z - 1.f);
+                basis[7] = 1.092548f * dir.x * dir.z;
+                basis[8] = 0.546274f * (dir.x * dir.x - dir.y * dir.y);
+
+                const color3& c = texels[y*w*6 + face*w + x];
+                for( int i = 0; i < 9; i++ )
+                {
+                    sh[i*3+0] += c.r * basis[i] * dw;
+                    sh[i*3+1] += c.g * basis[i] * dw;
+                    sh[i*3+2] += c.b * basis[i] * dw;
+                }
+                faceWeight[face] += dw;
+            }
+        }
+    });
+
+    double totalWeight = 0.0;
+    for( int face = 0; face < 6; face++ )
+        totalWeight += faceWeight[face];
+
+    // renormalize the texel solid angles to cover the sphere exactly, and
+    // convolve with the clamped cosine (pi, 2pi/3, pi/4 per band, Ramamoorthi
+    // and Hanrahan 2001) divided by pi
+    const double bandScale[3] = { 1.0, 2.0 / 3.0, 0.25 };
+    double norm = 4.0 * M_PI / totalWeight;
+
+    for( int i = 0; i < 9; i++ )
+    {
+        int band = (i == 0) ? 0 : (i < 4 ? 1 : 2);
+        for( int c = 0; c < 3; c++ )
+        {
+            double sum = 0.0;
+            for( int face = 0; face < 6; face++ )
+                sum += faceSH[face][i*3+c];
+            textures.shIrradiance[i*3+c] = float(sum * norm * bandScale[band]);
+        }
+    }
+}
+
+
+void ProbeLibrary::renderCubeFaces( GLuint texID, int faceSize, int level )
+{
+    glf->glViewport( 0, 0, faceSize, faceSize );
+
+    for( int face = 0; face < 6; face++ )
+    {
+        glf->glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                     GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, texID, level );
+        _prefilterShader->setUniformInt( "face", face );
+        _quad->draw( _prefilterShader );
+    }
+
+    glf->glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0 );
+}
+
+
+// decodes the faces side by side straight into the top level of the mip chain.
+// The stride is negative so that ptex's first row lands on the last row,
+// flipping the faces to match GL thinking!
+static void decodeFaces( PtexTexture* tx, float* level0, int faceWidth, int faceHeight )
+{
+    int rowLength = faceWidth * 6 * 3;
+    parallelFor( 0, 6, [&]( int face )
+    {
+        float* lastRow = level0 + (faceHeight-1)*rowLength + face*faceWidth*3;
+        tx->getData( face, lastRow, -rowLength * int(sizeof(float)) );
+    });
+}
+
+
+bool ProbeLibrary::processProbe( const char* filename, ProbeCache& probe )
+{
+    if( LatLongImage::canLoad( filename ) )
+        return processLatLongProbe( filename, probe );
+
+    // try and load it
+    Ptex::String error;
+    PtexTexture* tx = PtexTexture::open(filename, error);
+    if (!tx) {
+        printf( "failed\n");
+        return false;
+    }
+
+    Ptex::DataType dataType = tx->dataType();
+    int numChannels = tx->numChannels();
+    int numFaces=tx->numFaces();
+
+    if( dataType != Ptex::dt_float || numChannels != 3 || numFaces != 6 )
+    {
+        printf( "not the right kind\n" );
+        tx->release();
+        return false;
+    }
+
+    // all the faces have to match the first one
+    Ptex::Res res = tx->getFaceInfo(0).res;
+    int faceWidth = res.u(), faceHeight = res.v();
+    for( int i = 1; i < numFaces; i++ )
+    {
+        if( tx->getFaceInfo(i).res != res )
+        {
+            printf( "error loading ptex file\n" );
+            tx->release();
+            return false;
+        }
+    }
+
+    // large probes get their sampling tables from a smaller mip level; the
+    // renderer fetches radiance at that level or coarser to match
+    int tableLevel = 0;
+    while( std::max( faceWidth >> tableLevel, faceHeight >> tableLevel ) > MAX_SAMPLING_TABLE_FACE_SIZE )
+        tableLevel++;
+
+    // the hierarchical warp needs square, power-of-two faces
+    bool powerOfTwo = faceWidth == faceHeight && !(faceWidth & (faceWidth - 1));
+    probe.allocate( filename, faceWidth, faceHeight, tableLevel, powerOfTwo );
+
+    decodeFaces( tx, probe.faceLevel( 0 ), faceWidth, faceHeight );
+    tx->release();
+
+    computeEnvMapMipChain( probe );
+    computeEnvMapSamplingData( probe );
+
+    return true;
+}
+
+
+bool ProbeLibrary::processLatLongProbe( const char* filename, ProbeCache& probe )
+{
+    LatLongImage image;
+    if( !image.load( filename ) )
+    {
+        printf( "failed\n" );
+        return false;
+    }
+
+    int faceSize = image.cubeFaceSize();
+    int tableLevel = 0;
+    while( (faceSize >> tableLevel) > MAX_SAMPLING_TABLE_FACE_SIZE )
+        tableLevel++;
+
+    // the faces are always square and a power of two, so the hierarchical
+    // warp is available
+    probe.allocate( filename, faceSize, faceSize, tableLevel, true );
+
+    QElapsedTimer timer;
+    timer.start();
+    image.toCubeStrip( probe.faceLevel( 0 ), faceSize );
+    double ms = std::max( timer.nsecsElapsed() / 1000000.0, 0.001 );
+
+    double megapixels = double(faceSize) * faceSize * 6 / 1000000.0;
+    printf( "converted %dx%d lat-long to %d pixel cube faces in %.1f ms (%.1f Mpixels/s)... ",
+            image.width(), image.height(), faceSize, ms, megapixels * 1000.0 / ms );
+
+    computeEnvMapMipChain( probe );
+    computeEnvMapSamplingData( probe );
+
+    return true;
+}
+
+double ProbeLibrary::calculateProbs( const double* pdf, float* data, int numElements )
+{
+    std::vector<double> cdf(numElements);
+
+    // sum PDF
+    double pdfSum = 0;
+    for( int i = 0; i < numElements; i++ )
+        pdfSum += pdf[i];
+
+    if (pdfSum <= 0) {
+        // degenerate - no probability to reach this area
+        // make uniform CDF
+        double cdfScale = 1.0/numElements;
+        for( int i = 0; i < numElements; i++ ) {
+            cdf[i] = (i+1) * cdfScale;
+        }
+    }
+    else {
+        // compute the CDF based on normalized pdf
+        double cdfTotal = 0.0;
+        double cdfScale = 1/pdfSum;
+        for( int i = 0; i < numElements; i++ ) {
+            cdfTotal += pdf[i] * cdfScale;
+            cdf[i] = cdfTotal;
+        }
+    }
+
+    // compute the inverse CDF
+    // (center samples between 0..1 range with implied (0,0) and (1,1) points)
+    int yi = 0;
+    double oneOverNumElements = 1.0 / numElements;
+    for( int xi = 0; xi < numElements; xi++ )
+    {
+        // find segment spanning target x value
+        double x = (xi+.5) * oneOverNumElements;
+        while( cdf[yi] < x && yi < numElements-1)
+            yi++;
+
+        // interpolate segment to get corresponding y value
+        double xa = yi > 0 ? cdf[yi-1] : 0;
+        double ya = yi * oneOverNumElements;
+        double xb = cdf[yi];
+        double yb = (yi+1) * oneOverNumElements;
+        data[xi] = float(ya + (yb-ya)/(xb-xa) * (x-xa));
+    }
+
+    return pdfSum;
+}
+
+void ProbeLibrary::computeEnvMapMipChain( ProbeCache& probe )
+{
+    // box filter each face down on its own, so that no level bleeds across the face seams
+    for( int level = 1; level < (int)probe.header().numFaceLevels; level++ )
+    {
+        int srcW = probe.faceLevelWidth( level-1 ), srcH = probe.faceLevelHeight( level-1 );
+        int dstW = probe.faceLevelWidth( level ),   dstH = probe.faceLevelHeight( level );
+        const color3* src = (const color3*)probe.faceLevel( level-1 );
+        color3* dst = (color3*)probe.faceLevel( level );
+
+        parallelFor( 0, 6, [&]( int face )
+        {
+            for( int y = 0; y < dstH; y++ )
+            {
+                int y0 = std::min( 2*y, srcH-1 ), y1 = std::min( 2*y+1, srcH-1 );
+                for( int x = 0; x < dstW; x++ )
+                {
+                    int x0 = face*srcW + std::min( 2*x, srcW-1 );
+                    int x1 = face*srcW + std::min( 2*x+1, srcW-1 );
+                    const color3& a = src[y0*srcW*6 + x0];
+                    const color3& b = src[y0*srcW*6 + x1];
+                    const color3& c = src[y1*srcW*6 + x0];
+                    const color3& d = src[y1*srcW*6 + x1];
+                    dst[y*dstW*6 + face*dstW + x] = color3( (a.r + b.r + c.r + d.r) * 0.25f,
+                                                            (a.g + b.g + c.g + d.g) * 0.25f,
+                                                            (a.b + b.b + c.b + d.b) * 0.25f );
+                }
+            }
+        });
+    }
+}
+
+void ProbeLibrary::computeEnvMapSamplingData( ProbeCache& probe )
+{
+    int w = probe.header().tableWidth;
+    int h = probe.header().tableHeight;
+    float* probTex = probe.probTex();
+
+    // the tables are built in ptex row order, which is flipped from the stored faces
+    color3* envTex = (color3*)probe.faceLevel( probe.header().tableLevel );
+
+    std::vector<double> pdf(w * h);
+    std::vector<double> marginalPdf(h);
+
+    // loop through each of the rows in the image
+    for( int row = 0; row < h; row++ )
+    {
+        double y = (row + 0.5)/h * 2 - 1, ysquared = y*y;
+        double* conditionalPdf = &pdf[row * w];
+        color3* envRow = envTex + (h-row-1)*w;
+
+        // loop through the pixels of this row, computing and storing a probability for each pixel
+        for( int col = 0; col < w; col++ )
+        {
+            // compute the PDF value for this pixel
+            // (compensate for cubemap distortion - see pbrt v2 pg 947)
+            double x = ((col % (w/6)) + 0.5)/(w/6) * 2 - 1, xsquared = x*x;
+            double undistort = pow(xsquared + ysquared + 1, -1.5);
+            conditionalPdf[col] = envRow[col].luminance() * undistort;
+        }
+
+        // compute the CDF and inverse CDF for this row
+        double pdfSum = calculateProbs( conditionalPdf, probTex + row*w, w );
+
+        // save the integral of the PDF for this row in the marginal image
+        marginalPdf[row] = pdfSum;
+    }
+
+    // compute the CDF and inverse CDF for the marginal image
+    calculateProbs(&marginalPdf[0], probe.marginalProbTex(), h );
+
+    // the alternative samplers work from the same per-pixel PDF
+    computeAliasTable( pdf, (aliasEntry*)probe.aliasTex(), w );
+    computeSamplingPyramid( pdf, probe );
+}
+
+void ProbeLibrary::computeAliasTable( const std::vector<double>& pdf, aliasEntry* aliasTex, int width )
+{
+    // Walker's alias method, built in O(n) with Vose's worklists: every texel
+    // ends up with a probability of keeping itself and a single alias texel
+    // that absorbs the rest of its slot
+    int numElements = (int)pdf.size();
+    std::fill( aliasTex, aliasTex + numElements, aliasEntry() );
+
+    double pdfSum = 0;
+    for( int i = 0; i < numElements; i++ )
+        pdfSum += pdf[i];
+
+    // scale so that a texel of average probability has a weight of 1
+    std::vector<double> scaled(numElements);
+    std::vector<int> small, large;
+    small.reserve( numElements );
+    large.reserve( numElements );
+
+    for( int i = 0; i < numElements; i++ )
+    {
+        // degenerate - no probability anywhere, so sample uniformly
+        scaled[i] = pdfSum > 0 ? pdf[i] * numElements / pdfSum : 1.0;
+        aliasTex[i].pdf = float(scaled[i]);
+
+        if( scaled[i] < 1.0 )
+            small.push_back( i );
+        else
+            large.push_back( i );
+    }
+
+    while( !small.empty() && !large.empty() )
+    {
+        int s = small.back();
+        int l = large.back();
+        small.pop_back();
+
+        // the small texel keeps its own weight and hands the rest of its slot to the large one
+        aliasTex[s].prob = float(scaled[s]);
+        aliasTex[s].aliasX = float(l % width);
+        aliasTex[s].aliasY = float(l / width);
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if( scaled[l] < 1.0 )
+        {
+            large.pop_back();
+            small.push_back( l );
+        }
+    }
+
+    // whatever is left over (including round-off stragglers) always keeps itself
+    for( int i = 0; i < (int)large.size(); i++ )
+        aliasTex[large[i]].prob = 1.0;
+    for( int i = 0; i < (int)small.size(); i++ )
+        aliasTex[small[i]].prob = 1.0;
+}
+
+void ProbeLibrary::computeSamplingPyramid( const std::vector<double>& pdf, ProbeCache& probe )
+{
+    // the probe only has room for a pyramid when the faces are square powers of two
+    int numLevels = probe.header().numPyramidLevels;
+    if( !numLevels )
+        return;
+
+    int numElements = (int)pdf.size();
+    double pdfSum = 0;
+    for( int i = 0; i < numElements; i++ )
+        pdfSum += pdf[i];
+
+    // level 0 is normalized so that each texel holds its pdf over the [0..1]^2 domain
+    float* level0 = probe.pyramidLevel( 0 );
+    for( int i = 0; i < numElements; i++ )
+        level0[i] = pdfSum > 0 ? float(pdf[i] * numElements / pdfSum) : 1.0f;
+
+    // each coarser level sums 2x2 blocks of the one below, ending at 6x1
+    int w = probe.header().tableWidth, h = probe.header().tableHeight;
+    for( int level = 1; level < numLevels; level++ )
+    {
+        const float* fine = probe.pyramidLevel( level-1 );
+        float* coarse = probe.pyramidLevel( level );
+
+        for( int y = 0; y < h/2; y++ )
+            for( int x = 0; x < w/2; x++ )
+                coarse[y*(w/2) + x] = fine[(2*y)*w + 2*x]   + fine[(2*y)*w + 2*x+1] +
+                                      fine[(2*y+1)*w + 2*x] + fine[(2*y+1)*w + 2*x+1];
+
+        w /= 2;
+        h /= 2;
+    }
+}
+
+
+// the decode as it was before the faces went straight into the mip chain: one
+// face at a time through a malloc'd buffer into a bitmap, then a flipped copy
+static bool decodeFacesReference( const char* filename, std::vector<float>& level0 )
+{
+    Ptex::String error;
+    PtexTexture* tx = PtexTexture::open( filename, error );
+    if( !tx )
+        return false;
+
+    Ptex::Res res = tx->getFaceInfo(0).res;
+    int faceWidth = res.u(), faceHeight = res.v();
+
+    BitmapContainer<color3> envTex;
+    envTex.create( faceWidth*6, faceHeight );
+
+    for( int face = 0; face < 6; face++ )
+    {
+        float* faceData = (float*)malloc( faceWidth*faceHeight*3*sizeof(float) );
+        tx->getData( face, faceData, 0 );
+
+        for( int j = 0; j < faceHeight * faceWidth; j++ )
+        {
+            color3 c( faceData[j*3+0], faceData[j*3+1], faceData[j*3+2] );
+            envTex.setPixel( faceWidth*face + j % faceWidth, j / faceWidth, c );
+        }
+
+        free( faceData );
+    }
+    tx->release();
+
+    level0.resize( size_t(envTex.w) * envTex.h * 3 );
+    for( int y = 0; y < envTex.h; y++ )
+        memcpy( &level0[size_t(envTex.h-y-1)*envTex.w*3], envTex.getPtr(y), envTex.w*sizeof(color3) );
+
+    return true;
+}
+
+
+static bool decodeFacesFromFile( const char* filename, std::vector<float>& level0 )
+{
+    Ptex::String error;
+    PtexTexture* tx = PtexTexture::open( filename, error );
+    if( !tx )
+        return false;
+
+    Ptex::Res res = tx->getFaceInfo(0).res;
+    level0.resize( size_t(res.u()) * 6 * res.v() * 3 );
+    decodeFaces( tx, &level0[0], res.u(), res.v() );
+    tx->release();
+
+    return true;
+}
+
+
+void benchmarkProbeLoading( const char* filename )
+{
+    ProbeLibrary library;
+    bool isPtex = !LatLongImage::canLoad( filename );
+
+    std::vector<float> reference, decoded;
+    double referenceMS = 1e30, decodeMS = 1e30, uncachedMS = 1e30, cachedMS = 1e30;
+    bool same = true;
+
+    // best of a few runs, so the page cache is warm for all of them
+    for( int run = 0; run < 3; run++ )
+    {
+        QElapsedTimer timer;
+        if( isPtex )
+        {
+            timer.start();
+            if( !decodeFacesReference( filename, reference ) )
+            {
+                printf( "couldn't read %s\n", filename );
+                return;
+            }
+            referenceMS = std::min( referenceMS, timer.nsecsElapsed() * 1e-6 );
+
+            timer.restart();
+            decodeFacesFromFile( filename, decoded );
+            decodeMS = std::min( decodeMS, timer.nsecsElapsed() * 1e-6 );
+        }
+
+        // everything acquire() does on a cache miss, short of the GL uploads
+        ProbeCache probe;
+        timer.start();
+        if( !library.processProbe( filename, probe ) )
+        {
+            printf( "couldn't read %s\n", filename );
+            return;
+        }
+        if( !probe.save() )
+        {
+            printf( "couldn't write the probe cache for %s\n", filename );
+            return;
+        }
+        uncachedMS = std::min( uncachedMS, timer.nsecsElapsed() * 1e-6 );
+
+        ProbeCache cached;
+        timer.restart();
+        if( !cached.open( filename ) )
+        {
+            printf( "couldn't open the probe cache for %s\n", filename );
+            return;
+        }
+        cachedMS = std::min( cachedMS, timer.nsecsElapsed() * 1e-6 );
+
+        size_t numFloats = size_t(6) * probe.header().faceWidth * probe.header().faceHeight * 3;
+        same = same && memcmp( probe.faceLevel( 0 ), cached.faceLevel( 0 ), numFloats * sizeof(float) ) == 0;
+        if( isPtex )
+            same = same && reference == decoded &&
+                   memcmp( probe.faceLevel( 0 ), &decoded[0], numFloats * sizeof(float) ) == 0;
+    }
+
+    ProbeCache probe;
+    probe.open( filename );
+    printf( "%s: %d x %d faces, sampling tables from level %d\n", filename,
+            (int)probe.header().faceWidth, (int)probe.header().faceHeight, (int)probe.header().tableLevel );
+    if( isPtex )
+    {
+        printf( "    decode face by face via a bitmap: %9.2f ms\n", referenceMS );
+        printf( "    decode in parallel into the mips: %9.2f ms, %.1fx\n", decodeMS, referenceMS / decodeMS );
+    }
+    printf( "    uncached load (without GL):       %9.2f ms\n", uncachedMS );
+    printf( "    cached load:                      %9.2f ms, %.1fx\n", cachedMS, uncachedMS / cachedMS );
+    printf( same ? "    same texels on every path\n" : "    MISMATCH between the paths\n" );
+}
+
+
+// CPU copies of the warps in brdfIBL.frag, for measuring how well each one
+// importance samples a probe. They take uniform (u,v) to a point of the
+// sampling tables' domain and give back 1/pdf there
+
+typedef void (*EnvWarp)( ProbeCache& probe, float& u, float& v, float& probInv );
+
+static void warpUniform( ProbeCache&, float&, float&, float& probInv )
+{
+    probInv = 1.f;
+}
+
+static float warpSample1D( const float* data, int texDim, float u, float& probInv )
+{
+    // data[-1] is -data[0] and data[texDim] is 2-data[texDim-1], reflecting
+    // around the implied end points at (0,0) and (1,1)
+    float uN = u * texDim - 0.5f;
+    int ui = (int)floorf( uN );
+    float frac = uN - ui;
+    float cdf0 = ui < 0 ? -data[0] : data[ui];
+    float cdf1 = ui+1 >= texDim ? 2 - data[texDim-1] : data[ui+1];
+
+    probInv = texDim * (cdf1 - cdf0);
+    return cdf0 + frac * (cdf1 - cdf0);
+}
+
+static void warpInverseCDF( ProbeCache& probe, float& u, float& v, float& probInv )
+{
+    int w = probe.header().tableWidth, h = probe.header().tableHeight;
+
+    float uProbInv, vProbInv;
+    v = warpSample1D( probe.marginalProbTex(), h, v, vProbInv );
+    int row = std::min( std::max( int(v * h), 0 ), h-1 );
+    u = warpSample1D( probe.probTex() + row*w, w, u, uProbInv );
+
+    probInv = uProbInv * vProbInv;
+}
+
+static void warpAlias( ProbeCache& probe, float& u, float& v, float& probInv )
+{
+    int w = probe.header().tableWidth, h = probe.header().tableHeight;
+    const aliasEntry* aliasTex = (const aliasEntry*)probe.aliasTex();
+
+    float x = u * w, y = v * h;
+    int tx = std::min( int(x), w-1 ), ty = std::min( int(y), h-1 );
+    float fx = x - tx, fy = y - ty;
+
+    const aliasEntry* entry = &aliasTex[ty*w + tx];
+    if( fx < entry->prob )
+        fx /= entry->prob;
+    else
+    {
+        fx = (fx - entry->prob) / (1.f - entry->prob);
+        tx = int(entry->aliasX);
+        ty = int(entry->aliasY);
+        entry = &aliasTex[ty*w + tx];
+    }
+
+    probInv = 1.f / entry->pdf;
+    u = (tx + fx) / w;
+    v = (ty + fy) / h;
+}
+
+static void warpHierarchical( ProbeCache& probe, float& u, float& v, float& probInv )
+{
+    int w = probe.header().tableWidth, h = probe.header().tableHeight;
+    int top = probe.header().numPyramidLevels - 1;
+
+    const float* topLevel = probe.pyramidLevel( top );
+    float total = 0.f;
+    for( int i = 0; i < 6; i++ )
+        total += topLevel[i];
+
+    float x = u * total;
+    int face = 0;
+    while( face < 5 && x >= topLevel[face] )
+        x -= topLevel[face++];
+    u = std::min( std::max( x / std::max( topLevel[face], 1e-20f ), 0.f ), 0.99999994f );
+
+    int tx = face, ty = 0;
+    for( int level = top - 1; level >= 0; level-- )
+    {
+        const float* weights = probe.pyramidLevel( level );
+        int levelWidth = w >> level;
+        tx *= 2;
+        ty *= 2;
+        float w00 = weights[ty*levelWidth + tx],     w10 = weights[ty*levelWidth + tx+1];
+        float w01 = weights[(ty+1)*levelWidth + tx], w11 = weights[(ty+1)*levelWidth + tx+1];
+
+        float left = w00 + w01, right = w10 + w11;
+        float pLeft = left + right > 0.f ? left / (left + right) : 0.5f;
+        if( u < pLeft )
+            u /= pLeft;
+        else
+        {
+            u = (u - pLeft) / (1.f - pLeft);
+            tx++;
+            w00 = w10;
+            w01 = w11;
+        }
+
+        float pLow = w00 + w01 > 0.f ? w00 / (w00 + w01) : 0.5f;
+        if( v < pLow )
+            v /= pLow;
+        else
+        {
+            v = (v - pLow) / (1.f - pLow);
+            ty++;
+        }
+    }
+
+    probInv = 1.f / probe.pyramidLevel( 0 )[ty*w + tx];
+    u = (tx + u) / w;
+    v = (ty + v) / h;
+}
+
+// face order is px nx py ny pz nz; not normalized, as in brdfIBL.frag
+static glm::vec3 uvToVector( float u, float v )
+{
+    float face = floorf( u * 6.f );
+    u = (u * 6.f - face) * 2.f - 1.f;
+    v = v * 2.f - 1.f;
+
+    if( face < 1.5f )
+    {
+        float s = face < 0.5f ? 1.f : -1.f;
+        return glm::vec3( s, v, -s*u );
+    }
+    if( face < 3.5f )
+    {
+        float s = face < 2.5f ? 1.f : -1.f;
+        return glm::vec3( u, s, -s*v );
+    }
+    float s = face < 4.5f ? 1.f : -1.f;
+    return glm::vec3( s*u, v, s );
+}
+
+// the cosine-weighted radiance (as luminance, at the table level) arriving
+// from (u,v) at a surface facing n, per unit area of the [0..1]^2 domain
+static double envIntegrand( ProbeCache& probe, const glm::vec3& n, float u, float v )
+{
+    int w = probe.header().tableWidth, h = probe.header().tableHeight;
+    color3* envTex = (color3*)probe.faceLevel( probe.header().tableLevel );
+
+    // the tables are in ptex row order, which is flipped from the stored faces
+    int col = std::min( std::max( int(u * w), 0 ), w-1 );
+    int row = std::min( std::max( int(v * h), 0 ), h-1 );
+
+    glm::vec3 dir = uvToVector( u, v );
+    float r2 = glm::dot( dir, dir );
+    float cosine = std::max( glm::dot( n, dir ) / sqrtf( r2 ), 0.f );
+    return envTex[(h-row-1)*w + col].luminance() * cosine * 24.0 * pow( r2, -1.5 );
+}
+
+
+void benchmarkEnvSampling( const char* filename )
+{
+    ProbeLibrary library;
+    ProbeCache probe;
+    if( !probe.open( filename ) && !library.processProbe( filename, probe ) )
+    {
+        printf( "couldn't read %s\n", filename );
+        return;
+    }
+
+    const int numNormals = 16, numTrials = 32, numSubsamples = 4;
+    const int sampleCounts[] = { 16, 64, 256, 1024, 4096 };
+    const int numCounts = sizeof(sampleCounts) / sizeof(sampleCounts[0]);
+
+    const char* warpNames[] = { "uniform", "inverse CDF", "alias", "hierarchical" };
+    EnvWarp warps[] = { warpUniform, warpInverseCDF, warpAlias, warpHierarchical };
+    int numWarps = probe.header().numPyramidLevels ? 4 : 3;
+
+    int w = probe.header().tableWidth, h = probe.header().tableHeight;
+
+    // normals spread evenly over the sphere (a Fibonacci lattice)
+    std::vector<glm::vec3> normals( numNormals );
+    for( int i = 0; i < numNormals; i++ )
+    {
+        float z = 1.f - (2.f*i + 1.f) / numNormals;
+        float phi = 2.39996323f * i;
+        float r = sqrtf( 1.f - z*z );
+        normals[i] = glm::vec3( r * cosf(phi), r * sinf(phi), z );
+    }
+
+    // the reference answers, by the midpoint rule on a grid finer than the tables
+    std::vector<double> reference( numNormals, 0.0 );
+    parallelFor( 0, numNormals, [&]( int i )
+    {
+        double sum = 0.0;
+        for( int row = 0; row < h; row++ )
+            for( int col = 0; col < w; col++ )
+                for( int sy = 0; sy < numSubsamples; sy++ )
+                    for( int sx = 0; sx < numSubsamples; sx++ )
+                        sum += envIntegrand( probe, normals[i],
+                                             (col + (sx + 0.5f) / numSubsamples) / w,
+                                             (row + (sy + 0.5f) / numSubsamples) / h );
+        reference[i] = sum / (double(w) * h * numSubsamples * numSubsamples);
+    });
+
+    double meanReference = 0.0;
+    for( int i = 0; i < numNormals; i++ )
+        meanReference += reference[i] / numNormals;
+    if( meanReference <= 0.0 )
+    {
+        printf( "%s is black\n", filename );
+        return;
+    }
+
+    // squared errors per warp and sample count, summed over the normals and trials
+    std::vector<double> squaredError( numWarps * numCounts, 0.0 );
+    for( int warp = 0; warp < numWarps; warp++ )
+    {
+        std::vector<double> normalError( numNormals * numCounts, 0.0 );
+        parallelFor( 0, numNormals, [&]( int i )
+        {
+            std::mt19937 random( 1234 + i );
+            std::uniform_real_distribution<float> uniform( 0.f, 1.f );
+            for( int c = 0; c < numCounts; c++ )
+                for( int trial = 0; trial < numTrials; trial++ )
+                {
+                    double sum = 0.0;
+                    for( int s = 0; s < sampleCounts[c]; s++ )
+                    {
+                        float u = uniform( random ), v = uniform( random ), probInv;
+                        warps[warp]( probe, u, v, probInv );
+                        sum += envIntegrand( probe, normals[i], u, v ) * probInv;
+                    }
+                    double error = (sum / sampleCounts[c] - reference[i]) / meanReference;
+                    normalError[i * numCounts + c] += error * error;
+                }
+        });
+
+        for( int i = 0; i < numNormals; i++ )
+            for( int c = 0; c < numCounts; c++ )
+                squaredError[warp * numCounts + c] += normalError[i * numCounts + c];
+    }
+
+    printf( "%s: %d x %d sampling tables, %d normals, %d trials each\n", filename, w, h, numNormals, numTrials );
+    printf( "RMS error of the cosine-weighted luminance, relative to its mean over the normals\n" );
+    printf( "%8s", "samples" );
+    for( int warp = 0; warp < numWarps; warp++ )
+        printf( " %13s", warpNames[warp] );
+    printf( "\n" );
+    for( int c = 0; c < numCounts; c++ )
+    {
+        printf( "%8d", sampleCounts[c] );
+        for( int warp = 0; warp < numWarps; warp++ )
+            printf( " %13.5f", sqrt( squaredError[warp * numCounts + c] / (numNormals * numTrials) ) );
+        printf( "\n" );
+    }
+    if( numWarps < 4 )
+        printf( "(no hierarchical warp: the faces aren't a power of two)\n" );
+}
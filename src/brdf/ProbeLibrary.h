@@ -0,0 +1,199 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+
+#ifndef PROBE_LIBRARY_H
+#define PROBE_LIBRARY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "SharedContextGLWidget.h"
+
+class ProbeCache;
+class DGLShader;
+class Quad;
+
+// the prefiltered cube map for the split-sum preview covers roughness 0..1
+// over its mip levels; the irradiance map is a single small level
+#define PREFILTERED_FACE_SIZE 128
+#define PREFILTERED_LEVELS 5
+#define IRRADIANCE_FACE_SIZE 32
+
+// the sampling tables are built from the first face mip level at or below
+// this size, which bounds their memory and build time for large probes
+#define MAX_SAMPLING_TABLE_FACE_SIZE 256
+
+// the SH projection reads the first face mip level at or below this size
+#define SH_PROJECTION_FACE_SIZE 64
+
+
+// one texel of the alias table: the probability of keeping the texel, the
+// coordinates of the texel to jump to otherwise, and the texel's own pdf
+struct aliasEntry
+{
+    aliasEntry() : prob(1.), aliasX(0.), aliasY(0.), pdf(0.) {}
+    float prob, aliasX, aliasY, pdf;
+};
+
+
+// the GL side of a loaded probe
+struct ProbeTextures
+{
+    ProbeTextures();
+
+    std::string filename;
+
+    GLuint envTexID;
+    GLuint probTexID;
+    GLuint marginalProbTexID;
+    GLuint aliasTexID;
+
+    // per-texel pdf summed into 2x2 blocks, level 0 being full resolution;
+    // the top level holds one texel per cube face
+    GLuint samplingPyramidTexID;
+    int numSamplingPyramidLevels;
+
+    // GGX-prefiltered copies of the environment (one roughness per mip level)
+    // and the cosine-convolved irradiance, for the split-sum preview
+    GLuint prefilteredTexID;
+    int numPrefilteredLevels;
+    GLuint irradianceTexID;
+
+    // order-2 spherical harmonic projection of the probe (9 RGB coefficients),
+    // already convolved with the cosine lobe and divided by pi so that
+    // evaluating it at a normal gives irradiance / pi
+    float shIrradiance[27];
+
+    int faceWidth;
+    int faceHeight;
+
+    // dimensions of the sampling tables, and the face mip level they match
+    int numColumns;
+    int numRows;
+    int tableLevel;
+
+    // roughly how much GPU memory the textures take up
+    size_t numBytes;
+    unsigned int lastUsed;
+
+    // the textures stream in after acquire() returns; this is their
+    // UploadManager group
+    int uploadGroup;
+};
+
+
+/*
+ProbeLibrary keeps the textures of the most recently used environment probes
+resident on the GPU, so that switching back to one of them is just a rebind.
+When the resident probes go over the memory budget, the least recently used
+ones are dropped; they get re-materialized from the ProbeCache the next time
+they're asked for.
+*/
+
+class ProbeLibrary : public GLContext
+{
+public:
+    ProbeLibrary();
+    ~ProbeLibrary();
+
+    // makes the given probe resident (loading it if needed) and hands back its textures
+    bool acquire( const char* filename, ProbeTextures& textures );
+
+    bool isResident( const char* filename ) const;
+
+    // false until all the probe's textures have reached the GPU
+    bool isReady( const ProbeTextures& textures ) const;
+
+    void setBudget( size_t numBytes );
+    size_t budget() const { return _budget; }
+    size_t residentBytes() const;
+
+private:
+    friend void benchmarkProbeLoading( const char* filename );
+
+// prints the error of the IBL view's env map samplers against sample count,
+// estimating the cosine-weighted radiance of the given probe for a set of normals
+void benchmarkEnvSampling( const char* filename );
+    friend void benchmarkEnvSampling( const char* filename );
+
+    void evict();
+    void deleteTextures( ProbeTextures& textures );
+
+    bool processProbe( const char* filename, ProbeCache& probe );
+    bool processLatLongProbe( const char* filename, ProbeCache& probe );
+    void computeEnvMapMipChain( ProbeCache& probe );
+    void computeEnvMapSamplingData( ProbeCache& probe );
+    double calculateProbs( const double* pdf, float* data, int numElements );
+    void computeAliasTable( const std::vector<double>& pdf, aliasEntry* aliasTex, int width );
+    void computeSamplingPyramid( const std::vector<double>& pdf, ProbeCache& probe );
+    void createGLEnvMap( std::shared_ptr<ProbeCache> probe, ProbeTextures& textures );
+    void createGLSamplingTextures( std::shared_ptr<ProbeCache> probe, ProbeTextures& textures );
+    void createGLPrefilteredMaps( ProbeTextures& textures );
+    void renderPrefilteredMaps( const ProbeTextures& textures );
+    void computeSHIrradiance( ProbeCache& probe, ProbeTextures& textures );
+    void renderCubeFaces( GLuint texID, int faceSize, int level );
+
+    std::vector<ProbeTextures> _resident;
+    size_t _budget;
+    unsigned int _useCounter;
+
+    // for rendering the prefiltered maps
+    DGLShader* _prefilterShader;
+    Quad* _quad;
+    GLuint _fboID;
+};
+
+
+// times decoding the given ptex probe one face at a time through a bitmap (as it
+// used to be) against decoding it straight into the mip chain, then a whole
+// uncached load against a load from the probe cache
+void benchmarkProbeLoading( const char* filename );
+
+// prints the error of the IBL view's env map samplers against sample count,
+// estimating the cosine-weighted radiance of the given probe for a set of normals
+void benchmarkEnvSampling( const char* filename );
+
+#endif
@@ -0,0 +1,232 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDir>
+#include <QDateTime>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "RenderCache.h"
+#include "BRDFBase.h"
+#include "Paths.h"
+
+
+RenderCacheKey::RenderCacheKey( const char* kind )
+    : _hash( QCryptographicHash::Sha1 )
+{
+    addString( kind );
+    addInt( RENDER_CACHE_VERSION );
+}
+
+
+void RenderCacheKey::addInt( int value )
+{
+    _hash.addData( (const char*)&value, sizeof(value) );
+}
+
+
+void RenderCacheKey::addFloat( float value )
+{
+    _hash.addData( (const char*)&value, sizeof(value) );
+}
+
+
+void RenderCacheKey::addString( const std::string& s )
+{
+    // the length first, so that neighbouring strings can't run together
+    addInt( int(s.size()) );
+    _hash.addData( s.data(), int(s.size()) );
+}
+
+
+void RenderCacheKey::addFile( const std::string& filename )
+{
+    QFileInfo info( QString::fromStdString( filename ) );
+    addString( info.absoluteFilePath().toStdString() );
+
+    qint64 size = info.size();
+    qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    _hash.addData( (const char*)&size, sizeof(size) );
+    _hash.addData( (const char*)&modified, sizeof(modified) );
+}
+
+
+void RenderCacheKey::addBRDF( BRDFBase* brdf )
+{
+    if( !brdf )
+    {
+        addInt( 0 );
+        return;
+    }
+
+    // measured BRDFs share their shader source, so the data file tells them apart
+    addFile( brdf->getName() );
+    addString( brdf->getShaderFunctions() );
+
+    for( int i = 0; i < brdf->getFloatParameterCount(); i++ )
+    {
+        brdfFloatParam* p = brdf->getFloatParameter( i );
+        addString( p->name );
+        addFloat( p->currentVal );
+    }
+
+    for( int i = 0; i < brdf->getBoolParameterCount(); i++ )
+    {
+        brdfBoolParam* p = brdf->getBoolParameter( i );
+        addString( p->name );
+        addInt( p->currentVal ? 1 : 0 );
+    }
+
+    for( int i = 0; i < brdf->getColorParameterCount(); i++ )
+    {
+        brdfColorParam* p = brdf->getColorParameter( i );
+        addString( p->name );
+        for( int c = 0; c < 3; c++ )
+            addFloat( p->currentVal[c] );
+    }
+}
+
+
+void RenderCacheKey::addBRDFPackage( const brdfPackage& pkg )
+{
+    addBRDF( pkg.brdf );
+    for( int c = 0; c < 3; c++ )
+    {
+        addFloat( pkg.drawColor[c] );
+        addFloat( pkg.colorMask[c] );
+    }
+}
+
+
+std::string RenderCacheKey::result()
+{
+    return _hash.result().toHex().constData();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+
+std::string RenderCache::cacheFilename( const std::string& key )
+{
+    return getCachePath() + key + ".render";
+}
+
+
+bool RenderCache::load( const std::string& key, int width, int height, int bytesPerPixel, void* data )
+{
+    QString filename = QString::fromStdString( cacheFilename( key ) );
+    qint64 numBytes = qint64(width) * height * bytesPerPixel;
+
+    QFile file( filename );
+    if( !file.open( QIODevice::ReadOnly ) || file.size() != (qint64)sizeof(RenderCacheHeader) + numBytes )
+        return false;
+
+    RenderCacheHeader hdr;
+    if( file.read( (char*)&hdr, sizeof(hdr) ) != (qint64)sizeof(hdr) ||
+        strncmp( hdr.magic, RENDER_CACHE_MAGIC, sizeof(hdr.magic) ) || hdr.version != RENDER_CACHE_VERSION ||
+        hdr.width != (quint32)width || hdr.height != (quint32)height || hdr.bytesPerPixel != (quint32)bytesPerPixel )
+        return false;
+
+    if( file.read( (char*)data, numBytes ) != numBytes )
+        return false;
+    file.close();
+
+    // trim() goes by modification time, so a hit counts as a use
+    QFile touch( filename );
+    if( touch.open( QIODevice::Append ) )
+        touch.setFileTime( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+
+    return true;
+}
+
+
+bool RenderCache::store( const std::string& key, int width, int height, int bytesPerPixel, const void* data )
+{
+    RenderCacheHeader hdr;
+    memset( &hdr, 0, sizeof(hdr) );
+    strncpy( hdr.magic, RENDER_CACHE_MAGIC, sizeof(hdr.magic) );
+    hdr.version = RENDER_CACHE_VERSION;
+    hdr.width = width;
+    hdr.height = height;
+    hdr.bytesPerPixel = bytesPerPixel;
+
+    QSaveFile out( QString::fromStdString( cacheFilename( key ) ) );
+    if( !out.open( QIODevice::WriteOnly ) )
+        return false;
+
+    qint64 numBytes = qint64(width) * height * bytesPerPixel;
+    if( out.write( (const char*)&hdr, sizeof(hdr) ) != (qint64)sizeof(hdr) ||
+        out.write( (const char*)data, numBytes ) != numBytes )
+    {
+        out.cancelWriting();
+        return false;
+    }
+
+    return out.commit();
+}
+
+
+void RenderCache::trim( qint64 budgetBytes )
+{
+    // newest first; everything past the budget goes
+    QDir dir( QString::fromStdString( getCachePath() ) );
+    QFileInfoList files = dir.entryInfoList( QStringList() << "*.render", QDir::Files, QDir::Time );
+
+    qint64 total = 0;
+    int numRemoved = 0;
+    for( int i = 0; i < files.size(); i++ )
+    {
+        total += files[i].size();
+        if( total > budgetBytes && QFile::remove( files[i].absoluteFilePath() ) )
+            numRemoved++;
+    }
+
+    if( numRemoved )
+        printf( "removed %d cached renders to stay under %lld MB\n", numRemoved, (long long)(budgetBytes >> 20) );
+}
@@ -0,0 +1,127 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <string>
+#include <QCryptographicHash>
+
+class BRDFBase;
+struct brdfPackage;
+
+
+#define RENDER_CACHE_MAGIC "BRDFRND"
+#define RENDER_CACHE_VERSION 1
+
+// how much disk the cached renders may use before the least recently used
+// ones are deleted
+#define RENDER_CACHE_BUDGET_MB 512
+
+
+/*
+Builds the key of a cached render: a SHA-1 over everything that went into it.
+Each view adds its own settings; addBRDF covers the BRDF's shader source, the
+file it came from and the current value of every parameter.
+*/
+
+class RenderCacheKey
+{
+public:
+    // kind keeps different views' renders of the same thing apart
+    RenderCacheKey( const char* kind );
+
+    void addInt( int value );
+    void addFloat( float value );
+    void addString( const std::string& s );
+
+    // the file's name, size and modification time, so edits to it are misses
+    void addFile( const std::string& filename );
+
+    void addBRDF( BRDFBase* brdf );
+    void addBRDFPackage( const brdfPackage& pkg );
+
+    std::string result();
+
+private:
+    QCryptographicHash _hash;
+};
+
+
+/*
+RenderCache keeps finished renders (converged IBL accumulations, thumbnails)
+in the user's cache directory next to the processed probes, one file per key
+holding a small header and the raw pixels, so a view that has been rendered
+before can be shown as soon as it's asked for again.
+
+Reading a render marks it as recently used; trim() deletes the least
+recently used ones until the total fits in the budget.
+*/
+
+struct RenderCacheHeader
+{
+    char    magic[8];
+    quint32 version;
+    quint32 width;
+    quint32 height;
+    quint32 bytesPerPixel;
+};
+
+
+class RenderCache
+{
+public:
+    // fills data with the cached render, if there's one with the same dimensions
+    static bool load( const std::string& key, int width, int height, int bytesPerPixel, void* data );
+
+    static bool store( const std::string& key, int width, int height, int bytesPerPixel, const void* data );
+
+    static void trim( qint64 budgetBytes = qint64(RENDER_CACHE_BUDGET_MB) << 20 );
+
+private:
+    static std::string cacheFilename( const std::string& key );
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "SampleSequence.h"
+#include "ParallelFor.h"
+
+
+void generateSobol2D( unsigned int* points, int numSamples )
+{
+    // generator matrices: the first dimension is the van der Corput sequence,
+    // the second comes from the primitive polynomial x + 1
+    unsigned int v0[32], v1[32];
+    v0[0] = v1[0] = 1u << 31;
+    for( int k = 1; k < 32; k++ )
+    {
+        v0[k] = 1u << (31 - k);
+        v1[k] = v1[k-1] ^ (v1[k-1] >> 1);
+    }
+
+    for( int i = 0; i < numSamples; i++ )
+    {
+        unsigned int x = 0, y = 0;
+        for( int k = 0; k < 32; k++ )
+        {
+            if( (unsigned int)i & (1u << k) )
+            {
+                x ^= v0[k];
+                y ^= v1[k];
+            }
+        }
+        points[i*2+0] = x;
+        points[i*2+1] = y;
+    }
+}
+
+
+static unsigned int reverseBits( unsigned int x )
+{
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+
+unsigned int owenScramble( unsigned int x, unsigned int seed )
+{
+    // the Laine-Karras permutation only lets lower bits affect higher ones,
+    // so run it on the reversed bits
+    x = reverseBits( x );
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits( x );
+}
+
+
+// same per-pixel hash as brdfIBL.frag
+static unsigned int pixelHash( unsigned int x, unsigned int y )
+{
+    const unsigned int M = 1664525u, C = 1013904223u;
+    unsigned int seed = (x * M + y + C) * M;
+    seed ^= (seed >> 11u);
+    seed ^= (seed << 7u) & 0x9d2c5680u;
+    seed ^= (seed << 15u) & 0xefc60000u;
+    seed ^= (seed >> 18u);
+    return seed;
+}
+
+
+// stand-in for one pixel's lighting integral: a hard-edged bright region
+// plus a small sun, with a known answer
+static double testIntegrand( double u, double v )
+{
+    double du = (u - 0.3) / 0.05, dv = (v - 0.6) / 0.05;
+    return (u + v < 0.8 ? 1.0 : 0.0) + exp( -0.5 * (du*du + dv*dv) );
+}
+
+
+void benchmarkSampleSequences( int stepSize, int samplesPerPass )
+{
+    const int numPixels = 64 * 64;
+    const double reference = 0.32 + 2.0 * M_PI * 0.05 * 0.05;
+    int totalSamples = stepSize * samplesPerPass;
+
+    std::vector<unsigned int> sobol( totalSamples * 2 );
+    generateSobol2D( &sobol[0], totalSamples );
+
+    // the pass order IBLWidget uses for the Hammersley passes
+    std::vector<int> order( stepSize );
+    for( int i = 0; i < stepSize; i++ )
+        order[i] = i;
+    for( int i = 0; i < stepSize*100; i++ )
+        std::swap( order[rand() % stepSize], order[rand() % stepSize] );
+
+    // the pass counts to report, and the squared errors at each, per row of pixels
+    std::vector<int> checkpoints;
+    for( int p = 1; p < stepSize; p *= 2 )
+        checkpoints.push_back( p );
+    checkpoints.push_back( stepSize );
+    int numCheckpoints = (int)checkpoints.size();
+
+    std::vector<double> hammersleyError( 64 * numCheckpoints, 0.0 );
+    std::vector<double> sobolError( 64 * numCheckpoints, 0.0 );
+
+    parallelFor( 0, 64, [&]( int row )
+    {
+        for( int x = 0; x < 64; x++ )
+        {
+            unsigned int seed1 = pixelHash( x, row );
+            unsigned int seed2 = pixelHash( seed1, 1000u );
+            double offset = double(seed1) * 2.3283064365386963e-10;
+
+            double hammersleySum = 0.0, sobolSum = 0.0;
+            int checkpoint = 0;
+            for( int pass = 0; pass < stepSize; pass++ )
+            {
+                for( int s = 0; s < samplesPerPass; s++ )
+                {
+                    // strided through the whole set, as brdfIBL.frag did before
+                    unsigned int i = order[pass] + s * stepSize;
+                    double u = fmod( offset + double(i) / totalSamples, 1.0 );
+                    double v = double(reverseBits( i ) ^ seed2) * 2.3283064365386963e-10;
+                    hammersleySum += testIntegrand( u, v );
+
+                    // consecutive points of the scrambled sequence
+                    int j = pass * samplesPerPass + s;
+                    u = double(owenScramble( sobol[j*2+0], seed1 ) >> 8) * (1.0 / 16777216.0);
+                    v = double(owenScramble( sobol[j*2+1], seed2 ) >> 8) * (1.0 / 16777216.0);
+                    sobolSum += testIntegrand( u, v );
+                }
+
+                if( pass + 1 == checkpoints[checkpoint] )
+                {
+                    double n = double((pass + 1) * samplesPerPass);
+                    double eh = hammersleySum / n - reference;
+                    double es = sobolSum / n - reference;
+                    hammersleyError[row * numCheckpoints + checkpoint] += eh * eh;
+                    sobolError[row * numCheckpoints + checkpoint] += es * es;
+                    checkpoint++;
+                }
+            }
+        }
+    });
+
+    printf( "RMS error over %d pixels, %d samples per pass\n", numPixels, samplesPerPass );
+    printf( "%8s %12s %12s\n", "passes", "hammersley", "sobol" );
+    for( int c = 0; c < numCheckpoints; c++ )
+    {
+        double eh = 0.0, es = 0.0;
+        for( int row = 0; row < 64; row++ )
+        {
+            eh += hammersleyError[row * numCheckpoints + c];
+            es += sobolError[row * numCheckpoints + c];
+        }
+        printf( "%8d %12.6f %12.6f\n", checkpoints[c], sqrt( eh / numPixels ), sqrt( es / numPixels ) );
+    }
+}
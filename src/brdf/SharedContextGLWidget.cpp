@@ -65,7 +65,7 @@ QSurfaceFormat GLContext::surfaceFormat() {
     return format;
 }
 
-void GLContext::initOpenGLContext(QWindow *window)
+void GLContext::initOpenGLContext(QSurface *surface)
 {   
     if( !glcontext ){
         glcontext = new QOpenGLContext();
@@ -82,7 +82,7 @@ void GLContext::initOpenGLContext(QWindow *window)
             exit(1);
         }
 
-        glcontext->makeCurrent(window);
+        glcontext->makeCurrent(surface);
 
         glf = glcontext->versionFunctions<GlFuncs>();
 
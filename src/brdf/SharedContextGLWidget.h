@@ -61,6 +61,7 @@ infringement.
 #define OPENGL_CORE_FUNCS_INCLUDE QUOTE_AND_EXPAND(OPENGL_CORE_FUNCS)
 
 #include <QOpenGLContext>
+#include <QSurface>
 #include <QSurfaceFormat>
 #include <QWindow>
 
@@ -86,7 +87,7 @@ class GLContext
 public:
     typedef OPENGL_CORE_FUNCS GlFuncs;
 
-    static void initOpenGLContext(QWindow *window);
+    static void initOpenGLContext(QSurface *surface);
     static void cleanOpenGLContext();
     static GlFuncs* glFuncs() { return glf; }
     static QSurfaceFormat surfaceFormat();
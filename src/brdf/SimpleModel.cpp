@@ -50,15 +50,20 @@ infringement.
 #include <float.h>
 #include <algorithm>
 #include "SimpleModel.h"
+#include "ObjReader.h"
+#include "MeshOptimizer.h"
+#include "PackedVertices.h"
+#include "MeshFrames.h"
+#include "MeshSimplifier.h"
 
 
-const int MAX_VERTICES_PER_FACE = 255;
-
-
-SimpleModel::SimpleModel()
+SimpleModel::SimpleModel() : lodsReady(false), cancelLODs(false)
 {
+    vertexBuffer = indexBuffer = 0;
     madeVBO = false;
     loaded = false;
+    numLODs = 0;
+    uploadedLODs = false;
 }
 
 
@@ -70,8 +75,14 @@ SimpleModel::~SimpleModel()
 
 void SimpleModel::clear()
 {
+    // the LOD thread reads the mesh
+    stopLODs();
+
     vertexData.clear();
     normalData.clear();
+    tangentData.clear();
+    indexData.clear();
+    mesh.close();
     loaded = false;
     maxX = maxY = maxZ = -FLT_MAX;
     minX = minY = minZ = FLT_MAX;
@@ -80,13 +91,14 @@ void SimpleModel::clear()
     // delete the VBO if it exists
     if( madeVBO )
     {
-        if( normalBuffer )
-            glf->glDeleteBuffers( 1, &normalBuffer );
         if( vertexBuffer )
             glf->glDeleteBuffers( 1, &vertexBuffer );
+        if( indexBuffer )
+            glf->glDeleteBuffers( 1, &indexBuffer );
+        glf->glDeleteVertexArrays( 1, &vao );
     }
 
-    vertexBuffer = normalBuffer = 0;
+    vertexBuffer = indexBuffer = 0;
     madeVBO = false;
 }
 
@@ -98,173 +110,172 @@ bool SimpleModel::loadOBJ( const char* filename, bool unitize )
     QElapsedTimer timer;
     timer.start();
 
-    FILE* file = fopen( filename, "r" );
-    if( !file )
-        return false;
-
-    std::vector<float3> vertices;
-    std::vector<float3> normals;
+    // a binary copy from an earlier load skips parsing and indexing altogether
+    if( mesh.open( filename, unitize ) ) {
+        const MeshCacheHeader& h = mesh.header();
+        minX = h.boundsMin[0]; minY = h.boundsMin[1]; minZ = h.boundsMin[2];
+        maxX = h.boundsMax[0]; maxY = h.boundsMax[1]; maxZ = h.boundsMax[2];
+        numTriangles = h.numTriangles;
+        loaded = true;
+
+        std::cout << " Time to load OBJ: " << timer.elapsed() << " ms (cached)" << std::endl;
+        startLODs();
+        return true;
+    }
 
-    if( !dataPass( file, vertices, normals ) ) {
-        fclose(file);
+    ObjReader obj;
+    if( !obj.read( filename ) )
         return false;
-    }
 
+    computeBounds( obj.positions );
     if( unitize )
-        unitizeVertices( vertices );
+        unitizeVertices( obj.positions );
 
-    rewind( file );
-    if( !facePass( file, vertices, normals ) ) {
-        fclose(file);
-        return false;
-    }
-
-    fclose(file);
+    buildMesh( obj );
+    if( numTriangles )
+        optimizeMesh();
+    storeMesh( filename, unitize );
     loaded = true;
 
     qint64 loading_time = timer.elapsed();
     std::cout << " Time to load OBJ: " << loading_time << " ms" << std::endl;
 
+    startLODs();
     return true;
 }
 
 
-bool SimpleModel::dataPass( FILE* file, std::vector<float3>& vertices, std::vector<float3>& normals )
+void SimpleModel::computeBounds( const std::vector<float>& positions )
 {
     maxX = maxY = maxZ = -FLT_MAX;
     minX = minY = minZ = FLT_MAX;
 
-    vertices.clear();
-    normals.clear();
-    numTriangles = 0;
+    for( size_t i = 0; i < positions.size(); i += 3 ) {
+        maxX = std::max<float>( maxX, positions[i+0] );
+        minX = std::min<float>( minX, positions[i+0] );
+        maxY = std::max<float>( maxY, positions[i+1] );
+        minY = std::min<float>( minY, positions[i+1] );
+        maxZ = std::max<float>( maxZ, positions[i+2] );
+        minZ = std::min<float>( minZ, positions[i+2] );
+    }
+}
 
-    char line[2048];
-    while (fgets(line, sizeof(line), file))
-    {
-        char* end = &line[strlen(line)-1];
-        if (*end == '\n') *end = '\0'; // strip trailing nl
-
-        // vertices
-        if( line[0] == 'v' && line[1] == ' ' ) {
-            float3 data;
-            if( sscanf(line, "v %f %f %f", &data.x, &data.y, &data.z) == 3 ) {
-                maxX = std::max<float>( maxX, data.x );
-                minX = std::min<float>( minX, data.x );
-                maxY = std::max<float>( maxY, data.y );
-                minY = std::min<float>( minY, data.y );
-                maxZ = std::max<float>( maxZ, data.z );
-                minZ = std::min<float>( minZ, data.z );
-                vertices.push_back( data );
-            }
-        }
 
-        // vertex normals
-        else if( line[0] == 'v' && line[1] == 'n' ) {
-            float3 data;            
-            if( sscanf(line, "vn %f %f %f", &data.x, &data.y, &data.z) == 3 ) {
-                normals.push_back( data );
+void SimpleModel::buildMesh( const ObjReader& obj )
+{
+    const float3* normals = (const float3*)( obj.normals.empty() ? NULL : &obj.normals[0] );
+    int numPositions = int(obj.positions.size() / 3);
+
+    // world's most naive trianglization
+    std::vector<int> triPositions, triNormals, triTexCoords;
+    triPositions.reserve( obj.cornerPositions.size() * 2 );
+    triNormals.reserve( obj.cornerPositions.size() * 2 );
+    triTexCoords.reserve( obj.cornerPositions.size() * 2 );
+
+    size_t firstCorner = 0;
+    for( size_t f = 0; f < obj.faceSizes.size(); f++ ) {
+        int numVerts = obj.faceSizes[f];
+        for( int i = 1; i < numVerts - 1; i++ ) {
+            size_t corners[3] = { firstCorner, firstCorner + i, firstCorner + i + 1 };
+            for( int c = 0; c < 3; c++ ) {
+                triPositions.push_back( obj.cornerPositions[corners[c]] );
+                triNormals.push_back( obj.cornerNormals[corners[c]] );
+                triTexCoords.push_back( obj.cornerTexCoords[corners[c]] );
             }
         }
+        firstCorner += numVerts;
     }
 
-    return true;
-}
+    numTriangles = int(triPositions.size() / 3);
+    int numCorners = numTriangles * 3;
+    if( !numTriangles )
+        return;
 
+    // if we have a normal for each corner of a triangle, use them. Otherwise
+    // generate smooth ones, keeping the creases
+    bool needNormals = false;
+    for( int c = 0; c < numCorners && !needNormals; c++ )
+        needNormals = triNormals[c] < 0;
+
+    std::vector<float3> cornerNormals( numCorners );
+    if( needNormals )
+        computeSmoothNormals( &obj.positions[0], numPositions, &triPositions[0], numTriangles,
+                              NORMAL_CREASE_DEGREES, &cornerNormals[0].x );
+
+    for( int t = 0; t < numTriangles; t++ ) {
+        const int* n = &triNormals[t*3];
+        if( n[0] >= 0 && n[1] >= 0 && n[2] >= 0 )
+            for( int c = 0; c < 3; c++ )
+                cornerNormals[t*3 + c] = normals[n[c]];
+    }
+
+    std::vector<float> cornerTangents( numCorners * 4 );
+    computeTangents( &obj.positions[0], numPositions, &triPositions[0],
+                     obj.texCoords.empty() ? NULL : &obj.texCoords[0], &triTexCoords[0],
+                     &cornerNormals[0].x, numTriangles, &cornerTangents[0] );
+
+    // corners are merged when their position, normal and tangent all match.
+    // The vertices made from each OBJ position are chained together, so
+    // finding a match only compares against the few frames that position has
+    const float3* positions = (const float3*)&obj.positions[0];
+    std::vector<int> firstVertexOfPosition( numPositions, -1 );
+    std::vector<int> nextVertexOfPosition;
+    auto vertexFor = [&]( int p, const float3& n, const float* t ) -> unsigned int
+    {
+        for( int v = firstVertexOfPosition[p]; v >= 0; v = nextVertexOfPosition[v] )
+            if( !memcmp( &normalData[v], &n, sizeof(float3) ) &&
+                !memcmp( &tangentData[v*4], t, 4 * sizeof(float) ) )
+                return v;
+
+        int v = (int)vertexData.size();
+        vertexData.push_back( positions[p] );
+        normalData.push_back( n );
+        tangentData.insert( tangentData.end(), t, t + 4 );
+        nextVertexOfPosition.push_back( firstVertexOfPosition[p] );
+        firstVertexOfPosition[p] = v;
+        return v;
+    };
+
+    vertexData.reserve( numPositions );
+    normalData.reserve( numPositions );
+    tangentData.reserve( numPositions * 4 );
+    nextVertexOfPosition.reserve( numPositions );
+    indexData.resize( numCorners );
+
+    for( int c = 0; c < numCorners; c++ )
+        indexData[c] = vertexFor( triPositions[c], cornerNormals[c], &cornerTangents[c*4] );
+}
 
 
-bool SimpleModel::facePass( FILE* file, std::vector<float3>& vertices, std::vector<float3>& normals )
+void SimpleModel::optimizeMesh()
 {
-    vertexData.clear();
-    normalData.clear();
-    numTriangles = 0;
+    int numVertices = (int)vertexData.size();
+    float acmrBefore = computeACMR( &indexData[0], numTriangles, 16 );
 
-    char line[2048];
-    while (fgets(line, sizeof(line), file))
-    {
-        char* end = &line[strlen(line)-1];
-        if (*end == '\n') *end = '\0'; // strip trailing nl
-
-        // face
-        if( line[0] == 'f' && line[1] == ' ' ) {
-            
-            int numVerts = 0;
-            int numNorms = 0;
-            int normIndices[MAX_VERTICES_PER_FACE];
-            int vertIndices[MAX_VERTICES_PER_FACE];
-
-            int vertidx,texidx,normidx;
-            const char* cp = &line[2];
-            while (*cp == ' ') cp++;
-            while (sscanf(cp, "%d//%d", &vertidx, &normidx) == 2) {
-                if( numVerts >= MAX_VERTICES_PER_FACE || vertidx > (int)vertices.size() - 0 ||
-                    numNorms >= MAX_VERTICES_PER_FACE || normidx > (int)normals.size() - 0 )
-                    return false;
-                vertIndices[numVerts++] = vertidx;
-                normIndices[numNorms++] = normidx;
-                while (*cp && *cp != ' ') cp++;
-                while (*cp == ' ') cp++;
-            }
-            while (sscanf(cp, "%d/%d/%d", &vertidx, &texidx, &normidx) == 3) {
-                if( numVerts >= MAX_VERTICES_PER_FACE || vertidx > (int)vertices.size() - 0 ||
-                    numNorms >= MAX_VERTICES_PER_FACE || normidx > (int)normals.size() - 0 )
-                    return false;
-                vertIndices[numVerts++] = vertidx;
-                normIndices[numNorms++] = normidx;
-                while (*cp && *cp != ' ') cp++;
-                while (*cp == ' ') cp++;
-            }
-            while (sscanf(cp, "%d/%d", &vertidx, &texidx) == 2) {
-                if( numVerts >= MAX_VERTICES_PER_FACE || vertidx > (int)vertices.size() - 0 )
-                    return false;
-                vertIndices[numVerts++] = vertidx;
-                while (*cp && *cp != ' ') cp++;
-                while (*cp == ' ') cp++;
-            }
-            while (sscanf(cp, "%d", &vertidx) == 1) {
-                if( numVerts >= MAX_VERTICES_PER_FACE || vertidx > (int)vertices.size() - 0 )
-                    return false;
-                vertIndices[numVerts++] = vertidx;
-                while (*cp && *cp != ' ') cp++;
-                while (*cp == ' ') cp++;
-            }
+    // order the triangles for the vertex cache, then the vertices for fetching
+    optimizeVertexCache( &indexData[0], numTriangles, numVertices );
 
-            if (*cp)
-                return false;
-
-            // world's most naive trianglization
-            for( int i = 1; i < numVerts - 1; i++ ) {
-                vertexData.push_back( vertices[vertIndices[0] - 1] );
-                vertexData.push_back( vertices[vertIndices[i] - 1] );               
-                vertexData.push_back( vertices[vertIndices[i+1] - 1] );
-
-                // if we have a normal for each vertex, use them. Otherwise generate some
-                // ugly facety normals just so we have something.
-                if( numVerts == numNorms ) {
-                    normalData.push_back( normals[normIndices[0] - 1] );
-                    normalData.push_back( normals[normIndices[i] - 1] );
-                    normalData.push_back( normals[normIndices[i+1] - 1] );      
-                } else {
-                    float3 v1 = vertices[vertIndices[0] - 1] - vertices[vertIndices[i] - 1];
-                    float3 v2 = vertices[vertIndices[0] - 1] - vertices[vertIndices[i+1] - 1];
-                    float3 n = v1.cross(v2).getNormalized();
-
-                    normalData.push_back( n );
-                    normalData.push_back( n );
-                    normalData.push_back( n );
-                }
-
-                numTriangles++;
-            }
+    std::vector<unsigned int> remap( numVertices );
+    optimizeVertexFetch( &indexData[0], (int)indexData.size(), numVertices, &remap[0] );
 
-        }
+    std::vector<float3> vertices( numVertices ), normals( numVertices );
+    std::vector<float> tangents( numVertices * 4 );
+    for( int v = 0; v < numVertices; v++ ) {
+        vertices[remap[v]] = vertexData[v];
+        normals[remap[v]] = normalData[v];
+        memcpy( &tangents[remap[v] * 4], &tangentData[v * 4], 4 * sizeof(float) );
     }
+    vertexData.swap( vertices );
+    normalData.swap( normals );
+    tangentData.swap( tangents );
 
-    return true;
+    printf( " %d triangles, %d vertices (%d unindexed), ACMR %.3f -> %.3f\n", numTriangles, numVertices,
+            numTriangles * 3, acmrBefore, computeACMR( &indexData[0], numTriangles, 16 ) );
 }
 
 
 
-void SimpleModel::unitizeVertices( std::vector<float3>& vertices )
+void SimpleModel::unitizeVertices( std::vector<float>& positions )
 {
     float scaleX = 2.0 / (maxX - minX);
     float scaleY = 2.0 / (maxY - minY);
@@ -274,25 +285,63 @@ void SimpleModel::unitizeVertices( std::vector<float3>& vertices )
     float centerZ = minZ + (maxZ - minZ) * 0.5;
 
     float scaleMin = std::min( scaleX, std::min( scaleY, scaleZ ) );
-    for( int i = 0; i < (int)vertices.size(); i++ ) {
-        vertices[i].x = (vertices[i].x - centerX) * scaleMin;
-        vertices[i].y = (vertices[i].y - centerY) * scaleMin;
-        vertices[i].z = (vertices[i].z - centerZ) * scaleMin;
+    for( size_t i = 0; i < positions.size(); i += 3 ) {
+        positions[i+0] = (positions[i+0] - centerX) * scaleMin;
+        positions[i+1] = (positions[i+1] - centerY) * scaleMin;
+        positions[i+2] = (positions[i+2] - centerZ) * scaleMin;
     }
 }
 
+void SimpleModel::storeMesh( const char* filename, bool unitize )
+{
+    int numVertices = (int)vertexData.size();
+    mesh.allocate( filename, unitize, PACKED_POSITION_FLOAT, numVertices, numTriangles );
+
+    MeshCacheHeader& h = mesh.header();
+    h.boundsMin[0] = minX; h.boundsMin[1] = minY; h.boundsMin[2] = minZ;
+    h.boundsMax[0] = maxX; h.boundsMax[1] = maxY; h.boundsMax[2] = maxZ;
+
+    // models keep full-precision positions, since they can be any size
+    // before unitizing
+    if( numVertices )
+        PackedVertices::pack( PACKED_POSITION_FLOAT, numVertices, &vertexData[0].x,
+                              &normalData[0].x, &tangentData[0], mesh.vertices() );
+
+    // 16-bit indices when they fit
+    if( h.indexSize == 2 ) {
+        GLushort* indices = (GLushort*)mesh.indices();
+        for( size_t i = 0; i < indexData.size(); i++ )
+            indices[i] = GLushort(indexData[i]);
+    } else if( !indexData.empty() )
+        memcpy( mesh.indices(), &indexData[0], sizeof(GLuint) * indexData.size() );
+
+    if( !mesh.save() )
+        printf( " couldn't write the mesh cache for %s\n", filename );
+
+    // the cache's copy is the one that gets uploaded
+    std::vector<float3>().swap( vertexData );
+    std::vector<float3>().swap( normalData );
+    std::vector<float>().swap( tangentData );
+    std::vector<unsigned int>().swap( indexData );
+}
+
+
 void SimpleModel::createVBO()
 {
+    const MeshCacheHeader& h = mesh.header();
+
     glf->glGenVertexArrays(1, &vao);
     glf->glBindVertexArray(vao);
 
-    glf->glGenBuffers( 1, &normalBuffer );
-    glf->glBindBuffer( GL_ARRAY_BUFFER, normalBuffer );
-    glf->glBufferData( GL_ARRAY_BUFFER, sizeof(float3) * 3 * numTriangles, (void*)&normalData[0], GL_STATIC_DRAW );
-
     glf->glGenBuffers( 1, &vertexBuffer );
     glf->glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
-    glf->glBufferData( GL_ARRAY_BUFFER, sizeof(float3) * 3 * numTriangles, (void*)&vertexData[0], GL_STATIC_DRAW );\
+    glf->glBufferData( GL_ARRAY_BUFFER, size_t(h.vertexStride) * h.numVertices, mesh.vertices(), GL_STATIC_DRAW );
+
+    // the element buffer binding is part of the VAO
+    glf->glGenBuffers( 1, &indexBuffer );
+    glf->glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+    glf->glBufferData( GL_ELEMENT_ARRAY_BUFFER, size_t(h.indexSize) * 3 * h.numTriangles, mesh.indices(), GL_STATIC_DRAW );
+    indexType = h.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
     glf->glBindVertexArray(0);
 
@@ -300,32 +349,146 @@ void SimpleModel::createVBO()
 }
 
 
-void SimpleModel::drawVBO(DGLShader* shader)
+void SimpleModel::startLODs()
 {
-    if( !loaded )
+    if( numTriangles * 0.5f < MIN_LOD_TRIANGLES )
         return;
 
-    if( !madeVBO )
-        createVBO();
+    cancelLODs = false;
+    lodThread = std::thread( &SimpleModel::buildLODs, this );
+}
 
-    // draw!
+
+void SimpleModel::stopLODs()
+{
+    if( lodThread.joinable() )
+    {
+        cancelLODs = true;
+        lodThread.join();
+    }
+
+    for( int i = 0; i < NUM_MODEL_LODS; i++ )
+        std::vector<unsigned int>().swap( lodIndices[i] );
+    lodsReady = false;
+    numLODs = 0;
+    uploadedLODs = false;
+}
+
+
+void SimpleModel::buildLODs()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // the simplifier wants plain positions and normals, so unpack them from
+    // the cached vertices
+    const MeshCacheHeader& h = mesh.header();
+    int numVertices = h.numVertices;
+    std::vector<float> positions( numVertices * 3 ), normals( numVertices * 3 );
+    const char* vertices = (const char*)mesh.vertices();
+    for( int v = 0; v < numVertices; v++ ) {
+        const char* vertex = vertices + size_t(v) * h.vertexStride;
+        memcpy( &positions[v*3], vertex, 3 * sizeof(float) );
+        PackedVertices::octDecode( (const GLshort*)(vertex + 3 * sizeof(float)), &normals[v*3] );
+    }
+
+    std::vector<unsigned int> indices( numTriangles * 3 );
+    for( size_t i = 0; i < indices.size(); i++ )
+        indices[i] = h.indexSize == 2 ? ((const GLushort*)mesh.indices())[i] : ((const GLuint*)mesh.indices())[i];
+
+    // each LOD is made from the one before it
+    const float fractions[NUM_MODEL_LODS] = MODEL_LOD_FRACTIONS;
+    int built = 0;
+    for( int i = 0; i < NUM_MODEL_LODS && !cancelLODs; i++ ) {
+        int target = int(numTriangles * fractions[i]);
+        if( target < MIN_LOD_TRIANGLES )
+            break;
+
+        const std::vector<unsigned int>& source = i ? lodIndices[i-1] : indices;
+        lodIndices[i].resize( source.size() );
+        int n = simplifyMesh( &lodIndices[i][0], &source[0], int(source.size() / 3),
+                              &positions[0], &normals[0], numVertices, target );
+        lodIndices[i].resize( n * 3 );
+        built++;
+    }
+
+    if( cancelLODs )
+        return;
+
+    printf( " built %d LODs in %lld ms:", built, (long long)timer.elapsed() );
+    for( int i = 0; i < built; i++ )
+        printf( " %d", int(lodIndices[i].size() / 3) );
+    printf( " triangles\n" );
+
+    numLODs = built;
+    lodsReady = true;
+}
+
+
+void SimpleModel::uploadLODs()
+{
+    // the thread is done with the mesh by now
+    lodThread.join();
+    uploadedLODs = true;
+    if( !numLODs )
+        return;
+
+    const MeshCacheHeader& h = mesh.header();
+    size_t indexSize = h.indexSize;
+
+    int totalIndices = numTriangles * 3;
+    for( int i = 0; i < numLODs; i++ ) {
+        lodFirstIndex[i] = totalIndices;
+        totalIndices += int(lodIndices[i].size());
+    }
+
+    // the LODs go after the full mesh in a bigger element buffer
     glf->glBindVertexArray(vao);
+    glf->glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+    glf->glBufferData( GL_ELEMENT_ARRAY_BUFFER, indexSize * totalIndices, NULL, GL_STATIC_DRAW );
+    glf->glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, indexSize * numTriangles * 3, mesh.indices() );
+
+    for( int i = 0; i < numLODs; i++ ) {
+        std::vector<GLushort> shortIndices;
+        const void* data = &lodIndices[i][0];
+        if( indexSize == 2 ) {
+            shortIndices.assign( lodIndices[i].begin(), lodIndices[i].end() );
+            data = &shortIndices[0];
+        }
+        glf->glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, indexSize * lodFirstIndex[i], indexSize * lodIndices[i].size(), data );
 
-    int vert_loc = shader->getAttribLocation("vtx_position");
-    if(vert_loc >= 0) {
-        glf->glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
-        glf->glVertexAttribPointer(vert_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(vert_loc);
+        lodNumTriangles[i] = int(lodIndices[i].size() / 3);
+        std::vector<unsigned int>().swap( lodIndices[i] );
     }
+    glf->glBindVertexArray(0);
+}
+
+
+void SimpleModel::drawVBO(DGLShader* shader, bool coarse)
+{
+    if( !loaded || !numTriangles )
+        return;
+
+    if( !madeVBO )
+        createVBO();
+
+    if( lodsReady && !uploadedLODs )
+        uploadLODs();
 
-    int normal_loc = shader->getAttribLocation("vtx_normal");
-    if(normal_loc >= 0){
-        glf->glBindBuffer( GL_ARRAY_BUFFER, normalBuffer );
-        glf->glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(normal_loc);
+    int firstIndex = 0, drawTriangles = numTriangles;
+    if( coarse && uploadedLODs && numLODs ) {
+        firstIndex = lodFirstIndex[numLODs - 1];
+        drawTriangles = lodNumTriangles[numLODs - 1];
     }
 
-    glf->glDrawArrays(GL_TRIANGLES, 0, numTriangles * 3);
+    // draw!
+    glf->glBindVertexArray(vao);
+
+    glf->glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
+    PackedVertices::setAttributes( shader, mesh.header().positionFormat );
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    glf->glDrawElements(GL_TRIANGLES, drawTriangles * 3, indexType, (void*)(firstIndex * indexSize));
 
     glf->glBindVertexArray(0);
 }
@@ -47,9 +47,21 @@ infringement.
 #define _SIMPLE_MODEL_H_
 
 #include <vector>
+#include <atomic>
+#include <thread>
 #include <stdio.h>
 #include <math.h>
 #include "DGLShader.h"
+#include "MeshCache.h"
+
+class ObjReader;
+
+
+// coarser versions of the mesh are built in the background after loading,
+// at these fractions of its triangle count, but never below MIN_LOD_TRIANGLES
+#define NUM_MODEL_LODS 3
+#define MODEL_LOD_FRACTIONS { 0.5f, 0.25f, 0.1f }
+#define MIN_LOD_TRIANGLES 2000
 
 /*
 Very simple class for reading/displaying OBJs. Nothing fancy.
@@ -91,26 +103,56 @@ public:
     bool loadOBJ( const char* filename, bool unitize = true );
     bool isLoaded() { return loaded; }
 
-    void drawVBO(DGLShader* shader);
+    // coarse draws the smallest LOD built so far, for while the view is
+    // being dragged
+    void drawVBO(DGLShader* shader, bool coarse = false);
 
     void clear();
 
 private:
 
-    bool dataPass( FILE* file, std::vector<float3>&, std::vector<float3>& );
-    bool facePass( FILE* file, std::vector<float3>&, std::vector<float3>& );
-    void unitizeVertices( std::vector<float3>& );
+    void computeBounds( const std::vector<float>& positions );
+    void unitizeVertices( std::vector<float>& positions );
+    void buildMesh( const ObjReader& obj );
+    void optimizeMesh();
+    void storeMesh( const char* filename, bool unitize );
     void createVBO();
 
+    void startLODs();
+    void stopLODs();
+    void buildLODs();
+    void uploadLODs();
+
+    // while loading, one entry per distinct (position, normal, tangent), and
+    // three indices into them per triangle; tangents are xyzw, with the
+    // bitangent's handedness in w
     std::vector<float3> vertexData;
     std::vector<float3> normalData;
+    std::vector<float> tangentData;
+    std::vector<unsigned int> indexData;
+
+    // the finished mesh, as it's uploaded: mapped from the cache, or built
+    // from the OBJ and then written to the cache
+    MeshCache mesh;
     float minX, maxX, minY, maxY, minZ, maxZ;
     int numTriangles;
     GLuint vao;
     GLuint vertexBuffer;
-    GLuint normalBuffer;
+    GLuint indexBuffer;
+    GLenum indexType;
     bool madeVBO;
     bool loaded;
+
+    // the LODs' triangles index the same vertices, and go after the full
+    // mesh's in the element buffer once they're ready
+    std::thread lodThread;
+    std::atomic<bool> lodsReady;
+    std::atomic<bool> cancelLODs;
+    std::vector<unsigned int> lodIndices[NUM_MODEL_LODS];
+    int numLODs;
+    bool uploadedLODs;
+    int lodFirstIndex[NUM_MODEL_LODS];
+    int lodNumTriangles[NUM_MODEL_LODS];
 };
 
 
@@ -1,6 +1,7 @@
 #include "glerror.h"
 
 #include "Sphere.h"
+#include "PackedVertices.h"
 
 Sphere::Sphere(float radius, int nU, int nV) :
     _radius(radius), _nU(nU), _nV(nV), _ready(false)
@@ -11,9 +12,8 @@ Sphere::Sphere(float radius, int nU, int nV) :
     _vertices.resize(nVertices);
     _normals.resize(nVertices);
     _tangents.resize(nVertices);
-    _texCoords.resize(nVertices);
-    _colors.resize(nVertices);
     _indices.resize(3*nTriangles);
+    _numIndices = 3*nTriangles;
 
     for(int v=0;v<=nV;++v)
     {
@@ -26,7 +26,6 @@ Sphere::Sphere(float radius, int nU, int nV) :
             int index 	= u +(nU+1)*v;
 
             glm::vec3 vertex, tangent, normal;
-            glm::vec2 texCoord;
 
             // normal
             normal[0] = sin(theta) * cos(phi);
@@ -44,15 +43,9 @@ Sphere::Sphere(float radius, int nU, int nV) :
             tangent[2] = cos(theta);
             tangent = glm::normalize(tangent);
 
-            // texture coordinates
-            texCoord[1] = u / float(nU);
-            texCoord[0] = v / float(nV);
-
             _vertices[index] = vertex;
             _normals[index] = normal;
-            _tangents[index] = tangent;
-            _texCoords [index] = texCoord;
-            _colors[index] = glm::vec3(0.6f,0.2f,0.8f);
+            _tangents[index] = glm::vec4(tangent, 1.f);
         }
     }
 
@@ -78,14 +71,22 @@ Sphere::Sphere(float radius, int nU, int nV) :
 
 Sphere::~Sphere()
 {
-    glf->glDeleteVertexArrays(1, &_vao);
-    glf->glDeleteBuffers(6, _bufs);
+    if (_ready) {
+        glf->glDeleteVertexArrays(1, &_vao);
+        glf->glDeleteBuffers(2, _bufs);
+    }
 }
 
 void Sphere::init()
 {
+    // positions, normals and tangents interleaved in one buffer; half-float
+    // positions are plenty for a sphere this size
+    std::vector<char> vertices(PackedVertices::stride(PACKED_POSITION_HALF) * _vertices.size());
+    PackedVertices::pack(PACKED_POSITION_HALF, _vertices.size(), &_vertices[0][0],
+                         &_normals[0][0], &_tangents[0][0], vertices.data());
+
     glf->glGenVertexArrays(1, &_vao);
-    glf->glGenBuffers(6, _bufs);
+    glf->glGenBuffers(2, _bufs);
 
     glf->glBindVertexArray(_vao);
 
@@ -93,22 +94,16 @@ void Sphere::init()
     glf->glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * _indices.size(), _indices.data(),  GL_STATIC_DRAW);
 
     glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[1]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _vertices.size(), _vertices.data(), GL_STATIC_DRAW);
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[2]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _colors.size(), _colors.data(), GL_STATIC_DRAW);
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[3]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _normals.size(), _normals.data(), GL_STATIC_DRAW);
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[4]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _tangents.size(), _tangents.data(), GL_STATIC_DRAW);
-
-    glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[5]);
-    glf->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * _texCoords.size(), _texCoords.data(), GL_STATIC_DRAW);
+    glf->glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
 
     glf->glBindVertexArray(0);
 
+    // the GL has its own copies now
+    std::vector<int>().swap(_indices);
+    std::vector<glm::vec3>().swap(_vertices);
+    std::vector<glm::vec3>().swap(_normals);
+    std::vector<glm::vec4>().swap(_tangents);
+
     _ready = true;
 }
 
@@ -120,42 +115,10 @@ void Sphere::draw(const DGLShader *shader)
 
     glf->glBindVertexArray(_vao);
 
-    int vertex_loc = shader->getAttribLocation("vtx_position");
-    if(vertex_loc>=0){
-        glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[1]);
-        glf->glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(vertex_loc);
-    }
-
-    int color_loc = shader->getAttribLocation("vtx_color");
-    if(color_loc>=0){
-        glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[2]);
-        glf->glVertexAttribPointer(color_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(color_loc);
-    }
-
-    int normal_loc = shader->getAttribLocation("vtx_normal");
-    if(normal_loc>=0){
-        glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[3]);
-        glf->glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(normal_loc);
-    }
-
-    int tangent_loc = shader->getAttribLocation("vtx_tangent");
-    if(tangent_loc>=0){
-        glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[4]);
-        glf->glVertexAttribPointer(tangent_loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(tangent_loc);
-    }
-
-    int texCoord_loc = shader->getAttribLocation("vtx_texCoord");
-    if(texCoord_loc>=0){
-        glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[5]);
-        glf->glVertexAttribPointer(texCoord_loc, 2, GL_FLOAT, GL_FALSE, 0, 0);
-        glf->glEnableVertexAttribArray(texCoord_loc);
-    }
+    glf->glBindBuffer(GL_ARRAY_BUFFER, _bufs[1]);
+    PackedVertices::setAttributes(shader, PACKED_POSITION_HALF);
 
-    glf->glDrawElements(GL_TRIANGLES, _indices.size(),  GL_UNSIGNED_INT, 0);
+    glf->glDrawElements(GL_TRIANGLES, _numIndices,  GL_UNSIGNED_INT, 0);
 
     glf->glBindVertexArray(0);
 }
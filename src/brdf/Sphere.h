@@ -28,14 +28,14 @@ public:
 
 private :
     GLuint _vao;
-    GLuint _bufs[6];
+    GLuint _bufs[2];
 
+    /* built by the constructor, and freed once init() has packed and uploaded them */
     std::vector<int>            _indices;   /* vertex indices */
     std::vector<glm::vec3>		_vertices;  /* 3D positions */
-    std::vector<glm::vec3>		_colors;    /* colors */
     std::vector<glm::vec3>		_normals;   /* 3D normals */
-    std::vector<glm::vec3>		_tangents;  /* 3D tangent to surface */
-    std::vector<glm::vec2>		_texCoords; /* 2D texture coordinates */
+    std::vector<glm::vec4>		_tangents;  /* 3D tangent to surface, and handedness */
+    int _numIndices;
 
     float _radius;
     int   _nU, _nV;
@@ -0,0 +1,825 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QOffscreenSurface>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QFileInfo>
+#include <QDir>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "ThumbnailRenderer.h"
+#include "BRDFBase.h"
+#include "IBLWidget.h"
+#include "DGLFrameBuffer.h"
+#include "DGLShader.h"
+#include "Sphere.h"
+#include "Quad.h"
+#include "SampleSequence.h"
+#include "Paths.h"
+#include "UploadManager.h"
+#include "RenderCache.h"
+#include "glerror.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+// the IBL view's sample layout; thumbnails render a prefix of its passes
+#define IBL_STEP_SIZE 271
+#define IBL_TOTAL_SAMPLES (IBL_STEP_SIZE * 15)
+
+// matches the lit sphere view, whose default incident direction has theta doubled
+#define SPHERE_MARGIN 1.1f
+#define LIT_SPHERE_THETA (0.785398163f * 2.f)
+#define LIT_SPHERE_PHI 0.785398163f
+
+
+/*
+A few worker threads encoding images. Adding a job blocks while the queue is
+long, so that a slow disk holds the renderer back instead of piling up
+pixels in memory.
+*/
+class EncoderPool
+{
+public:
+    EncoderPool()
+        : _done(false)
+    {
+        int numThreads = std::max( (int)std::thread::hardware_concurrency() - 1, 1 );
+        _maxQueued = numThreads * 4;
+        for( int i = 0; i < numThreads; i++ )
+            _threads.push_back( std::thread( &EncoderPool::work, this ) );
+    }
+
+    ~EncoderPool()
+    {
+        finish();
+    }
+
+    void add( std::function<void()> job )
+    {
+        std::unique_lock<std::mutex> lock( _mutex );
+        _space.wait( lock, [this]() { return (int)_jobs.size() < _maxQueued; } );
+        _jobs.push_back( job );
+        _wake.notify_one();
+    }
+
+    // runs everything still queued and stops the threads
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _done = true;
+        }
+        _wake.notify_all();
+
+        for( size_t i = 0; i < _threads.size(); i++ )
+            _threads[i].join();
+        _threads.clear();
+    }
+
+private:
+    void work()
+    {
+        for( ;; )
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock( _mutex );
+                _wake.wait( lock, [this]() { return _done || !_jobs.empty(); } );
+                if( _jobs.empty() )
+                    return;
+                job = _jobs.front();
+                _jobs.pop_front();
+            }
+            _space.notify_one();
+
+            job();
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()> > _jobs;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _space;
+    int _maxQueued;
+    bool _done;
+};
+
+
+// the pixels of one item, on their way to the encoders
+struct ThumbnailPixels
+{
+    std::vector<unsigned char> litSphere;
+    std::vector<unsigned char> ibl;
+    std::vector<float> iblAccum;
+};
+
+
+static bool writePNG( const std::string& filename, const unsigned char* rgba, int size )
+{
+    // GL's rows go from the bottom up
+    QImage image( rgba, size, size, QImage::Format_RGBA8888 );
+    return image.mirrored().save( QString::fromStdString( filename ), "PNG" );
+}
+
+
+static bool writePFM( const std::string& filename, const float* accum, int size )
+{
+    FILE* f = fopen( filename.c_str(), "wb" );
+    if( !f )
+        return false;
+
+    // PFM rows go from the bottom up too, so they can be written as they are;
+    // the comp buffer holds the sum of the passes, with the count in alpha
+    fprintf( f, "PF\n%d %d\n-1.0\n", size, size );
+    std::vector<float> row( size * 3 );
+    for( int y = 0; y < size; y++ )
+    {
+        const float* src = accum + size_t(y) * size * 4;
+        for( int x = 0; x < size; x++ )
+        {
+            float invA = src[x*4+3] > 0.f ? 1.f / src[x*4+3] : 0.f;
+            for( int c = 0; c < 3; c++ )
+                row[x*3+c] = src[x*4+c] * invA;
+        }
+        fwrite( &row[0], sizeof(float), row.size(), f );
+    }
+
+    fclose( f );
+    return true;
+}
+
+
+// escapes a string for the JSON manifest
+static std::string jsonString( const std::string& s )
+{
+    std::string result = "\"";
+    for( size_t i = 0; i < s.size(); i++ )
+    {
+        // control characters aren't allowed in a JSON string as they are
+        if( (unsigned char)s[i] < 0x20 )
+        {
+            char escaped[8];
+            snprintf( escaped, sizeof(escaped), "\\u%04x", (unsigned char)s[i] );
+            result += escaped;
+            continue;
+        }
+
+        if( s[i] == '"' || s[i] == '\\' )
+            result += '\\';
+        result += s[i];
+    }
+    return result + "\"";
+}
+
+
+ThumbnailRenderer::Item::Item()
+    : loaded(false), cached(false), loadMS(0.), submitMS(0.), readbackWaitMS(0.), encodeMS(0.),
+      gpuLitSphereMS(0.), gpuIBLMS(0.)
+{
+}
+
+
+ThumbnailRenderer::Slot::Slot()
+    : itemIndex(-1), fence(0)
+{
+    for( int i = 0; i < NUM_THUMBNAIL_IMAGES; i++ )
+        pbos[i] = 0;
+    timerQueries[0] = timerQueries[1] = 0;
+}
+
+
+ThumbnailRenderer::ThumbnailRenderer( int size, int numIBLPasses, bool writeHDR )
+    : _size(size), _writeHDR(writeHDR), _surface(NULL),
+      _litSphereFBO(NULL), _iblFBO(NULL), _iblComp(NULL), _iblResult(NULL),
+      _compShader(NULL), _resultShader(NULL), _sphere(NULL), _quad(NULL),
+      _sobolTexID(0), _probeLibrary(NULL), _encoders(NULL)
+{
+    _numIBLPasses = std::min( std::max( numIBLPasses, 1 ), IBL_STEP_SIZE );
+}
+
+
+ThumbnailRenderer::~ThumbnailRenderer()
+{
+    delete _encoders;
+
+    if( !_surface )
+        return;
+
+    glcontext->makeCurrent( _surface );
+
+    for( int i = 0; i < THUMBNAIL_PIPELINE_DEPTH; i++ )
+    {
+        glf->glDeleteBuffers( NUM_THUMBNAIL_IMAGES, _slots[i].pbos );
+        glf->glDeleteQueries( 2, _slots[i].timerQueries );
+    }
+    if( _sobolTexID )
+        glf->glDeleteTextures( 1, &_sobolTexID );
+
+    delete _litSphereFBO;
+    delete _iblFBO;
+    delete _iblComp;
+    delete _iblResult;
+    delete _compShader;
+    delete _resultShader;
+    delete _sphere;
+    delete _quad;
+    delete _probeLibrary;
+
+    glcontext->doneCurrent();
+    delete _surface;
+    cleanOpenGLContext();
+}
+
+
+bool ThumbnailRenderer::initialize( const std::string& probeFilename )
+{
+    _surface = new QOffscreenSurface();
+    _surface->setFormat( surfaceFormat() );
+    _surface->create();
+    if( !_surface->isValid() )
+    {
+        printf( "couldn't create an offscreen surface\n" );
+        return false;
+    }
+
+    initOpenGLContext( _surface );
+
+    // there's no event loop to stream uploads from, and every item is drawn
+    // right after it's loaded anyway
+    UploadManager::instance()->setSynchronous( true );
+
+    _probeLibrary = new ProbeLibrary();
+    if( !_probeLibrary->acquire( probeFilename.c_str(), _probe ) )
+    {
+        printf( "couldn't load the probe %s\n", probeFilename.c_str() );
+        return false;
+    }
+
+    _litSphereFBO = new DGLFrameBuffer( _size, _size, "Lit Sphere Thumbnail" );
+    _litSphereFBO->addColorBuffer( 0, GL_RGBA8 );
+    _litSphereFBO->addDepthBuffer();
+    _litSphereFBO->checkStatus();
+
+    _iblFBO = new DGLFrameBuffer( _size, _size, "IBL Thumbnail" );
+    _iblFBO->addColorBuffer( 0, GL_RGBA32F );
+    _iblFBO->addDepthBuffer();
+    _iblFBO->checkStatus();
+
+    _iblComp = new DGLFrameBuffer( _size, _size, "IBL Thumbnail Comp" );
+    _iblComp->addColorBuffer( 0, GL_RGBA32F );
+    _iblComp->checkStatus();
+
+    _iblResult = new DGLFrameBuffer( _size, _size, "IBL Thumbnail Result" );
+    _iblResult->addColorBuffer( 0, GL_RGBA8 );
+    _iblResult->checkStatus();
+
+    _compShader = new DGLShader( (getShaderTemplatesPath() + "Quad.vert").c_str(), (getShaderTemplatesPath() + "IBLComp.frag").c_str() );
+    _resultShader = new DGLShader( (getShaderTemplatesPath() + "Quad.vert").c_str(), (getShaderTemplatesPath() + "IBLResult.frag").c_str() );
+
+    _sphere = new Sphere( 1.f, 100, 100 );
+    _quad = new Quad( 0.f, 0.f, _size, _size, 0.f, 0.f, 1.f, 1.f );
+
+    std::vector<unsigned int> points( IBL_TOTAL_SAMPLES * 2 );
+    generateSobol2D( &points[0], IBL_TOTAL_SAMPLES );
+    glf->glGenTextures( 1, &_sobolTexID );
+    glf->glBindTexture( GL_TEXTURE_2D, _sobolTexID );
+    glf->glTexImage2D( GL_TEXTURE_2D, 0, GL_RG32UI, IBL_TOTAL_SAMPLES, 1, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, &points[0] );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glf->glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glf->glBindTexture( GL_TEXTURE_2D, 0 );
+
+    // the readback buffers, one set per item in flight
+    size_t bytes[NUM_THUMBNAIL_IMAGES] = { size_t(_size) * _size * 4,
+                                           size_t(_size) * _size * 4,
+                                           size_t(_size) * _size * 4 * sizeof(float) };
+    for( int i = 0; i < THUMBNAIL_PIPELINE_DEPTH; i++ )
+    {
+        glf->glGenBuffers( NUM_THUMBNAIL_IMAGES, _slots[i].pbos );
+        for( int j = 0; j < NUM_THUMBNAIL_IMAGES; j++ )
+        {
+            glf->glBindBuffer( GL_PIXEL_PACK_BUFFER, _slots[i].pbos[j] );
+            glf->glBufferData( GL_PIXEL_PACK_BUFFER, bytes[j], NULL, GL_STREAM_READ );
+        }
+        glf->glGenQueries( 2, _slots[i].timerQueries );
+    }
+    glf->glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    CKGL();
+
+    return true;
+}
+
+
+void ThumbnailRenderer::makeOutputFilenames( const std::string& outputDir )
+{
+    // libraries often reuse names across directories, so number the repeats
+    std::map<std::string, int> used;
+    for( size_t i = 0; i < _items.size(); i++ )
+    {
+        std::string base = QFileInfo( QString::fromStdString( _items[i].brdfFilename ) ).completeBaseName().toStdString();
+        int count = used[base]++;
+        if( count )
+            base += "_" + std::to_string( count );
+
+        std::string path = outputDir + "/" + base;
+        _items[i].outputFilenames[THUMBNAIL_LIT_SPHERE] = path + "_litsphere.png";
+        _items[i].outputFilenames[THUMBNAIL_IBL] = path + "_ibl.png";
+        if( _writeHDR )
+            _items[i].outputFilenames[THUMBNAIL_IBL_HDR] = path + "_ibl.pfm";
+    }
+}
+
+
+bool ThumbnailRenderer::run( const std::vector<std::string>& brdfFiles, const std::string& outputDir,
+                             const std::string& probeFilename )
+{
+    if( !QDir().mkpath( QString::fromStdString( outputDir ) ) )
+    {
+        printf( "couldn't create %s\n", outputDir.c_str() );
+        return false;
+    }
+
+    if( !initialize( probeFilename ) )
+        return false;
+
+    _items.resize( brdfFiles.size() );
+    for( size_t i = 0; i < brdfFiles.size(); i++ )
+        _items[i].brdfFilename = brdfFiles[i];
+    makeOutputFilenames( outputDir );
+
+    _encoders = new EncoderPool();
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    int numItems = int(_items.size());
+    for( int i = 0; i < numItems; i++ )
+    {
+        // the slot's previous item has had a few items' worth of time to finish
+        Slot& slot = _slots[i % THUMBNAIL_PIPELINE_DEPTH];
+        if( slot.itemIndex >= 0 )
+            retire( slot );
+
+        Item& item = _items[i];
+        QElapsedTimer timer;
+        timer.start();
+
+        BRDFBase* brdf = createBRDFFromFile( item.brdfFilename );
+        item.loadMS = timer.nsecsElapsed() * 1e-6;
+        if( !brdf )
+        {
+            printf( "couldn't load %s\n", item.brdfFilename.c_str() );
+            continue;
+        }
+        item.loaded = true;
+
+        // thumbnails of a BRDF that hasn't changed since the last run only
+        // need encoding again
+        makeCacheKeys( item, brdf );
+        if( loadCached( item ) )
+        {
+            delete brdf;
+            continue;
+        }
+
+        timer.restart();
+        slot.itemIndex = i;
+        submit( slot, brdf );
+        item.submitMS = timer.nsecsElapsed() * 1e-6;
+
+        // GL holds on to anything still in use by the queued draws
+        delete brdf;
+
+        if( (i + 1) % 100 == 0 )
+            printf( "%d of %d thumbnails submitted\n", i + 1, numItems );
+    }
+
+    for( int i = 0; i < THUMBNAIL_PIPELINE_DEPTH; i++ )
+        if( _slots[i].itemIndex >= 0 )
+            retire( _slots[i] );
+
+    _encoders->finish();
+    RenderCache::trim();
+
+    double totalMS = totalTimer.nsecsElapsed() * 1e-6;
+    printf( "rendered %d thumbnails in %.1f s (%.1f ms each)\n", numItems, totalMS * 1e-3,
+            numItems ? totalMS / numItems : 0. );
+
+    writeManifest( outputDir, totalMS );
+    return true;
+}
+
+
+void ThumbnailRenderer::makeCacheKeys( Item& item, BRDFBase* brdf )
+{
+    for( int i = 0; i < NUM_THUMBNAIL_IMAGES; i++ )
+    {
+        RenderCacheKey key( "thumbnail" );
+        key.addInt( i );
+        key.addInt( _size );
+        if( i == THUMBNAIL_LIT_SPHERE )
+        {
+            key.addFloat( LIT_SPHERE_THETA );
+            key.addFloat( LIT_SPHERE_PHI );
+        }
+        else
+        {
+            key.addInt( _numIBLPasses );
+            key.addFile( _probe.filename );
+        }
+        key.addBRDF( brdf );
+        item.cacheKeys[i] = key.result();
+    }
+}
+
+
+bool ThumbnailRenderer::loadCached( Item& item )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    std::shared_ptr<ThumbnailPixels> pixels( new ThumbnailPixels );
+    size_t numPixels = size_t(_size) * _size;
+    pixels->litSphere.resize( numPixels * 4 );
+    pixels->ibl.resize( numPixels * 4 );
+
+    if( !RenderCache::load( item.cacheKeys[THUMBNAIL_LIT_SPHERE], _size, _size, 4, &pixels->litSphere[0] ) ||
+        !RenderCache::load( item.cacheKeys[THUMBNAIL_IBL], _size, _size, 4, &pixels->ibl[0] ) )
+        return false;
+
+    if( _writeHDR )
+    {
+        pixels->iblAccum.resize( numPixels * 4 );
+        if( !RenderCache::load( item.cacheKeys[THUMBNAIL_IBL_HDR], _size, _size, 4 * sizeof(float), &pixels->iblAccum[0] ) )
+            return false;
+    }
+
+    // reading the cache stands in for the readback
+    item.cached = true;
+    item.readbackWaitMS = timer.nsecsElapsed() * 1e-6;
+    encode( item, pixels, false );
+    return true;
+}
+
+
+void ThumbnailRenderer::submit( Slot& slot, BRDFBase* brdf )
+{
+    glf->glBeginQuery( GL_TIME_ELAPSED, slot.timerQueries[0] );
+    renderLitSphere( brdf );
+    glf->glEndQuery( GL_TIME_ELAPSED );
+
+    glf->glBeginQuery( GL_TIME_ELAPSED, slot.timerQueries[1] );
+    renderIBL( brdf );
+    glf->glEndQuery( GL_TIME_ELAPSED );
+
+    // start copying the results into the slot's buffers; nothing waits for
+    // them until the slot comes around again
+    DGLFrameBuffer* sources[NUM_THUMBNAIL_IMAGES] = { _litSphereFBO, _iblResult, _iblComp };
+    GLenum types[NUM_THUMBNAIL_IMAGES] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_FLOAT };
+    int numImages = _writeHDR ? NUM_THUMBNAIL_IMAGES : THUMBNAIL_IBL + 1;
+    for( int i = 0; i < numImages; i++ )
+    {
+        glf->glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbos[i] );
+        sources[i]->bind();
+        glf->glReadPixels( 0, 0, _size, _size, GL_RGBA, types[i], 0 );
+        sources[i]->unbind();
+    }
+    glf->glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    slot.fence = glf->glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    glf->glFlush();
+
+    CKGL();
+}
+
+
+void ThumbnailRenderer::renderLitSphere( BRDFBase* brdf )
+{
+    brdfPackage pkg;
+    pkg.brdf = brdf;
+    pkg.setDrawColor( 1, 1, 1 );
+    pkg.setColorMask( 0.3, 0.59, 0.11 );
+
+    float inTheta = LIT_SPHERE_THETA, inPhi = LIT_SPHERE_PHI;
+    float incidentVector[3] = { sinf(inTheta) * cosf(inPhi), sinf(inTheta) * sinf(inPhi), cosf(inTheta) };
+
+    glm::mat4 projectionMatrix = glm::ortho( -SPHERE_MARGIN, SPHERE_MARGIN, -SPHERE_MARGIN, SPHERE_MARGIN, 0.5f, 50.f );
+    glm::mat4 modelViewMatrix = glm::lookAt( glm::vec3(0, 0, 2.75), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0) );
+
+    _litSphereFBO->bind();
+    glf->glClearColor( 0.25, 0.25, 0.25, 1 );
+    glf->glEnable( GL_DEPTH_TEST );
+    glf->glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+    DGLShader* shader = brdf->getUpdatedShader( SHADER_LITSPHERE, &pkg );
+    if( shader )
+    {
+        shader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(projectionMatrix) );
+        shader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(modelViewMatrix) );
+        shader->setUniformFloat( "incidentVector", incidentVector[0], incidentVector[1], incidentVector[2] );
+        shader->setUniformFloat( "incidentTheta", inTheta );
+        shader->setUniformFloat( "incidentPhi", inPhi );
+        shader->setUniformFloat( "brightness", 1.f );
+        shader->setUniformFloat( "gamma", 2.2f );
+        shader->setUniformFloat( "exposure", 0.f );
+        shader->setUniformFloat( "useNDotL", 1.f );
+
+        _sphere->draw( shader );
+        brdf->disableShader( SHADER_LITSPHERE );
+    }
+
+    _litSphereFBO->unbind();
+}
+
+
+void ThumbnailRenderer::renderIBL( BRDFBase* brdf )
+{
+    brdfPackage pkg;
+    pkg.brdf = brdf;
+    pkg.setDrawColor( 1, 1, 1 );
+    pkg.setColorMask( 0.3, 0.59, 0.11 );
+
+    glm::mat4 projectionMatrix = glm::ortho( -SPHERE_MARGIN, SPHERE_MARGIN, -SPHERE_MARGIN, SPHERE_MARGIN, 0.5f, 50.f );
+    glm::mat4 modelViewMatrix = glm::lookAt( glm::vec3(0, 0, 2.75), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0) );
+    glm::mat3 normalMatrix = glm::inverseTranspose( glm::mat3(modelViewMatrix) );
+    glm::mat4 identity( 1.f );
+    glm::mat4 quadProjection = glm::ortho( 0.f, float(_size), 0.f, float(_size) );
+
+    glf->glClearColor( 0, 0, 0, 0 );
+    _iblComp->bind();
+    glf->glClear( GL_COLOR_BUFFER_BIT );
+    _iblComp->unbind();
+
+    // the same progressive accumulation as the IBL view, cut short
+    for( int pass = 0; pass < _numIBLPasses; pass++ )
+    {
+        _iblFBO->bind();
+        glf->glEnable( GL_DEPTH_TEST );
+        glf->glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+        DGLShader* shader = brdf->getUpdatedShader( SHADER_IBL, &pkg );
+        if( !shader )
+        {
+            _iblFBO->unbind();
+            break;
+        }
+
+        shader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(projectionMatrix) );
+        shader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(modelViewMatrix) );
+        shader->setUniformMatrix3( "normalMatrix", glm::value_ptr(normalMatrix) );
+        shader->setUniformFloat( "gamma", 2.2f );
+        shader->setUniformFloat( "exposure", 0.f );
+
+        shader->setUniformTexture( "envCube", _probe.envTexID, GL_TEXTURE_CUBE_MAP );
+        shader->setUniformTexture( "probTex", _probe.probTexID );
+        glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        shader->setUniformTexture( "marginalProbTex", _probe.marginalProbTexID );
+        glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glf->glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        shader->setUniformFloat( "texDims", float(_probe.numColumns), float(_probe.numRows) );
+        shader->setUniformFloat( "envTexels", 6.f * _probe.faceWidth * _probe.faceHeight );
+        shader->setUniformFloat( "envTableLevel", float(_probe.tableLevel) );
+        shader->setUniformInt( "envSamplingMode", ENV_SAMPLING_INVERSE_CDF );
+
+        shader->setUniformMatrix4( "envRotMatrix", glm::value_ptr(identity) );
+        shader->setUniformMatrix4( "envRotMatrixInverse", glm::value_ptr(identity) );
+
+        shader->setUniformInt( "totalSamples", IBL_TOTAL_SAMPLES );
+        shader->setUniformInt( "stepSize", IBL_STEP_SIZE );
+        shader->setUniformInt( "sampleSequence", SAMPLE_SEQUENCE_SOBOL );
+        shader->setUniformTexture( "sobolTex", _sobolTexID );
+        shader->setUniformInt( "passNumber", pass );
+
+        shader->setUniformFloat( "renderWithIBL", 1.0 );
+        shader->setUniformFloat( "useIBLImportance", 1.0 );
+        shader->setUniformFloat( "useBRDFImportance", 0.0 );
+        shader->setUniformFloat( "useMIS", 0.0 );
+        shader->setUniformFloat( "useSHDiffuse", 0.0 );
+        shader->setUniformFloat( "guideDepthOffset", 0.0 );
+
+        _sphere->draw( shader );
+        brdf->disableShader( SHADER_IBL );
+        _iblFBO->unbind();
+
+        // add the pass into the comp buffer
+        _iblComp->bind();
+        glf->glDisable( GL_DEPTH_TEST );
+        glf->glEnable( GL_BLEND );
+        glf->glBlendFunc( GL_ONE, GL_ONE );
+
+        _compShader->enable();
+        _compShader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(quadProjection) );
+        _compShader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(identity) );
+        _compShader->setUniformTexture( "resultTex", _iblFBO->colorBufferID() );
+        _quad->draw( _compShader );
+        _compShader->disable();
+
+        glf->glDisable( GL_BLEND );
+        _iblComp->unbind();
+    }
+
+    // and resolve it with the probe behind it
+    _iblResult->bind();
+    glf->glDisable( GL_DEPTH_TEST );
+    glf->glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+
+    _resultShader->enable();
+    _resultShader->setUniformMatrix4( "projectionMatrix", glm::value_ptr(quadProjection) );
+    _resultShader->setUniformMatrix4( "modelViewMatrix", glm::value_ptr(identity) );
+    _resultShader->setUniformTexture( "resultTex", _iblComp->colorBufferID() );
+    _resultShader->setUniformTexture( "envCube", _probe.envTexID, GL_TEXTURE_CUBE_MAP );
+    _resultShader->setUniformFloat( "gamma", 2.2f );
+    _resultShader->setUniformFloat( "exposure", 0.f );
+    _resultShader->setUniformFloat( "aspect", 1.f );
+    _resultShader->setUniformFloat( "renderWithIBL", 1.0 );
+    _resultShader->setUniformMatrix4( "envRotMatrix", glm::value_ptr(identity) );
+    _quad->draw( _resultShader );
+    _resultShader->disable();
+
+    glf->glDisable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+    _iblResult->unbind();
+}
+
+
+void ThumbnailRenderer::retire( Slot& slot )
+{
+    Item& item = _items[slot.itemIndex];
+    slot.itemIndex = -1;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // usually signalled already; if not, the GPU is the bottleneck
+    while( glf->glClientWaitSync( slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 ) == GL_TIMEOUT_EXPIRED )
+        ;
+    glf->glDeleteSync( slot.fence );
+    slot.fence = 0;
+
+    std::shared_ptr<ThumbnailPixels> pixels( new ThumbnailPixels );
+    size_t numBytes = size_t(_size) * _size * 4;
+    pixels->litSphere.resize( numBytes );
+    pixels->ibl.resize( numBytes );
+    if( _writeHDR )
+        pixels->iblAccum.resize( size_t(_size) * _size * 4 );
+
+    void* destinations[NUM_THUMBNAIL_IMAGES] = { &pixels->litSphere[0], &pixels->ibl[0],
+                                                 _writeHDR ? (void*)&pixels->iblAccum[0] : NULL };
+    size_t sizes[NUM_THUMBNAIL_IMAGES] = { numBytes, numBytes, numBytes * sizeof(float) };
+    int numImages = _writeHDR ? NUM_THUMBNAIL_IMAGES : THUMBNAIL_IBL + 1;
+    for( int i = 0; i < numImages; i++ )
+    {
+        glf->glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbos[i] );
+        void* mapped = glf->glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, sizes[i], GL_MAP_READ_BIT );
+        if( mapped )
+        {
+            memcpy( destinations[i], mapped, sizes[i] );
+            glf->glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+        }
+    }
+    glf->glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    item.readbackWaitMS = timer.nsecsElapsed() * 1e-6;
+
+    // the fence has passed, so the timer results are in
+    GLuint64 ns[2] = { 0, 0 };
+    glf->glGetQueryObjectui64v( slot.timerQueries[0], GL_QUERY_RESULT, &ns[0] );
+    glf->glGetQueryObjectui64v( slot.timerQueries[1], GL_QUERY_RESULT, &ns[1] );
+    item.gpuLitSphereMS = ns[0] * 1e-6;
+    item.gpuIBLMS = ns[1] * 1e-6;
+
+    encode( item, pixels, true );
+}
+
+
+void ThumbnailRenderer::encode( Item& item, std::shared_ptr<ThumbnailPixels> pixels, bool storeInCache )
+{
+    // each item is encoded by one job, so only that job touches its timings
+    int size = _size;
+    Item* itemPtr = &item;
+    _encoders->add( [pixels, itemPtr, size, storeInCache]()
+    {
+        QElapsedTimer encodeTimer;
+        encodeTimer.start();
+
+        if( storeInCache )
+        {
+            RenderCache::store( itemPtr->cacheKeys[THUMBNAIL_LIT_SPHERE], size, size, 4, &pixels->litSphere[0] );
+            RenderCache::store( itemPtr->cacheKeys[THUMBNAIL_IBL], size, size, 4, &pixels->ibl[0] );
+            if( !pixels->iblAccum.empty() )
+                RenderCache::store( itemPtr->cacheKeys[THUMBNAIL_IBL_HDR], size, size, 4 * sizeof(float), &pixels->iblAccum[0] );
+        }
+
+        bool ok = writePNG( itemPtr->outputFilenames[THUMBNAIL_LIT_SPHERE], &pixels->litSphere[0], size );
+        ok = writePNG( itemPtr->outputFilenames[THUMBNAIL_IBL], &pixels->ibl[0], size ) && ok;
+        if( !pixels->iblAccum.empty() )
+            ok = writePFM( itemPtr->outputFilenames[THUMBNAIL_IBL_HDR], &pixels->iblAccum[0], size ) && ok;
+        if( !ok )
+            printf( "couldn't write the thumbnails of %s\n", itemPtr->brdfFilename.c_str() );
+
+        itemPtr->encodeMS = encodeTimer.nsecsElapsed() * 1e-6;
+    });
+}
+
+
+void ThumbnailRenderer::writeManifest( const std::string& outputDir, double totalMS )
+{
+    std::string filename = outputDir + "/manifest.json";
+    FILE* f = fopen( filename.c_str(), "w" );
+    if( !f )
+    {
+        printf( "couldn't write %s\n", filename.c_str() );
+        return;
+    }
+
+    fprintf( f, "{\n" );
+    fprintf( f, "    \"size\": %d,\n", _size );
+    fprintf( f, "    \"iblPasses\": %d,\n", _numIBLPasses );
+    fprintf( f, "    \"probe\": %s,\n", jsonString( _probe.filename ).c_str() );
+    fprintf( f, "    \"totalMS\": %.3f,\n", totalMS );
+    fprintf( f, "    \"items\": [\n" );
+
+    for( size_t i = 0; i < _items.size(); i++ )
+    {
+        const Item& item = _items[i];
+        fprintf( f, "        { \"brdf\": %s", jsonString( item.brdfFilename ).c_str() );
+        if( item.loaded )
+        {
+            fprintf( f, ", \"litSphere\": %s", jsonString( item.outputFilenames[THUMBNAIL_LIT_SPHERE] ).c_str() );
+            fprintf( f, ", \"ibl\": %s", jsonString( item.outputFilenames[THUMBNAIL_IBL] ).c_str() );
+            if( _writeHDR )
+                fprintf( f, ", \"iblHDR\": %s", jsonString( item.outputFilenames[THUMBNAIL_IBL_HDR] ).c_str() );
+            if( item.cached )
+                fprintf( f, ", \"cached\": true" );
+            fprintf( f, ", \"loadMS\": %.3f, \"submitMS\": %.3f, \"gpuLitSphereMS\": %.3f, \"gpuIBLMS\": %.3f"
+                        ", \"readbackWaitMS\": %.3f, \"encodeMS\": %.3f",
+                     item.loadMS, item.submitMS, item.gpuLitSphereMS, item.gpuIBLMS,
+                     item.readbackWaitMS, item.encodeMS );
+        }
+        else
+            fprintf( f, ", \"error\": \"couldn't load\"" );
+        fprintf( f, " }%s\n", i + 1 < _items.size() ? "," : "" );
+    }
+
+    fprintf( f, "    ]\n}\n" );
+    fclose( f );
+
+    printf( "wrote %s\n", filename.c_str() );
+}
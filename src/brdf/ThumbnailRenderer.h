@@ -0,0 +1,171 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef THUMBNAIL_RENDERER_H
+#define THUMBNAIL_RENDERER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "SharedContextGLWidget.h"
+#include "ProbeLibrary.h"
+
+class QOffscreenSurface;
+class DGLFrameBuffer;
+class DGLShader;
+class Sphere;
+class Quad;
+class BRDFBase;
+class EncoderPool;
+struct ThumbnailPixels;
+
+
+// how many items can be in flight between submitting their draws and reading
+// back their pixels
+#define THUMBNAIL_PIPELINE_DEPTH 3
+
+#define THUMBNAIL_LIT_SPHERE 0
+#define THUMBNAIL_IBL 1
+#define THUMBNAIL_IBL_HDR 2
+#define NUM_THUMBNAIL_IMAGES 3
+
+
+/*
+Renders a lit sphere and an IBL thumbnail of every BRDF in a list without any
+UI, for building previews of a whole material library. It draws into FBOs in
+an offscreen context using the same shaders as the lit sphere and IBL views.
+
+Items are pipelined: the pixels of each one are read back into pixel buffer
+objects and only mapped a few items later, once their fence has signalled, so
+the GPU keeps working while the CPU loads the next BRDF. PNG (and optionally
+PFM) encoding then happens on worker threads. A manifest.json with the
+timings of every item is written to the output directory at the end.
+
+The pixels of every thumbnail also go into the RenderCache, so running over
+the same library again only renders the BRDFs that changed.
+
+Headless machines need a Qt platform that can create GL contexts without a
+display, e.g. QT_QPA_PLATFORM=offscreen or eglfs on Mesa's surfaceless EGL.
+*/
+
+class ThumbnailRenderer : public GLContext
+{
+public:
+    ThumbnailRenderer( int size, int numIBLPasses, bool writeHDR );
+    ~ThumbnailRenderer();
+
+    bool run( const std::vector<std::string>& brdfFiles, const std::string& outputDir,
+              const std::string& probeFilename );
+
+private:
+    struct Item
+    {
+        Item();
+
+        std::string brdfFilename;
+        std::string outputFilenames[NUM_THUMBNAIL_IMAGES];
+        std::string cacheKeys[NUM_THUMBNAIL_IMAGES];
+        bool loaded;
+        bool cached;
+
+        double loadMS;
+        double submitMS;
+        double readbackWaitMS;
+        double encodeMS;
+        double gpuLitSphereMS;
+        double gpuIBLMS;
+    };
+
+    // an item that has been drawn but not read back yet
+    struct Slot
+    {
+        Slot();
+
+        int itemIndex;
+        GLuint pbos[NUM_THUMBNAIL_IMAGES];
+        GLuint timerQueries[2];
+        GLsync fence;
+    };
+
+    bool initialize( const std::string& probeFilename );
+    void makeOutputFilenames( const std::string& outputDir );
+
+    void makeCacheKeys( Item& item, BRDFBase* brdf );
+    bool loadCached( Item& item );
+
+    void submit( Slot& slot, BRDFBase* brdf );
+    void renderLitSphere( BRDFBase* brdf );
+    void renderIBL( BRDFBase* brdf );
+    void retire( Slot& slot );
+    void encode( Item& item, std::shared_ptr<ThumbnailPixels> pixels, bool storeInCache );
+
+    void writeManifest( const std::string& outputDir, double totalMS );
+
+    int _size;
+    int _numIBLPasses;
+    bool _writeHDR;
+
+    QOffscreenSurface* _surface;
+
+    DGLFrameBuffer* _litSphereFBO;
+    DGLFrameBuffer* _iblFBO;
+    DGLFrameBuffer* _iblComp;
+    DGLFrameBuffer* _iblResult;
+    DGLShader* _compShader;
+    DGLShader* _resultShader;
+    Sphere* _sphere;
+    Quad* _quad;
+    GLuint _sobolTexID;
+
+    ProbeLibrary* _probeLibrary;
+    ProbeTextures _probe;
+
+    std::vector<Item> _items;
+    Slot _slots[THUMBNAIL_PIPELINE_DEPTH];
+    EncoderPool* _encoders;
+};
+
+#endif
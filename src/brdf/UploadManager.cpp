@@ -0,0 +1,336 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#include <QTimer>
+#include <QOffscreenSurface>
+#include <string.h>
+#include <algorithm>
+#include "UploadManager.h"
+#include "glerror.h"
+
+
+static int bytesPerPixel( GLenum format, GLenum type )
+{
+    int channels = 4;
+    switch( format )
+    {
+        case GL_RED: case GL_RED_INTEGER: channels = 1; break;
+        case GL_RG:  case GL_RG_INTEGER:  channels = 2; break;
+        case GL_RGB: case GL_RGB_INTEGER: channels = 3; break;
+    }
+
+    int size = 4;
+    switch( type )
+    {
+        case GL_UNSIGNED_BYTE: case GL_BYTE: size = 1; break;
+        case GL_HALF_FLOAT: case GL_UNSIGNED_SHORT: case GL_SHORT: size = 2; break;
+    }
+
+    return channels * size;
+}
+
+
+UploadManager* UploadManager::instance()
+{
+    static UploadManager* manager = new UploadManager();
+    return manager;
+}
+
+
+UploadManager::Job::Job()
+    : group(0), buffer(0), texture(0), target(0), level(0), width(0), height(0),
+      format(0), type(0), data(NULL), srcRowBytes(0), rowBytes(0), numBytes(0),
+      progress(0), submitted(false), fence(0)
+{
+}
+
+
+UploadManager::UploadManager()
+    : _stagingBuffer(0), _synchronous(false), _lastGroup(0), _surface(NULL)
+{
+    _timer = new QTimer( this );
+    _timer->setSingleShot( true );
+    connect( _timer, SIGNAL(timeout()), this, SLOT(pump()) );
+}
+
+
+int UploadManager::newGroup()
+{
+    return ++_lastGroup;
+}
+
+
+void UploadManager::uploadBuffer( int group, GLuint buffer, const void* data, size_t numBytes,
+                                  std::shared_ptr<const void> owner )
+{
+    Job job;
+    job.group = group;
+    job.buffer = buffer;
+    job.data = (const unsigned char*)data;
+    job.numBytes = numBytes;
+    job.owner = owner;
+    add( job );
+}
+
+
+void UploadManager::uploadTexture( int group, GLuint texture, GLenum target, int level, int width, int height,
+                                   GLenum format, GLenum type, const void* data, size_t srcRowBytes,
+                                   std::shared_ptr<const void> owner )
+{
+    Job job;
+    job.group = group;
+    job.texture = texture;
+    job.target = target;
+    job.level = level;
+    job.width = width;
+    job.height = height;
+    job.format = format;
+    job.type = type;
+    job.data = (const unsigned char*)data;
+    job.srcRowBytes = srcRowBytes;
+    job.rowBytes = size_t(width) * bytesPerPixel( format, type );
+    job.numBytes = job.rowBytes * height;
+    job.owner = owner;
+    add( job );
+}
+
+
+void UploadManager::afterUploads( int group, UploadCallback callback )
+{
+    // an empty job, so it completes after the ones ahead of it
+    Job job;
+    job.group = group;
+    job.onComplete = callback;
+    add( job );
+}
+
+
+void UploadManager::add( Job& job )
+{
+    job.submitted = job.numBytes == 0;
+
+    // send it all now; GL orders the copies before any later draws, so
+    // there's no need to wait for them
+    if( _synchronous )
+    {
+        while( !job.submitted )
+            submitChunk( job, UPLOAD_CHUNK_BYTES );
+        if( job.onComplete )
+            job.onComplete();
+        return;
+    }
+
+    _jobs.push_back( job );
+    if( !_timer->isActive() )
+        _timer->start( 0 );
+}
+
+
+bool UploadManager::isPending( int group ) const
+{
+    for( size_t i = 0; i < _jobs.size(); i++ )
+        if( group && _jobs[i].group == group )
+            return true;
+    return false;
+}
+
+
+void UploadManager::cancel( int group )
+{
+    for( size_t i = 0; i < _jobs.size(); )
+    {
+        if( group && _jobs[i].group == group )
+        {
+            if( _jobs[i].fence )
+                glf->glDeleteSync( _jobs[i].fence );
+            _jobs.erase( _jobs.begin() + i );
+        }
+        else i++;
+    }
+}
+
+
+void UploadManager::setSynchronous( bool synchronous )
+{
+    _synchronous = synchronous;
+}
+
+
+void UploadManager::makeCurrent()
+{
+    // the views share one context; if none of them has it current, borrow it
+    if( QOpenGLContext::currentContext() == glcontext )
+        return;
+
+    if( !_surface )
+    {
+        _surface = new QOffscreenSurface();
+        _surface->setFormat( surfaceFormat() );
+        _surface->create();
+    }
+    glcontext->makeCurrent( _surface );
+}
+
+
+void* UploadManager::mapStaging( size_t numBytes )
+{
+    if( !_stagingBuffer )
+        glf->glGenBuffers( 1, &_stagingBuffer );
+
+    // orphan the previous contents, so we never wait on a copy that's still
+    // reading them
+    glf->glBindBuffer( GL_COPY_READ_BUFFER, _stagingBuffer );
+    glf->glBufferData( GL_COPY_READ_BUFFER, numBytes, NULL, GL_STREAM_DRAW );
+    return glf->glMapBufferRange( GL_COPY_READ_BUFFER, 0, numBytes,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+}
+
+
+size_t UploadManager::submitChunk( Job& job, size_t budget )
+{
+    size_t chunkBytes = std::min( budget, (size_t)UPLOAD_CHUNK_BYTES );
+    size_t sent = 0;
+
+    if( !job.texture )
+    {
+        sent = std::min( chunkBytes, job.numBytes - job.progress );
+        void* staging = mapStaging( sent );
+        if( staging )
+        {
+            memcpy( staging, job.data + job.progress, sent );
+            glf->glUnmapBuffer( GL_COPY_READ_BUFFER );
+
+            glf->glBindBuffer( GL_COPY_WRITE_BUFFER, job.buffer );
+            glf->glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, job.progress, sent );
+            glf->glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+        }
+        glf->glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+
+        job.progress += sent;
+        job.submitted = job.progress >= job.numBytes;
+    }
+    else
+    {
+        // whole rows at a time, and always at least one
+        int firstRow = int(job.progress);
+        int numRows = std::min( std::max( int(chunkBytes / job.rowBytes), 1 ), job.height - firstRow );
+        sent = job.rowBytes * numRows;
+
+        void* staging = mapStaging( sent );
+        if( staging )
+        {
+            for( int row = 0; row < numRows; row++ )
+                memcpy( (unsigned char*)staging + job.rowBytes * row,
+                        job.data + job.srcRowBytes * (firstRow + row), job.rowBytes );
+            glf->glUnmapBuffer( GL_COPY_READ_BUFFER );
+            glf->glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+
+            GLenum bindTarget = job.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+            glf->glBindBuffer( GL_PIXEL_UNPACK_BUFFER, _stagingBuffer );
+            glf->glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+            glf->glBindTexture( bindTarget, job.texture );
+            glf->glTexSubImage2D( job.target, job.level, 0, firstRow, job.width, numRows,
+                                  job.format, job.type, 0 );
+            glf->glBindTexture( bindTarget, 0 );
+            glf->glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+            glf->glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+        }
+        else glf->glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+
+        job.progress += numRows;
+        job.submitted = int(job.progress) >= job.height;
+    }
+
+    CKGL();
+
+    return sent;
+}
+
+
+void UploadManager::pump()
+{
+    if( _jobs.empty() )
+        return;
+
+    makeCurrent();
+
+    // send the next few chunks
+    size_t budget = UPLOAD_BYTES_PER_PUMP;
+    for( size_t i = 0; i < _jobs.size() && budget > 0; i++ )
+    {
+        Job& job = _jobs[i];
+        while( !job.submitted && budget > 0 )
+            budget -= std::min( budget, submitChunk( job, budget ) );
+
+        if( job.submitted && !job.fence )
+            job.fence = glf->glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    }
+    glf->glFlush();
+
+    // and finish off the ones the GPU is done with, without waiting on any
+    bool completed = false;
+    while( !_jobs.empty() && _jobs.front().fence )
+    {
+        GLenum status = glf->glClientWaitSync( _jobs.front().fence, 0, 0 );
+        if( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+            break;
+
+        Job job = _jobs.front();
+        _jobs.pop_front();
+        glf->glDeleteSync( job.fence );
+
+        if( job.onComplete )
+            job.onComplete();
+        completed = true;
+    }
+
+    // keep going straight away while there's more to send; otherwise just
+    // check back on the fences
+    if( !_jobs.empty() )
+        _timer->start( _jobs.back().submitted ? 1 : 0 );
+
+    if( completed )
+        emit uploadsCompleted();
+}
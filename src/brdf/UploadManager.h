@@ -0,0 +1,167 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <QObject>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "SharedContextGLWidget.h"
+
+class QTimer;
+class QOffscreenSurface;
+
+
+// how much is staged per chunk, and how much each trip through the event
+// loop sends before giving the UI a turn
+#define UPLOAD_CHUNK_BYTES (4 << 20)
+#define UPLOAD_BYTES_PER_PUMP (8 << 20)
+
+typedef std::function<void()> UploadCallback;
+
+
+/*
+Streams large buffer and texture uploads to the GPU a few megabytes at a
+time from the event loop, so loading a measured BRDF or a probe never stalls
+the UI on one big transfer. Each chunk is copied into an orphaned staging
+buffer and then into its destination on the GPU, so the copies overlap with
+whatever the views are drawing.
+
+The destination must already have its storage (glBufferData / glTexImage2D
+with no data). The source data has to stay put until the upload completes;
+owner, if given, is held on to until then. Uploads are tracked in groups (all
+the textures of a probe, say) and complete in the order they were added: once
+the fence after an upload's last chunk has passed it's done, and
+uploadsCompleted() is the views' cue to redraw with the new data.
+*/
+
+class UploadManager : public QObject, public GLContext
+{
+    Q_OBJECT
+
+public:
+    static UploadManager* instance();
+
+    int newGroup();
+
+    void uploadBuffer( int group, GLuint buffer, const void* data, size_t numBytes,
+                       std::shared_ptr<const void> owner = std::shared_ptr<const void>() );
+
+    // target is GL_TEXTURE_2D or one of the cube map faces; srcRowBytes is
+    // the distance between rows in data
+    void uploadTexture( int group, GLuint texture, GLenum target, int level, int width, int height,
+                        GLenum format, GLenum type, const void* data, size_t srcRowBytes,
+                        std::shared_ptr<const void> owner = std::shared_ptr<const void>() );
+
+    // runs callback once everything added so far has completed
+    void afterUploads( int group, UploadCallback callback );
+
+    // true while any upload in the group hasn't completed
+    bool isPending( int group ) const;
+
+    // true once everything added so far has completed
+    bool isIdle() const { return _jobs.empty(); }
+
+    // drops the uploads of a group whose textures are going away
+    void cancel( int group );
+
+    // when synchronous (for batch rendering), uploads are sent as soon as
+    // they're added and callbacks run right away
+    void setSynchronous( bool synchronous );
+
+signals:
+    void uploadsCompleted();
+
+private slots:
+    void pump();
+
+private:
+    struct Job
+    {
+        Job();
+
+        int group;
+
+        GLuint buffer;
+        GLuint texture;
+        GLenum target;
+        int level;
+        int width, height;
+        GLenum format, type;
+
+        const unsigned char* data;
+        size_t srcRowBytes;
+        size_t rowBytes;
+        size_t numBytes;
+
+        // bytes (buffers) or rows (textures) sent so far
+        size_t progress;
+        bool submitted;
+        GLsync fence;
+
+        std::shared_ptr<const void> owner;
+        UploadCallback onComplete;
+    };
+
+    UploadManager();
+
+    void add( Job& job );
+    size_t submitChunk( Job& job, size_t budget );
+    void* mapStaging( size_t numBytes );
+    void makeCurrent();
+
+    std::deque<Job> _jobs;
+    GLuint _stagingBuffer;
+    bool _synchronous;
+    int _lastGroup;
+
+    QTimer* _timer;
+    QOffscreenSurface* _surface;
+};
+
+#endif
@@ -1,5 +1,5 @@
 TEMPLATE = app
-CONFIG += qt5  #debug
+CONFIG += qt5 c++11  #debug
 
 isEmpty(prefix) {
 	prefix = $$system(pf-makevar --absolute root 2>/dev/null)
@@ -32,10 +32,12 @@ SOURCES = \
     FloatVarWidget.cpp \
     DGLFrameBuffer.cpp \
     DGLShader.cpp \
+    Denoiser.cpp \
     IBLWidget.cpp \
     IBLWindow.cpp \
     ImageSliceWidget.cpp \
     ImageSliceWindow.cpp \
+    LatLongImage.cpp \
     LitSphereWindow.cpp \
     main.cpp \
     glerror.cpp \
@@ -51,7 +53,23 @@ SOURCES = \
     Plot3DWidget.cpp \
     LitSphereWidget.cpp \
     SimpleModel.cpp \
+    CacheFile.cpp \
+    MeshCache.cpp \
+    MeshFrames.cpp \
+    MeshSimplifier.cpp \
+    PlotGeometry.cpp \
+    CurveSampler.cpp \
+    AlbedoCurveCache.cpp \
+    PackedVertices.cpp \
+    MeshOptimizer.cpp \
+    ObjReader.cpp \
     Paths.cpp \
+    ProbeCache.cpp \
+    ProbeLibrary.cpp \
+    RenderCache.cpp \
+    SampleSequence.cpp \
+    ThumbnailRenderer.cpp \
+    UploadManager.cpp \
     ptex/PtexReader.cpp \
     ptex/PtexUtils.cpp \
     ptex/PtexCache.cpp \
@@ -45,11 +45,19 @@ infringement.
 
 #include <fstream>
 #include <QApplication>
+#include <QGuiApplication>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
 #include <QDesktopWidget>
 #include <QMessageBox>
 #include "MainWindow.h"
 #include "ParameterWindow.h"
 #include "Paths.h"
+#include "SampleSequence.h"
+#include "ObjReader.h"
+#include "ProbeLibrary.h"
+#include "ThumbnailRenderer.h"
 
 #include <iostream>
 #include <sstream>
@@ -72,8 +80,96 @@ bool checkTeapot()
 }
 
 
+// brdf --thumbnails outputDir [--size n] [--passes n] [--probe file] [--hdr] files/dirs...
+int renderThumbnails( int argc, char *argv[] )
+{
+    QGuiApplication app(argc, argv);
+    setlocale(LC_NUMERIC,"C");
+
+    if( argc < 3 || !checkTeapot() )
+    {
+        printf( "usage: brdf --thumbnails outputDir [--size n] [--passes n] [--probe file] [--hdr] files/dirs...\n" );
+        printf( "(run from the directory containing the data/, probes/, and shaderTemplates/ subdirectories)\n" );
+        return 1;
+    }
+
+    std::string outputDir = argv[2];
+    std::string probe = getProbesPath() + "beach.penv";
+    int size = 256;
+    int passes = 64;
+    bool hdr = false;
+
+    std::vector<std::string> files;
+    QStringList brdfFilters;
+    brdfFilters << "*.brdf" << "*.binary" << "*.bparam" << "*.dat";
+    for( int i = 3; i < argc; i++ )
+    {
+        std::string arg = argv[i];
+        if( arg == "--size" && i + 1 < argc )
+            size = atoi( argv[++i] );
+        else if( arg == "--passes" && i + 1 < argc )
+            passes = atoi( argv[++i] );
+        else if( arg == "--probe" && i + 1 < argc )
+            probe = argv[++i];
+        else if( arg == "--hdr" )
+            hdr = true;
+
+        // directories are searched for anything that looks like a BRDF
+        else if( QFileInfo( argv[i] ).isDir() )
+        {
+            QDirIterator it( argv[i], brdfFilters, QDir::Files, QDirIterator::Subdirectories );
+            while( it.hasNext() )
+                files.push_back( it.next().toStdString() );
+        }
+        else
+            files.push_back( arg );
+    }
+
+    if( size < 1 )
+        size = 256;
+
+    ThumbnailRenderer renderer( size, passes, hdr );
+    return renderer.run( files, outputDir, probe ) ? 0 : 1;
+}
+
+
 int main(int argc, char *argv[])
 {
+    // compare the IBL view's sample sequences without bringing up any UI
+    if( argc > 1 && std::string(argv[1]) == "--benchmark-sampling" )
+    {
+        benchmarkSampleSequences( 271, 15 );
+        return 0;
+    }
+
+    // time the OBJ reader on the teapot (or the file given) and a big generated mesh
+    if( argc > 1 && std::string(argv[1]) == "--benchmark-obj" )
+    {
+        benchmarkObjReader( argc > 2 ? argv[2] : (getModelsPath() + "teapot.obj").c_str() );
+        return 0;
+    }
+
+    // time loading the beach probe (or the file given) with and without the probe cache
+    if( argc > 1 && std::string(argv[1]) == "--benchmark-probe" )
+    {
+        // the application object names the cache directory, as in a normal run
+        QCoreApplication app(argc, argv);
+        benchmarkProbeLoading( argc > 2 ? argv[2] : (getProbesPath() + "beach.penv").c_str() );
+        return 0;
+    }
+
+    // compare the env map samplers on the beach probe (or the file given)
+    if( argc > 1 && std::string(argv[1]) == "--benchmark-env-sampling" )
+    {
+        QCoreApplication app(argc, argv);
+        benchmarkEnvSampling( argc > 2 ? argv[2] : (getProbesPath() + "beach.penv").c_str() );
+        return 0;
+    }
+
+    // render thumbnails of a BRDF library without bringing up any UI
+    if( argc > 1 && std::string(argv[1]) == "--thumbnails" )
+        return renderThumbnails( argc, argv );
+
     QApplication app(argc, argv);
     setlocale(LC_NUMERIC,"C");
 
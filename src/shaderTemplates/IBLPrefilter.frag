@@ -0,0 +1,159 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#version 410
+
+// convolves the environment cube map into one face/mip of a prefiltered cube map:
+// either a GGX lobe of the given roughness (assuming N = V = R), or a cosine lobe
+// for the irradiance map. Each texel is the lobe-weighted average radiance.
+
+uniform samplerCube envCube;
+uniform int face;
+uniform float sourceFaceSize;
+uniform float roughness;
+uniform float irradiance;
+uniform int numSamples;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+const float PI_ = 3.14159265358979323846264;
+
+
+// direction through a point on a GL cube map face (see the cube map table in the GL spec)
+vec3 faceDirection( int face, vec2 st )
+{
+    st = st * 2.0 - vec2(1.0);
+
+    if( face == 0 ) return vec3(  1.0, -st.y, -st.x );
+    if( face == 1 ) return vec3( -1.0, -st.y,  st.x );
+    if( face == 2 ) return vec3(  st.x,  1.0,  st.y );
+    if( face == 3 ) return vec3(  st.x, -1.0, -st.y );
+    if( face == 4 ) return vec3(  st.x, -st.y,  1.0 );
+    return vec3( -st.x, -st.y, -1.0 );
+}
+
+
+float radicalInverse( uint bits )
+{
+    bits = ( bits << 16u) | ( bits >> 16u);
+    bits = ((bits & 0x00ff00ffu) << 8u) | ((bits & 0xff00ff00u) >> 8u);
+    bits = ((bits & 0x0f0f0f0fu) << 4u) | ((bits & 0xf0f0f0f0u) >> 4u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xccccccccu) >> 2u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xaaaaaaaau) >> 1u);
+    return float(bits) * 2.3283064365386963e-10; // divide by 1<<32
+}
+
+
+void main(void)
+{
+    vec3 N = normalize( faceDirection( face, texCoord ) );
+
+    // a mirror lobe is just the environment itself
+    if( irradiance < 0.5 && roughness <= 0.0 )
+    {
+        fragColor = vec4( textureLod( envCube, N, 0.0 ).rgb, 1.0 );
+        return;
+    }
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0,0,1) : vec3(1,0,0);
+    vec3 T = normalize( cross( up, N ) );
+    vec3 B = cross( N, T );
+
+    float alpha2 = pow( roughness, 4.0 );
+
+    // solid angle of a texel at the top of the source, for choosing which mip to read
+    float texelSolidAngle = 4.0 * PI_ / (6.0 * sourceFaceSize * sourceFaceSize);
+
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+
+    for( int i = 0; i < numSamples; i++ )
+    {
+        float u = (float(i) + 0.5) / float(numSamples);
+        float phi = 2.0 * PI_ * radicalInverse( uint(i) );
+
+        vec3 L;
+        float pdf, weight;
+
+        if( irradiance > 0.5 )
+        {
+            // cosine-weighted directions; the cosine is in the pdf, so every sample counts the same
+            float cosTheta = sqrt( 1.0 - u );
+            float sinTheta = sqrt( u );
+            L = vec3( sinTheta * cos(phi), sinTheta * sin(phi), cosTheta );
+            pdf = cosTheta / PI_;
+            weight = 1.0;
+        }
+        else
+        {
+            // GGX distributed half vectors, reflected about the normal
+            float cosThetaH = sqrt( (1.0 - u) / (1.0 + (alpha2 - 1.0) * u) );
+            float sinThetaH = sqrt( 1.0 - cosThetaH * cosThetaH );
+            vec3 H = vec3( sinThetaH * cos(phi), sinThetaH * sin(phi), cosThetaH );
+            L = 2.0 * cosThetaH * H - vec3(0,0,1);
+
+            // D(h) * NdotH / (4 VdotH), with VdotH == NdotH since V == N
+            float d = cosThetaH * cosThetaH * (alpha2 - 1.0) + 1.0;
+            pdf = alpha2 / (PI_ * d * d) / 4.0;
+            weight = L.z;
+        }
+
+        if( L.z <= 0.0 )
+            continue;
+
+        // filtered importance sampling - read from the mip whose texels cover
+        // about as much solid angle as each sample does
+        float sampleSolidAngle = 1.0 / (float(numSamples) * pdf);
+        float lod = max( 0.5 * log2( sampleSolidAngle / texelSolidAngle ) + 1.0, 0.0 );
+
+        vec3 dir = T * L.x + B * L.y + N * L.z;
+        sum += textureLod( envCube, dir, lod ).rgb * weight;
+        weightSum += weight;
+    }
+
+    fragColor = vec4( sum / max( weightSum, 1e-6 ), 1.0 );
+}
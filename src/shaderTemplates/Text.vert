@@ -6,9 +6,12 @@ in int Character;
 out int vCharacter;
 out int vPosition;
 
+// the labels share one buffer; this is where the one being drawn starts
+uniform int FirstCharacter;
+
 void main()
 {
     vCharacter = Character;
-    vPosition = gl_VertexID;
+    vPosition = gl_VertexID - FirstCharacter;
     gl_Position = vec4(0, 0, 0, 1);
 }
@@ -52,6 +52,11 @@ uniform int passNumber;
 uniform int stepSize;
 uniform int totalSamples;
 
+// 0: strided Hammersley passes, 1: consecutive runs of the Sobol points in
+// sobolTex (32-bit fixed point x, y), Owen-scrambled per pixel
+uniform int sampleSequence;
+uniform usampler2D sobolTex;
+
 uniform float brightness;
 uniform float gamma;
 uniform float exposure;
@@ -69,6 +74,21 @@ uniform sampler2D probTex;
 uniform sampler2D marginalProbTex;
 uniform vec2 texDims;
 
+// texels in the top level of envCube (all six faces), and the mip level the
+// sampling tables were built from
+uniform float envTexels;
+uniform float envTableLevel;
+
+// 0: inverse CDF, 1: alias table, 2: hierarchical warp
+uniform int envSamplingMode;
+uniform sampler2D aliasTex;
+uniform sampler2D samplingPyramidTex;
+uniform int samplingPyramidTopLevel;
+
+// SH diffuse: the probe's irradiance / pi as 9 SH coefficients (env space)
+uniform float useSHDiffuse;
+uniform vec3 shIrradiance[9];
+
 // probability textures:
 // R component: PDF
 // G component: CDF
@@ -79,7 +99,12 @@ in vec3 eyeSpaceTangent;
 in vec3 eyeSpaceBitangent;
 in vec4 eyeSpaceVert;
 
-out vec4 fragColor;
+layout(location = 0) out vec4 fragColor;
+
+// eye space normal and depth, for the denoiser; each tile of the BRDF
+// grid is pushed to its own depth range
+layout(location = 1) out vec4 guide;
+uniform float guideDepthOffset;
 
 ::INSERT_UNIFORMS_HERE::
 
@@ -208,6 +233,40 @@ float hammersleySample(uint bits, uint seed)
 }
 
 
+uint owenScramble( uint x, uint seed )
+{
+    // the Laine-Karras permutation only lets lower bits affect higher ones,
+    // so run it on the reversed bits
+    x = bitfieldReverse( x );
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return bitfieldReverse( x );
+}
+
+
+// the s-th sample of this pass
+vec2 passSample( uint s, float u, uint seed1, uint seed2 )
+{
+    if( sampleSequence == 1 )
+    {
+        // pass n takes the n-th run of points, so the passes rendered so
+        // far always make up a prefix of the sequence
+        uint samplesPerPass = uint(totalSamples / stepSize);
+        int index = passNumber * int(samplesPerPass) + int(s);
+        uvec2 p = texelFetch( sobolTex, ivec2(index, 0), 0 ).xy;
+        return vec2( owenScramble( p.x, seed1 ) >> 8u,
+                     owenScramble( p.y, seed2 ) >> 8u ) * (1.0 / 16777216.0);
+    }
+
+    uint i = uint(passNumber) + s * uint(stepSize);
+    return vec2( fract( u + float(i) / float(totalSamples) ),
+                 fract( hammersleySample(i, seed2) ) );
+}
+
+
 float warpSample1D( sampler2D tex, float texDim, float u, float v, out float probInv )
 {
     float invTexDim = 1/texDim;
@@ -250,13 +309,107 @@ vec2 warpSample( vec2 uv, out float probInv )
 }
 
 
+// alias table: pick a texel uniformly, then either keep it or jump to its alias
+// alias texel: R = probability of keeping, GB = alias texel, A = pdf of the texel
+vec2 warpSampleAlias( vec2 uv, out float probInv )
+{
+    vec2 pos = uv * texDims;
+    ivec2 texel = min( ivec2(pos), ivec2(texDims) - ivec2(1) );
+    vec2 frac = pos - vec2(texel);
+
+    vec4 entry = texelFetch( aliasTex, texel, 0 );
+
+    // reuse the part of u that decided between texel and alias as the position in the texel
+    if( frac.x < entry.r )
+        frac.x = frac.x / entry.r;
+    else
+    {
+        frac.x = (frac.x - entry.r) / (1.0 - entry.r);
+        texel = ivec2( entry.gb );
+        entry = texelFetch( aliasTex, texel, 0 );
+    }
+
+    probInv = 1.0 / entry.a;
+    return (vec2(texel) + frac) / texDims;
+}
+
+
+// hierarchical warp: choose a face from the top of the pdf pyramid, then
+// descend the face's quadtree, warping uv into each chosen quadrant
+vec2 warpSampleHierarchical( vec2 uv, out float probInv )
+{
+    int top = samplingPyramidTopLevel;
+
+    float total = 0.0;
+    for( int i = 0; i < 6; i++ )
+        total += texelFetch( samplingPyramidTex, ivec2(i,0), top ).r;
+
+    float u = uv.x * total;
+    int face = 0;
+    float faceWeight = texelFetch( samplingPyramidTex, ivec2(0,0), top ).r;
+    while( face < 5 && u >= faceWeight )
+    {
+        u -= faceWeight;
+        face++;
+        faceWeight = texelFetch( samplingPyramidTex, ivec2(face,0), top ).r;
+    }
+    uv.x = clamp( u / max(faceWeight, 1e-20), 0.0, 0.99999994 );
+
+    ivec2 texel = ivec2( face, 0 );
+    for( int level = top - 1; level >= 0; level-- )
+    {
+        texel *= 2;
+        float w00 = texelFetch( samplingPyramidTex, texel,              level ).r;
+        float w10 = texelFetch( samplingPyramidTex, texel + ivec2(1,0), level ).r;
+        float w01 = texelFetch( samplingPyramidTex, texel + ivec2(0,1), level ).r;
+        float w11 = texelFetch( samplingPyramidTex, texel + ivec2(1,1), level ).r;
+
+        // choose the column...
+        float left = w00 + w01;
+        float right = w10 + w11;
+        float pLeft = (left + right) > 0.0 ? left / (left + right) : 0.5;
+        if( uv.x < pLeft )
+            uv.x /= pLeft;
+        else
+        {
+            uv.x = (uv.x - pLeft) / (1.0 - pLeft);
+            texel.x += 1;
+            w00 = w10;
+            w01 = w11;
+        }
+
+        // ...then the row within it
+        float pLow = (w00 + w01) > 0.0 ? w00 / (w00 + w01) : 0.5;
+        if( uv.y < pLow )
+            uv.y /= pLow;
+        else
+        {
+            uv.y = (uv.y - pLow) / (1.0 - pLow);
+            texel.y += 1;
+        }
+    }
+
+    // level 0 of the pyramid is normalized to be the pdf over the [0..1]^2 domain
+    probInv = 1.0 / texelFetch( samplingPyramidTex, texel, 0 ).r;
+    return (vec2(texel) + uv) / texDims;
+}
+
+
 vec4 envMapSample( float u, float v )
 {
     float probInv = 1;
     vec2 uv = vec2(u,v);
 
     if (useIBLImportance > .5)
-        uv = warpSample( uv, probInv ); // will overwrite prob with actual pdf value
+    {
+        // will overwrite prob with actual pdf value
+        if( envSamplingMode == 1 )
+            uv = warpSampleAlias( uv, probInv );
+        else if( envSamplingMode == 2 )
+            uv = warpSampleHierarchical( uv, probInv );
+        else
+            uv = warpSample( uv, probInv );
+    }
 
     vec3 esSampleDir = uvToVector( uv );
     // TODO - precompute LocalToWorld * envRotMatrixInverse
@@ -269,8 +422,19 @@ vec4 envMapSample( float u, float v )
     // since we're working in tangent space, the basis vectors can be nice and easy and hardcoded
     vec3 brdf = max( BRDF( tsSampleDir, tsViewVec, vec3(0,0,1), vec3(1,0,0), vec3(0,1,0) ), vec3(0.0) );
 
+    // importance sampled radiance comes from a mip level matching the sample's
+    // footprint: at least the level the tables resolve (finer detail inside a
+    // table texel isn't in the pdf, and only makes fireflies), and coarser
+    // where the pdf spreads the samples thinly (Colbert and Krivanek 2007)
+    float lod = 0.0;
+    if (useIBLImportance > .5)
+    {
+        float footprint = 0.5 * log2( probInv * envTexels / float(totalSamples) ) + 1.0;
+        lod = max( envTableLevel, footprint );
+    }
+
     // sample env map
-    vec3 envSample = textureLod( envCube, esSampleDir, 0 ).rgb;
+    vec3 envSample = textureLod( envCube, esSampleDir, lod ).rgb;
 
     // dA (area of cube) = (6*2*2)/N  (Note: divide by N happens later)
     // dw = dA / r^3 = 24 * pow(x*x + y*y + z*z, -1.5) (see pbrt v2 p 947).
@@ -288,27 +452,65 @@ vec4 envMapSample( float u, float v )
 }
 
 
+vec3 evalSHIrradiance( vec3 n )
+{
+    return shIrradiance[0] * 0.282095 +
+           shIrradiance[1] * (0.488603 * n.y) +
+           shIrradiance[2] * (0.488603 * n.z) +
+           shIrradiance[3] * (0.488603 * n.x) +
+           shIrradiance[4] * (1.092548 * n.x * n.y) +
+           shIrradiance[5] * (1.092548 * n.y * n.z) +
+           shIrradiance[6] * (0.315392 * (3.0 * n.z * n.z - 1.0)) +
+           shIrradiance[7] * (1.092548 * n.x * n.z) +
+           shIrradiance[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+}
+
+
+// for (mostly) diffuse BRDFs: the directional albedo from a fixed set of
+// cosine-distributed directions, times the SH irradiance at the normal.
+// It's deterministic, so a single pass is all there is.
+vec4 computeSHDiffuse()
+{
+    const uint numAlbedoSamples = 64u;
+    vec3 albedo = vec3(0.0);
+
+    for( uint i = 0u; i < numAlbedoSamples; i++ )
+    {
+        float u = (float(i) + 0.5) / float(numAlbedoSamples);
+        float v = hammersleySample( i, 0u );
+
+        float r = sqrt( u );
+        float phi = 6.28318531 * v;
+        vec3 L = vec3( r * cos(phi), r * sin(phi), sqrt(max(0.0, 1.0 - u)) );
+
+        // cosine / pdf is pi
+        albedo += max( BRDF( L, tsViewVec, vec3(0,0,1), vec3(1,0,0), vec3(0,1,0) ), vec3(0.0) );
+    }
+    albedo *= 3.14159265 / float(numAlbedoSamples);
+
+    vec3 envNormal = normalize( mat3(envRotMatrix) * esNormal );
+    return vec4( albedo * max( evalSHIrradiance( envNormal ), vec3(0.0) ), 1.0 );
+}
+
+
 vec4 computeIBL()
 {
     vec4 result = vec4(0.0);
     uint seed1 = hash(uint(gl_FragCoord.x), uint(gl_FragCoord.y));
     uint seed2 = hash(seed1, 1000u);
 
-    float inv = 1.0 / float(totalSamples);
-    float bigInv = inv * float(stepSize);
-
+    uint samplesPerPass = uint(totalSamples / stepSize);
     float u = float(seed1) * 2.3283064365386963e-10;
 
     // importance sample the BRDF
     if( useBRDFImportance != 0.0 )
     {
-        for( uint i = uint(passNumber); i < uint(totalSamples); i += uint(stepSize) )
+        for( uint s = 0u; s < samplesPerPass; s++ )
         {
-            float uu = fract( u + i * inv);
-            float vv = fract( hammersleySample(i, seed2) );
+            vec2 uv = passSample( s, u, seed1, seed2 );
 
             // choose a sample from the environment map
-            //result += envMapSample( uu, vv );
+            //result += envMapSample( uv.x, uv.y );
         }
 
         result = vec4(0,1,0,1);
@@ -317,13 +519,12 @@ vec4 computeIBL()
     // multiple importance sampling
     else if( useMIS != 0.0 )
     {
-        for( uint i = uint(passNumber); i < uint(totalSamples); i += uint(stepSize) )
+        for( uint s = 0u; s < samplesPerPass; s++ )
         {
-            float uu = fract( u + i * inv);
-            float vv = fract( hammersleySample(i, seed2) );
+            vec2 uv = passSample( s, u, seed1, seed2 );
 
             // choose a sample from the environment map
-            //result += envMapSample( uu, vv );
+            //result += envMapSample( uv.x, uv.y );
         }
 
         result = vec4(1,0,0,1);
@@ -332,13 +533,12 @@ vec4 computeIBL()
     // importance sample the IBL, or don't importance sample at all
     else
     {
-        for( uint i = uint(passNumber); i < uint(totalSamples); i += uint(stepSize) )
+        for( uint s = 0u; s < samplesPerPass; s++ )
         {
-            float uu = fract( u + i * inv);
-            float vv = fract( hammersleySample(i, seed2) );
+            vec2 uv = passSample( s, u, seed1, seed2 );
 
             // choose a sample from the environment map
-            result += envMapSample( uu, vv );
+            result += envMapSample( uv.x, uv.y );
         }
     }
 
@@ -350,9 +550,13 @@ vec4 computeIBL()
 
 void main(void)
 {
+    // interpolation leaves the frame a little skewed; square it up again,
+    // keeping the bitangent's handedness
     esNormal = normalize( eyeSpaceNormal );
-    esTangent = normalize( eyeSpaceTangent );
-    esBitangent = normalize( eyeSpaceBitangent );
+    esTangent = normalize( eyeSpaceTangent - esNormal * dot( esNormal, eyeSpaceTangent ) );
+    esBitangent = cross( esNormal, esTangent );
+    if( dot( esBitangent, eyeSpaceBitangent ) < 0.0 )
+        esBitangent = -esBitangent;
     //viewVec = -normalize( eyeSpaceVert );
     viewVec = vec3(0,0,1);
 
@@ -375,6 +579,12 @@ void main(void)
         result = vec4( b, 1.0 );
     }
 
+    // or light the diffuse lobe with the SH irradiance?
+    else if( useSHDiffuse > 0.5 )
+    {
+        result = computeSHDiffuse();
+    }
+
     // or render samples from an IBL?
     else
     {
@@ -382,4 +592,5 @@ void main(void)
     }
 
     fragColor = result;
+    guide = vec4( esNormal, guideDepthOffset - eyeSpaceVert.z );
 }
@@ -50,7 +50,8 @@ uniform mat4 modelViewMatrix;
 uniform mat3 normalMatrix;
 
 in vec3 vtx_position;
-in vec3 vtx_normal;
+in vec2 vtx_normal;     // octahedral, see PackedVertices
+in vec2 vtx_tangent;    // angle about the normal, and handedness
 
 out vec3 eyeSpaceNormal;
 out vec3 eyeSpaceTangent;
@@ -64,15 +65,31 @@ void computeTangentVectors( vec3 inVec, out vec3 uVec, out vec3 vVec )
     vVec = normalize(cross(inVec, uVec));
 }
 
+vec3 octDecode( vec2 e )
+{
+    vec3 v = vec3( e, 1.0 - abs(e.x) - abs(e.y) );
+    if( v.z < 0.0 )
+        v.xy = (1.0 - abs(v.yx)) * vec2( v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0 );
+    return normalize( v );
+}
+
 
 // nothing to see here
 void main(void)
 {
+    // the tangent is stored relative to the frame computeTangentVectors()
+    // makes for the normal
+    vec3 normal = octDecode( vtx_normal );
+    vec3 u, v;
+    computeTangentVectors( normal, u, v );
+    float angle = vtx_tangent.x * 3.14159265;
+    vec3 tangent = cos(angle) * u + sin(angle) * v;
+
     // do the necessary transformations
     eyeSpaceVert = modelViewMatrix * vec4(vtx_position,1);
-    eyeSpaceNormal = normalMatrix * vtx_normal;
-
-    computeTangentVectors( eyeSpaceNormal, eyeSpaceTangent, eyeSpaceBitangent );
+    eyeSpaceNormal = normalMatrix * normal;
+    eyeSpaceTangent = mat3(modelViewMatrix) * tangent;
+    eyeSpaceBitangent = vtx_tangent.y * cross( eyeSpaceNormal, eyeSpaceTangent );
 
     gl_Position = projectionMatrix * eyeSpaceVert;
 }
@@ -54,12 +54,16 @@ uniform float useLogPlot;
 uniform float useNDotL;
 uniform vec3 colorMask;
 
-in vec3 vtx_position;
+layout(location = 0) in vec3 vtx_position;
 
 out vec4 eyeSpaceVert;
 
 ::INSERT_UNIFORMS_HERE::
 
+#ifdef SWEEP_PARAMETER
+out float sweepValue;
+#endif
+
 
 ::INSERT_BRDF_FUNCTION_HERE::
 
@@ -100,5 +104,10 @@ void main(void)
     // do the necessary transformations
     eyeSpaceVert = modelViewMatrix * inPos;
     gl_Position = projectionMatrix * eyeSpaceVert;
+
+#ifdef SWEEP_PARAMETER
+    // the swept parameter is a per-instance input
+    sweepValue = SWEEP_PARAMETER;
+#endif
 }
 
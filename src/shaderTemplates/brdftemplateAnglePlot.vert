@@ -55,10 +55,14 @@ uniform float useNDotL;
 uniform float phiV;
 uniform vec3 colorMask;
 
-in vec3 vtx_position;
+layout(location = 0) in vec3 vtx_position;
 
 ::INSERT_UNIFORMS_HERE::
 
+#ifdef SWEEP_PARAMETER
+out float sweepValue;
+#endif
+
 
 ::INSERT_BRDF_FUNCTION_HERE::
 
@@ -99,5 +103,10 @@ void main(void)
     // do the necessary transformations
     vec4 eyeSpaceVert = modelViewMatrix * inPos;
     gl_Position = projectionMatrix * eyeSpaceVert;
+
+#ifdef SWEEP_PARAMETER
+    // the swept parameter is a per-instance input
+    sweepValue = SWEEP_PARAMETER;
+#endif
 }
 
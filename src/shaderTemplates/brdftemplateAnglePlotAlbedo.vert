@@ -53,10 +53,14 @@ uniform float incidentPhi;
 uniform float useLogPlot;
 uniform float useNDotL;
 uniform float phiD;
-uniform int nSamples;
-uniform float sampleMultOn;
 uniform vec3 colorMask;
-uniform int samplingMode;
+
+// the running sums of the curve at numAngles incident angles from -90 to
+// 90 degrees, as accumulated by brdftemplateAlbedoCurve.frag, and how many
+// samples went into them
+uniform sampler2D albedoCurve;
+uniform int numAngles;
+uniform int numAlbedoSamples;
 
 const float PI_ = 3.14159265358979323846264;
 const vec3 RGB2L = vec3(0.3, 0.59, 0.11);
@@ -65,181 +69,27 @@ in vec3 vtx_position;
 
 out vec4 v_albedoData;
 
-::INSERT_UNIFORMS_HERE::
-
-
-::INSERT_BRDF_FUNCTION_HERE::
-
-float hammersleySample(uint bits)
-{
-    bits = ( bits << 16u) | ( bits >> 16u);
-    bits = ((bits & 0x00ff00ffu) << 8u) | ((bits & 0xff00ff00u) >> 8u);
-    bits = ((bits & 0x0f0f0f0fu) << 4u) | ((bits & 0xf0f0f0f0u) >> 4u);
-    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xccccccccu) >> 2u);
-    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xaaaaaaaau) >> 1u);
-    return float(bits) * 2.3283064365386963e-10; // divide by 1<<32
-}
 
 float modifyLog( float x ) {
         // log base 10
         return log(x + 1.0) * 0.434294482;
 }
 
-float rand(vec2 n) {
-  return fract(sin(dot(n.xy, vec2(12.9898, 78.233)))* 43758.5453);
-}
-
-//Sampling functions return costheta/pdf
-//As passed in, view=vec3(cos(phi), sin(phi), 1.0)
-float CosinePDF(in vec3 incident, in vec3 view) {
-  if (view.z < 0.0) return 0.0;
-  return view.z/PI_;
-}
-
-float CosineSample(in float x1, in vec3 incident, inout vec3 view) {
-  float r = sqrt(x1);
-  float costheta_v = sqrt(1-r*r);
-  view = normalize( vec3( r*view.x, r*view.y, costheta_v));
-  return PI_;
-}
-
-float UniformPDF(in vec3 incident, in vec3 view) {
-  return 0.5/PI_;
-}
-
-float UniformSample(in float x1, in vec3 incident, inout vec3 view) {
-  float costheta_v = x1;
-  float sintheta_v = sqrt(1-costheta_v*costheta_v);
-  view = normalize( vec3(costheta_v*view.x, costheta_v*view.y, sintheta_v) );
-  return 2.0*PI_*costheta_v;
-}
-
-float PolarPDF(in vec3 incident, in vec3 view) {
-  float costheta_v = view.z;
-  float sintheta_v = sqrt(1.0-costheta_v*costheta_v);
-  return 1.0/(PI_*PI_*sintheta_v);
-}
-
-float PolarSample(in float x1, in vec3 incident, inout vec3 view) {
-  float costheta_v = cos(x1*0.5*PI_);
-  float sintheta_v = sin(x1*0.5*PI_);
-  view = normalize( vec3(sintheta_v*view.x, sintheta_v*view.y, costheta_v) );
-  return PI_*PI_*costheta_v*sintheta_v;
-}
-
-
-float BlinnPDF(in float exponent, in vec3 incident, in vec3 view) {
-  vec3 H = normalize(incident+view);
-  float costhetah = H.z;
-  float costhetad = dot(view, H);
-  if (costhetad < 0) return 0.0;
-  return (exponent+1.0)*pow(costhetah,exponent)/(PI_*8.0*costhetad);
-}
-
-
-float BlinnSample(in float exponent, in float x1, in vec3 incident, inout vec3 view) {
-  float costhetah = pow(x1, 1.0/(exponent+1.0));
-  float sinthetah = sqrt(max(0.0,1.0-costhetah*costhetah));
-  vec3 halfvector = vec3(sinthetah*view.x, sinthetah*view.y, costhetah);
-  if (halfvector.z*incident.z < 0) halfvector = -1.0*halfvector;
-  view = -incident + 2.0*dot(incident, halfvector)*halfvector;
-  float pdfinv = PI_*8.0*dot(incident, halfvector)/((exponent+1.0)*pow(costhetah,exponent));
-  if (view.z < 0.0) return 0.0;
-  return view.z*pdfinv;
-}
-
-float MISPowerHeuristic(int n_f, float pdf_f, int n_g, float pdf_g) {
-  float f = n_f*pdf_f;
-  float g = n_g*pdf_g;
-  return f*f/(f*f+g*g);
-}
-
 
 void main(void)
 {
-
-	int i, j;
-
-	// orthonormal vectors
-	vec3 N = vec3(0,0,1); // normal
-	vec3 X = vec3(1,0,0); // tangent
-	vec3 Y = vec3(0,1,0); // bitangent
-
 	// theta is encoded in Z; x and y might get stretched
 	float yAngle = vtx_position.z;
-	vec3 normalizedIncidentVector = normalize( vec3(  sin(yAngle) * cos(incidentPhi),
-														 sin(yAngle) * sin(incidentPhi),
-															cos(yAngle) ) );
-  float bexponent = 2;
-  //Estimate exponent, use brdf value at theta~=80 degrees as a 'minimum'
-  //binary search (at normal incidence) for theta where brdf is 5% of it's peak
-  if (samplingMode == 3 || samplingMode == 4) { //if Blinn-Phong sampling or MIS
-    float cosphi = cos(incidentPhi);
-    float sinphi = sin(incidentPhi);
-    float theta = 0.25*PI_;
-    float deltatheta = 0.5*theta;
-    float maxbrdfval = dot(RGB2L, BRDF(N, N, N, X, Y));
-    float minbrdfval = dot(RGB2L, BRDF(N, vec3(0.985*cosphi, 0.985*sinphi, 0.1697), N, X, Y));
-    float target = 0.05*maxbrdfval+minbrdfval;
-    float brdfval = dot(RGB2L, BRDF(N, vec3(sin(theta)*cosphi,sin(theta)*sinphi, cos(theta)), N, X, Y));
 
-    while( deltatheta>0.01 && abs(target-brdfval)>0.01*target && theta<0.5*PI_ ) {
-      if( brdfval < target) theta-= deltatheta;
-      else theta += deltatheta;
-      deltatheta = deltatheta*0.5;
-      float costhetah = cos(theta);
-      float sinthetah = sin(theta);
-      brdfval= dot(RGB2L, BRDF(N, normalize(vec3(sinthetah*cosphi, sinthetah*sinphi, costhetah)), N, X, Y ));
-    }
-    bexponent = max(2.0,min(1000.0,log(brdfval)/log(cos(theta/2.0))));
-    if (theta<0.2) bexponent = 1000.0;
-    if ((maxbrdfval-minbrdfval)/minbrdfval<1.5) bexponent = 2.0;
-    bexponent *= 2; //This might help?
-  }
+  // look up the sums at this angle, between the texel centres
+  float t = clamp( (yAngle + 0.5*PI_) / PI_, 0.0, 1.0 );
+  vec4 sums = texture( albedoCurve, vec2( (t * float(numAngles - 1) + 0.5) / float(numAngles), 0.5 ) );
 
-  //Hemisphere sampling
-  int ns = nSamples;
-  if (sampleMultOn > 0.5) ns *= 10;
-  float ns_inv = 1.0/float(ns);
-  vec3 radianceFull = vec3(0,0,0);
-  vec3 radiance23 = vec3(0,0,0);
-  for(i=0; i<ns; i++) {
-      float phi_v = 2.0*PI_*float(i)*ns_inv;
-      float x1 = hammersleySample(uint(i));
-      vec3 viewingVector = vec3(cos(phi_v), sin(phi_v), 1.0);
-      float costhetaoverpdf;
-      if (samplingMode == 0 || samplingMode == 4) costhetaoverpdf = CosineSample(x1, normalizedIncidentVector, viewingVector);
-      else if (samplingMode == 1) costhetaoverpdf = UniformSample(x1, normalizedIncidentVector, viewingVector);
-      else if (samplingMode == 2) costhetaoverpdf = PolarSample(x1, normalizedIncidentVector, viewingVector);
-      else if (samplingMode == 3) costhetaoverpdf = BlinnSample(bexponent, x1, normalizedIncidentVector, viewingVector);
-      vec3 radiance = BRDF(normalizedIncidentVector, viewingVector, N, X, Y )*costhetaoverpdf;
-      //Multiple Importance Sampling (2x as many samples)
-      if (samplingMode == 4) {
-        radiance *= MISPowerHeuristic(ns, CosinePDF(normalizedIncidentVector, viewingVector),
-                                      ns, BlinnPDF(bexponent, normalizedIncidentVector, viewingVector));
-        //Blinn-Phong Sample
-        viewingVector = vec3(cos(phi_v), sin(phi_v), 1.0);
-        float costhetaoverpdfG = BlinnSample(bexponent, x1, normalizedIncidentVector, viewingVector);
-        vec3 radianceG = BRDF(normalizedIncidentVector, viewingVector, N, X, Y )*costhetaoverpdfG;
-        radianceG *= MISPowerHeuristic( ns,
-                                          viewingVector.z/costhetaoverpdfG,
-                                          ns,
-                                          CosinePDF(normalizedIncidentVector, viewingVector) );
-        if (costhetaoverpdfG>0) {
-          radianceFull += radianceG;
-          if(i%3!=0) radiance23 += radianceG;
-        }
-      }
-      if (costhetaoverpdf>0) {
-        radianceFull += radiance;
-        if(i%3!=0) radiance23 += radiance;
-      }
-  }
-  vec3 bRes = ns_inv*radianceFull;
-  vec3 bRes23 = ns_inv*radiance23*(3.0/2.0);
+  float ns_inv = 1.0/float(max(numAlbedoSamples, 1));
+  vec3 bRes = ns_inv*sums.rgb;
 
   float bResL = dot(bRes, RGB2L);
-  float bRes23L = dot(bRes23, RGB2L);
+  float bRes23L = ns_inv*sums.a*(3.0/2.0);
 
   //calculate whether or not the sample is likely to be converged
   float error = abs(bResL-bRes23L)/bResL;
@@ -55,10 +55,14 @@ uniform float useNDotL;
 uniform vec3 colorMask;
 uniform float thetaH;
 
-in vec3 vtx_position;
+layout(location = 0) in vec3 vtx_position;
 
 ::INSERT_UNIFORMS_HERE::
 
+#ifdef SWEEP_PARAMETER
+out float sweepValue;
+#endif
+
 
 ::INSERT_BRDF_FUNCTION_HERE::
 
@@ -98,5 +102,10 @@ void main(void)
 
     // plot curve, apply pan and zoom
     gl_Position = projectionMatrix * modelViewMatrix * vec4( thetaD, b, 0, 1 );
+
+#ifdef SWEEP_PARAMETER
+    // the swept parameter is a per-instance input
+    sweepValue = SWEEP_PARAMETER;
+#endif
 }
 
@@ -0,0 +1,129 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#version 410
+
+// evaluates the curve one of the plots draws, densely and all at once, so
+// the plot can pick where its vertices go. Each texel of the 1-high target
+// is one angle, numSamples of them running from angleStart to angleEnd; the
+// result is the height (or, for the polar plot, radius) the plot would draw.
+
+#define PROBE_POLAR 0
+#define PROBE_THETA_V 1
+#define PROBE_THETA_H 2
+#define PROBE_THETA_D 3
+
+uniform int probeMode;
+uniform int numSamples;
+uniform float angleStart;
+uniform float angleEnd;
+
+uniform vec3 incidentVector;
+uniform float incidentPhi;
+uniform float useLogPlot;
+uniform float useNDotL;
+uniform vec3 colorMask;
+uniform float phiV;
+uniform float thetaH;
+uniform float thetaD;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+::INSERT_UNIFORMS_HERE::
+
+
+::INSERT_BRDF_FUNCTION_HERE::
+
+
+float modifyLog( float x )
+{
+    // log base 10
+    return log(x + 1.0) * 0.434294482;
+}
+
+vec3 rotate( vec3 v, vec3 axis, float angle )
+{
+    vec3 n;
+    axis = normalize( axis );
+    n = axis * dot( axis, v );
+    return n + cos(angle)*(v-n) + sin(angle)*cross(axis, v);
+}
+
+void main(void)
+{
+    float t = floor( gl_FragCoord.x ) / float( max( numSamples - 1, 1 ) );
+    float angle = mix( angleStart, angleEnd, t );
+
+    vec3 N = vec3(0,0,1); // normal
+    vec3 X = vec3(1,0,0); // tangent
+    vec3 Y = vec3(0,1,0); // bitangent
+
+    // the same light and view vectors the plot templates build
+    vec3 L = normalize( incidentVector );
+    vec3 V;
+    if( probeMode == PROBE_POLAR || probeMode == PROBE_THETA_V )
+    {
+        float yAngle = probeMode == PROBE_POLAR ? angle - 1.57079633 : -angle;
+        float phi = probeMode == PROBE_POLAR ? incidentPhi : phiV;
+        V = normalize( vec3( sin(yAngle) * cos(phi), sin(yAngle) * sin(phi), cos(yAngle) ) );
+    }
+    else
+    {
+        float h = probeMode == PROBE_THETA_H ? angle : thetaH;
+        float d = probeMode == PROBE_THETA_D ? angle : thetaD;
+        L = rotate(rotate(N, X, d), Y, h);
+        vec3 H = rotate(N, Y, h);
+        V = 2*dot(L,H)*H - L;
+    }
+
+    vec3 bRes = BRDF( L, V, N, X, Y );
+    float b = dot( bRes, colorMask );
+    b *= (useNDotL > 0.5 ? dot( N, L ) : 1.0);
+    b = useLogPlot > 0.5 ? modifyLog( b ) : b;
+
+    fragColor = vec4( b, 0, 0, 1 );
+}
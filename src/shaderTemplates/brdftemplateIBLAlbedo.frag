@@ -0,0 +1,116 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#version 410
+
+// bakes the directional albedo of the BRDF for the split-sum IBL preview.
+// Each texel of the LUT is one view angle (x is cos theta_v); the result is
+// the albedo in RGB and an effective roughness for the lobe in A.
+
+uniform int numSamples;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+const float PI_ = 3.14159265358979323846264;
+const vec3 RGB2L = vec3(0.3, 0.59, 0.11);
+
+::INSERT_UNIFORMS_HERE::
+
+::INSERT_BRDF_FUNCTION_HERE::
+
+
+float radicalInverse( uint bits )
+{
+    bits = ( bits << 16u) | ( bits >> 16u);
+    bits = ((bits & 0x00ff00ffu) << 8u) | ((bits & 0xff00ff00u) >> 8u);
+    bits = ((bits & 0x0f0f0f0fu) << 4u) | ((bits & 0xf0f0f0f0u) >> 4u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xccccccccu) >> 2u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xaaaaaaaau) >> 1u);
+    return float(bits) * 2.3283064365386963e-10; // divide by 1<<32
+}
+
+
+void main(void)
+{
+    vec3 N = vec3(0,0,1);
+    vec3 X = vec3(1,0,0);
+    vec3 Y = vec3(0,1,0);
+
+    float cosThetaV = clamp( texCoord.x, 0.001, 1.0 );
+    vec3 V = vec3( sqrt( 1.0 - cosThetaV * cosThetaV ), 0.0, cosThetaV );
+    vec3 R = vec3( -V.x, -V.y, V.z );
+
+    vec3 albedo = vec3(0.0);
+    float lobeWeight = 0.0;
+    float lobeCosine = 0.0;
+
+    for( int i = 0; i < numSamples; i++ )
+    {
+        // cosine-weighted hemisphere samples, so cos/pdf is just PI
+        float u = (float(i) + 0.5) / float(numSamples);
+        float phi = 2.0 * PI_ * radicalInverse( uint(i) );
+        float sinTheta = sqrt( u );
+        vec3 L = vec3( sinTheta * cos(phi), sinTheta * sin(phi), sqrt( 1.0 - u ) );
+
+        vec3 b = max( BRDF( L, V, N, X, Y ), vec3(0.0) );
+        albedo += b;
+
+        // how tightly the reflected energy clusters around the mirror direction
+        float w = dot( b, RGB2L );
+        lobeWeight += w;
+        lobeCosine += w * dot( L, R );
+    }
+
+    albedo *= PI_ / float(numSamples);
+
+    // a cosine lobe has a mean cosine of 2/3 around its axis, so anything that
+    // spread out gets treated as fully rough
+    float meanCosine = lobeWeight > 0.0 ? lobeCosine / lobeWeight : 2.0 / 3.0;
+    float roughness = clamp( sqrt( 3.0 * max( 1.0 - meanCosine, 0.0 ) ), 0.0, 1.0 );
+
+    fragColor = vec4( albedo, roughness );
+}
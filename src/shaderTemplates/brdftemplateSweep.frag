@@ -0,0 +1,83 @@
+/*
+Copyright Disney Enterprises, Inc. All rights reserved.
+
+This license governs use of the accompanying software. If you use the software, you
+accept this license. If you do not accept the license, do not use the software.
+
+1. Definitions
+The terms "reproduce," "reproduction," "derivative works," and "distribution" have
+the same meaning here as under U.S. copyright law. A "contribution" is the original
+software, or any additions or changes to the software. A "contributor" is any person
+that distributes its contribution under this license. "Licensed patents" are a
+contributor's patent claims that read directly on its contribution.
+
+2. Grant of Rights
+(A) Copyright Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free copyright license to reproduce its contribution, prepare
+derivative works of its contribution, and distribute its contribution or any derivative
+works that you create.
+(B) Patent Grant- Subject to the terms of this license, including the license
+conditions and limitations in section 3, each contributor grants you a non-exclusive,
+worldwide, royalty-free license under its licensed patents to make, have made,
+use, sell, offer for sale, import, and/or otherwise dispose of its contribution in the
+software or derivative works of the contribution in the software.
+
+3. Conditions and Limitations
+(A) No Trademark License- This license does not grant you rights to use any
+contributors' name, logo, or trademarks.
+(B) If you bring a patent claim against any contributor over patents that you claim
+are infringed by the software, your patent license from such contributor to the
+software ends automatically.
+(C) If you distribute any portion of the software, you must retain all copyright,
+patent, trademark, and attribution notices that are present in the software.
+(D) If you distribute any portion of the software in source code form, you may do
+so only under this license by including a complete copy of this license with your
+distribution. If you distribute any portion of the software in compiled or object code
+form, you may only do so under a license that complies with this license.
+(E) The software is licensed "as-is." You bear the risk of using it. The contributors
+give no express warranties, guarantees or conditions. You may have additional
+consumer rights under your local laws which this license cannot change.
+To the extent permitted under your local laws, the contributors exclude the
+implied warranties of merchantability, fitness for a particular purpose and non-
+infringement.
+*/
+
+#version 410
+
+// a curve of a parameter sweep, coloured by where its value falls in the
+// swept range
+
+uniform vec2 sweepRange;
+uniform float thickness;
+const float antialias = 5.0;
+
+in vec2 v_texCoord;
+in float v_sweepValue;
+
+out vec4 fragColor;
+
+vec3 sweepColor( float t )
+{
+    // dark blue through teal to orange
+    vec3 low  = vec3( 0.15, 0.15, 0.65 );
+    vec3 mid  = vec3( 0.0,  0.6,  0.55 );
+    vec3 high = vec3( 0.95, 0.55, 0.0 );
+    return t < 0.5 ? mix( low, mid, t * 2.0 ) : mix( mid, high, t * 2.0 - 1.0 );
+}
+
+void main(void)
+{
+    float range = sweepRange.y - sweepRange.x;
+    float t = range != 0.0 ? clamp( (v_sweepValue - sweepRange.x) / range, 0.0, 1.0 ) : 0.0;
+
+    float distance = v_texCoord.y;
+    float d = abs(distance) - thickness + antialias;
+    float alpha = 1.0;
+    if( d > 0.0 )
+    {
+        alpha = d/(antialias);
+        alpha = exp(-alpha*alpha);
+    }
+    fragColor = vec4(sweepColor(t),alpha);
+}